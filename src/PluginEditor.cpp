@@ -4,7 +4,7 @@
 #include "dsp/lfo.h"
 
 // Dynamic parameter labels per engine [engine][0=harmonics, 1=timbre, 2=morph]
-const char* const PlaitsVSTEditor::kEngineParamLabels[16][3] = {
+const char* const PlaitsVSTEditor::kEngineParamLabels[24][3] = {
     {"DETUNE", "SQUARE", "SAW"},           // VA
     {"WAVEFORM", "FOLD", "ASYMMETRY"},     // Waveshaper
     {"RATIO", "MOD IDX", "FEEDBACK"},      // FM
@@ -21,12 +21,20 @@ const char* const PlaitsVSTEditor::kEngineParamLabels[16][3] = {
     {"ATTACK", "TONE", "DECAY"},           // Bass Drum
     {"NOISE", "MODES", "DECAY"},           // Snare
     {"METAL", "HIGHPASS", "DECAY"},        // Hi-Hat
+    {"RESONAN", "CUTOFF", "WAVEFORM"},     // VA VCF
+    {"FREQ", "AMOUNT", "ASYMMETRY"},       // Phase Dist
+    {"PATCH", "MOD LVL", "ENV TIME"},      // Six-Op 1
+    {"PATCH", "MOD LVL", "ENV TIME"},      // Six-Op 2
+    {"PATCH", "MOD LVL", "ENV TIME"},      // Six-Op 3
+    {"TERRAIN", "RADIUS", "OFFSET"},       // Wave Terrain
+    {"CHORD", "CHORUS", "WAVEFORM"},       // String Machine
+    {"CHORD", "ARPEGGIO", "PW/ENV"},       // Chiptune
 };
 
 // Row configuration: label, type, min, max, smallStep, largeStep, suffix
 const PlaitsVSTEditor::RowConfig PlaitsVSTEditor::kRowConfigs[kNumRows] = {
     {"PRESET",    RowType::Preset,     0,   0,    1,   1,  ""},
-    {"ENGINE",    RowType::Engine,     0,   15,   1,   1,  ""},
+    {"ENGINE",    RowType::Engine,     0,   23,   1,   1,  ""},
     {"HARMONICS", RowType::Harmonics,  0,   127,  1,   13, ""},
     {"TIMBRE",    RowType::Timbre,     0,   127,  1,   13, ""},
     {"MORPH",     RowType::Morph,      0,   127,  1,   13, ""},
@@ -35,6 +43,7 @@ const PlaitsVSTEditor::RowConfig PlaitsVSTEditor::kRowConfigs[kNumRows] = {
     {"VOICES",    RowType::Voices,     1,   16,   1,   2,  ""},
     {"CUTOFF",    RowType::Cutoff,     0,   127,  1,   13, ""},
     {"RESO",      RowType::Resonance,  0,   127,  1,   13, ""},
+    {"FILTER",    RowType::FilterMode, 0,   1,    1,   1,  ""},
     {"LFO1",      RowType::Lfo1,       0,   0,    1,   1,  ""},  // Multi-field
     {"LFO2",      RowType::Lfo2,       0,   0,    1,   1,  ""},  // Multi-field
     {"ENV1",      RowType::Env1,       0,   0,    1,   1,  ""},  // Multi-field
@@ -56,7 +65,7 @@ namespace {
 
     // Layout
     constexpr int kWindowWidth = 320;
-    constexpr int kWindowHeight = 430;
+    constexpr int kWindowHeight = 458;
     constexpr int kTitleHeight = 32;
     constexpr int kRowHeight = 26;
     constexpr int kRowMargin = 2;
@@ -123,7 +132,7 @@ int PlaitsVSTEditor::getDisplayValue(int row) const
         case RowType::Preset:
             return processor_.getPresetManager().getCurrentPresetIndex();
         case RowType::Engine:
-            return processor_.getEngineParam()->getIndex();
+            return processor_.getEngineIndex();
         case RowType::Harmonics:
             return static_cast<int>(processor_.getHarmonicsParam()->get() * 127.0f + 0.5f);
         case RowType::Timbre:
@@ -140,6 +149,8 @@ int PlaitsVSTEditor::getDisplayValue(int row) const
             return static_cast<int>(processor_.getCutoffParam()->get() * 127.0f + 0.5f);
         case RowType::Resonance:
             return static_cast<int>(processor_.getResonanceParam()->get() * 127.0f + 0.5f);
+        case RowType::FilterMode:
+            return processor_.getFilterModeParam()->getIndex();
         // Mod rows handled by getModFieldValue
         default:
             return 0;
@@ -163,7 +174,15 @@ void PlaitsVSTEditor::setDisplayValue(int row, int value)
             processor_.getPresetManager().loadPreset(value);
             break;
         case RowType::Engine:
-            processor_.getEngineParam()->setValueNotifyingHost(value / 15.0f);
+            // The row runs through the classic engines, then the newer models
+            // of the second engine parameter
+            if (value < Voice::kNumClassicEngines) {
+                processor_.getEngineParam()->setValueNotifyingHost(
+                    processor_.getEngineParam()->convertTo0to1(static_cast<float>(value)));
+            }
+            processor_.getEngine2Param()->setValueNotifyingHost(
+                processor_.getEngine2Param()->convertTo0to1(
+                    static_cast<float>(juce::jmax(0, value - Voice::kNumClassicEngines + 1))));
             break;
         case RowType::Harmonics:
             processor_.getHarmonicsParam()->setValueNotifyingHost(value / 127.0f);
@@ -189,6 +208,9 @@ void PlaitsVSTEditor::setDisplayValue(int row, int value)
         case RowType::Resonance:
             processor_.getResonanceParam()->setValueNotifyingHost(value / 127.0f);
             break;
+        case RowType::FilterMode:
+            processor_.getFilterModeParam()->setValueNotifyingHost(static_cast<float>(value));
+            break;
         default:
             break;
     }
@@ -424,7 +446,7 @@ int PlaitsVSTEditor::getLargeStepForModField(int row, int field) const
 
 juce::String PlaitsVSTEditor::getModDestinationName(int destIndex) const
 {
-    int engine = processor_.getEngineParam()->getIndex();
+    int engine = processor_.getEngineIndex();
     switch (destIndex) {
         case 0: return juce::String(kEngineParamLabels[engine][0]).substring(0, 7);
         case 1: return juce::String(kEngineParamLabels[engine][1]).substring(0, 7);
@@ -441,7 +463,7 @@ juce::String PlaitsVSTEditor::getModDestinationName(int destIndex) const
 
 const char* PlaitsVSTEditor::getDynamicLabel(int row) const
 {
-    int engine = processor_.getEngineParam()->getIndex();
+    int engine = processor_.getEngineIndex();
     const auto& cfg = kRowConfigs[row];
 
     switch (cfg.type) {
@@ -470,6 +492,8 @@ juce::String PlaitsVSTEditor::formatValue(int row) const
         }
         case RowType::Engine:
             return engineNames_[value];
+        case RowType::FilterMode:
+            return value == 1 ? "VOICE" : "GLOBAL";
         default:
             return juce::String(value) + cfg.suffix;
     }
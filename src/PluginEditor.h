@@ -25,10 +25,10 @@ private:
     // Row types - compact layout with multi-field mod rows
     enum class RowType {
         Preset, Engine, Harmonics, Timbre, Morph, Attack, Decay, Voices,
-        Cutoff, Resonance,
+        Cutoff, Resonance, FilterMode,
         Lfo1, Lfo2, Env1, Env2  // Multi-field rows
     };
-    static constexpr int kNumRows = 14;
+    static constexpr int kNumRows = 15;
 
     struct RowConfig {
         const char* label;
@@ -84,11 +84,12 @@ private:
     const juce::StringArray engineNames_ = {
         "VA", "WAVSHP", "FM", "GRAIN", "ADDTIV", "WAVTBL",
         "CHORD", "SPEECH", "SWARM", "NOISE", "PARTCL", "STRING",
-        "MODAL", "B.DRUM", "SNARE", "HI-HAT"
+        "MODAL", "B.DRUM", "SNARE", "HI-HAT", "VA VCF", "PH.DST",
+        "6-OP 1", "6-OP 2", "6-OP 3", "TERRAN", "STRMCH", "CHIPTN"
     };
 
     // Dynamic parameter labels per engine [engine][0=harmonics, 1=timbre, 2=morph]
-    static const char* const kEngineParamLabels[16][3];
+    static const char* const kEngineParamLabels[24][3];
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlaitsVSTEditor)
 };
@@ -5,6 +5,7 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "PresetManager.h"
+#include "stmlib/dsp/units.h"
 
 namespace {
     const juce::StringArray engineNames = {
@@ -26,6 +27,25 @@ namespace {
         "Hi-Hat"            // Analog hi-hat
     };
 
+    // The newer Plaits models have a parameter of their own, so that the
+    // classic engine choice keeps the 16 steps that saved automation uses
+    const juce::StringArray engine2Names = {
+        "Off",              // Play the classic engine
+        "VA VCF",           // Virtual analog with filter
+        "Phase Dist",       // Phase distortion
+        "Six-Op 1",         // 6-operator FM, bank 1
+        "Six-Op 2",         // 6-operator FM, bank 2
+        "Six-Op 3",         // 6-operator FM, bank 3
+        "Wave Terrain",     // Wave terrain
+        "String Machine",   // String machine
+        "Chiptune"          // Chiptune
+    };
+
+    const juce::StringArray filterModeNames = {
+        "Global",           // One filter after the voice mix
+        "Voice"             // A filter per voice
+    };
+
     const juce::StringArray lfoRateNames = {
         "1/16", "1/8", "1/4", "1/2", "1BAR", "2BAR", "4BAR"
     };
@@ -37,6 +57,14 @@ namespace {
     const juce::StringArray modDestNames = {
         "HARMNIC", "TIMBRE", "MORPH", "CUTOFF", "RESONAN", "LFO1 RT", "LFO1 AM", "LFO2 RT", "LFO2 AM"
     };
+
+    // Map 0-1 to exponential frequency range (20Hz to 20kHz, 1000 times or
+    // 12 * log2(1000) semitones), from stmlib's pitch ratio tables
+    inline float cutoffToHz(float cutoff)
+    {
+        constexpr float kCutoffRangeSemitones = 119.589411f;
+        return 20.0f * stmlib::SemitonesToRatio(cutoff * kCutoffRangeSemitones);
+    }
 }
 
 PlaitsVSTProcessor::PlaitsVSTProcessor()
@@ -109,6 +137,13 @@ PlaitsVSTProcessor::PlaitsVSTProcessor()
         0.0f  // No resonance by default
     ));
 
+    addParameter(filterModeParam_ = new juce::AudioParameterChoice(
+        juce::ParameterID("filtermode", 1),
+        "Filter Mode",
+        filterModeNames,
+        0  // Global by default
+    ));
+
     // LFO1 parameters
     addParameter(lfo1RateParam_ = new juce::AudioParameterChoice(
         juce::ParameterID("lfo1rate", 1),
@@ -221,10 +256,47 @@ PlaitsVSTProcessor::PlaitsVSTProcessor()
         -64, 63, 0
     ));
 
-    voiceAllocator_.Init(44100.0, 8);
+    // Rendering options
+    addParameter(multiThreadedParam_ = new juce::AudioParameterBool(
+        juce::ParameterID("multithreaded", 1),
+        "Multi-Threaded",
+        false,  // Serial rendering by default
+        juce::AudioParameterBoolAttributes().withAutomatable(false)
+    ));
 
-    // Initialize modulation matrix and filter
+    // Added after the others, so the existing parameters keep their indices
+    addParameter(engine2Param_ = new juce::AudioParameterChoice(
+        juce::ParameterID("engine2", 1),
+        "Engine 2",
+        engine2Names,
+        0  // Off: the classic engine plays
+    ));
+
+    // Watch every parameter, so the audio thread only re-reads them after a
+    // change
+    jassert(getParameters().size() <= 64);
+    for (auto* param : getParameters()) {
+        param->addListener(this);
+    }
+    auto maskOf = [](std::initializer_list<juce::AudioProcessorParameter*> params) {
+        uint64_t mask = 0;
+        for (auto* param : params) {
+            mask |= uint64_t(1) << param->getParameterIndex();
+        }
+        return mask;
+    };
+    lfoParameterMask_[0] = maskOf({ lfo1RateParam_, lfo1ShapeParam_, lfo1DestParam_, lfo1AmountParam_ });
+    lfoParameterMask_[1] = maskOf({ lfo2RateParam_, lfo2ShapeParam_, lfo2DestParam_, lfo2AmountParam_ });
+    envParameterMask_[0] = maskOf({ env1AttackParam_, env1DecayParam_, env1DestParam_, env1AmountParam_ });
+    envParameterMask_[1] = maskOf({ env2AttackParam_, env2DecayParam_, env2DestParam_, env2AmountParam_ });
+
+    // The voices are initialised in prepareToPlay(), at the host's rate
+
+    // Initialize modulation matrix and filter. Each new instance gets its own
+    // S&H seed, which is then saved with the project
     modMatrix_.Init();
+    modulationSeed_.store(static_cast<uint32_t>(juce::Random::getSystemRandom().nextInt()));
+    modMatrix_.SetSeed(modulationSeed_.load());
     filter_.Init(44100.0f);
 
     // Initialize preset manager after parameters are created
@@ -232,7 +304,10 @@ PlaitsVSTProcessor::PlaitsVSTProcessor()
     presetManager_->initialize();
 }
 
-PlaitsVSTProcessor::~PlaitsVSTProcessor() = default;
+PlaitsVSTProcessor::~PlaitsVSTProcessor()
+{
+    cancelPendingUpdate();
+}
 
 PresetManager& PlaitsVSTProcessor::getPresetManager()
 {
@@ -243,22 +318,117 @@ void PlaitsVSTProcessor::prepareToPlay(double sampleRate, int /*samplesPerBlock*
 {
     hostSampleRate_ = sampleRate;
     voiceAllocator_.Init(sampleRate, polyphonyParam_->get());
+    updateRenderThreads();
+    prepared_ = true;
     filter_.Init(static_cast<float>(sampleRate));
     modMatrix_.Reset();
+    samplesUntilControlTick_ = 0;
+
+    // Start the smoothed values where the parameters are
+    updateParameterSnapshot();
+    const float controlRate = static_cast<float>(sampleRate);
+    harmonicsSmoother_.Init(controlRate, kSmoothingMs, kControlBlockSize);
+    timbreSmoother_.Init(controlRate, kSmoothingMs, kControlBlockSize);
+    morphSmoother_.Init(controlRate, kSmoothingMs, kControlBlockSize);
+    cutoffSmoother_.Init(controlRate, kSmoothingMs, kControlBlockSize);
+    resonanceSmoother_.Init(controlRate, kSmoothingMs, kControlBlockSize);
+    harmonicsSmoother_.Reset(params_.harmonics);
+    timbreSmoother_.Reset(params_.timbre);
+    morphSmoother_.Reset(params_.morph);
+    cutoffSmoother_.Reset(params_.cutoff);
+    resonanceSmoother_.Reset(params_.resonance);
 }
 
 void PlaitsVSTProcessor::releaseResources()
 {
+    prepared_ = false;
+    voiceAllocator_.setRenderThreads(0);
+}
+
+void PlaitsVSTProcessor::parameterValueChanged(int parameterIndex, float /*newValue*/)
+{
+    if (parameterIndex >= 0 && parameterIndex < 64) {
+        dirtyParameters_.fetch_or(uint64_t(1) << parameterIndex, std::memory_order_release);
+    }
+    if (parameterIndex == multiThreadedParam_->getParameterIndex()) {
+        triggerAsyncUpdate();
+    }
+}
+
+void PlaitsVSTProcessor::updateRenderThreads()
+{
+    voiceAllocator_.setRenderThreads(multiThreadedParam_->get()
+        ? juce::SystemStats::getNumCpus() - 1 : 0);
+}
+
+void PlaitsVSTProcessor::handleAsyncUpdate()
+{
+    // Until prepared, prepareToPlay() starts the threads
+    if (!prepared_) {
+        return;
+    }
+    suspendProcessing(true);
+    updateRenderThreads();
+    suspendProcessing(false);
+}
+
+void PlaitsVSTProcessor::updateParameterSnapshot()
+{
+    uint64_t dirty = dirtyParameters_.exchange(0, std::memory_order_acquire);
+
+    // A preset or restored state arrives whole, and replaces everything...
+    const PluginState* state = pendingState_.read();
+    if (!state && dirty == 0) {
+        return;
+    }
+    if (state) {
+        params_ = *state;
+    }
+
+    // ...except parameters changed since, e.g. automation on the same block.
+    // Only those are read: the others may be part way through a preset that
+    // has not been published yet
+    if (dirty != 0) {
+        readParameters(params_, dirty);
+    }
+    if (state) {
+        dirty = ~uint64_t(0);
+    }
+
+    voiceAllocator_.setPolyphony(params_.polyphony);
+    voiceAllocator_.set_engine(params_.engine);
+
+    // The global filter is bypassed in voice mode; it starts clean when it
+    // comes back
+    bool voiceFilter = params_.filterMode == 1;
+    if (voiceFilter != voiceFilter_) {
+        voiceFilter_ = voiceFilter;
+        voiceAllocator_.setVoiceFilter(voiceFilter_);
+        filter_.Reset();
+    }
+
+    updateModulationParams(dirty);
 }
 
 void PlaitsVSTProcessor::handleMidiMessage(const juce::MidiMessage& msg)
 {
     if (msg.isNoteOn())
     {
+        // Track voices for envelope triggering
+        bool wasSilent = voiceAllocator_.activeVoiceCount() == 0;
+
         // Convert attack/decay from 0-1 to ms
-        float attackMs = attackParam_->get() * 500.0f;
-        float decayMs = 10.0f + decayParam_->get() * 1990.0f;
-        voiceAllocator_.NoteOn(msg.getNoteNumber(), msg.getFloatVelocity(), attackMs, decayMs);
+        float attackMs = params_.attack * 500.0f;
+        float decayMs = 10.0f + params_.decay * 1990.0f;
+        int voice = voiceAllocator_.NoteOn(msg.getNoteNumber(), msg.getFloatVelocity(), attackMs, decayMs);
+        if (voice >= 0) {
+            modMatrix_.TriggerVoice(voice);
+        }
+
+        // The global envelopes restart on the first note after silence
+        if (wasSilent) {
+            modMatrix_.TriggerEnvelopes();
+        }
     }
     else if (msg.isNoteOff())
     {
@@ -270,75 +440,187 @@ void PlaitsVSTProcessor::handleMidiMessage(const juce::MidiMessage& msg)
     }
 }
 
-void PlaitsVSTProcessor::processBlock(juce::AudioBuffer<float>& buffer,
-                                       juce::MidiBuffer& midiMessages)
+void PlaitsVSTProcessor::renderVoices(float* left, float* right, int startSample, int endSample)
 {
-    juce::ScopedNoDenormals noDenormals;
+    if (endSample > startSample) {
+        voiceAllocator_.Process(left + startSample, right + startSample,
+                                static_cast<size_t>(endSample - startSample));
+    }
+}
 
-    // Track voices for envelope triggering
-    int prevActiveVoices = activeVoiceCount_;
+void PlaitsVSTProcessor::updateTransport()
+{
+    transportPlaying_ = false;
 
-    // Handle MIDI messages
-    for (const auto metadata : midiMessages)
-    {
-        handleMidiMessage(metadata.getMessage());
+    auto* playHead = getPlayHead();
+    if (!playHead) {
+        return;
+    }
+    auto position = playHead->getPosition();
+    if (!position) {
+        return;
     }
 
-    // Update polyphony if changed
-    voiceAllocator_.setPolyphony(polyphonyParam_->get());
+    if (auto bpm = position->getBpm(); bpm && *bpm > 0.0) {
+        hostBpm_ = *bpm;
+        modMatrix_.SetTempo(hostBpm_);
+    }
 
-    // Update modulation parameters from UI
-    updateModulationParams();
+    if (auto ppq = position->getPpqPosition(); ppq && position->getIsPlaying()) {
+        blockPpq_ = *ppq;
+        transportPlaying_ = true;
+    }
+}
 
-    // Process modulation matrix
-    const int numSamples = buffer.getNumSamples();
-    modMatrix_.Process(static_cast<float>(hostSampleRate_), numSamples);
+void PlaitsVSTProcessor::syncModulation(int sampleOffset)
+{
+    // While the transport plays, LFO phase follows the song position
+    if (transportPlaying_) {
+        double beatsPerSample = hostBpm_ / (60.0 * hostSampleRate_);
+        modMatrix_.SetSongPosition(blockPpq_ + sampleOffset * beatsPerSample);
+    }
+}
 
-    // Trigger envelopes on first note after silence
-    activeVoiceCount_ = voiceAllocator_.activeVoiceCount();
-    if (activeVoiceCount_ > 0 && prevActiveVoices == 0) {
-        modMatrix_.TriggerEnvelopes();
+void PlaitsVSTProcessor::updateControlRate(int sampleOffset)
+{
+    // Advance the modulation sources by one control block
+    syncModulation(sampleOffset);
+    modMatrix_.Process(static_cast<float>(hostSampleRate_), kControlBlockSize);
+
+    // Every voice gets its own values, from its own envelopes, around base
+    // values smoothed at the control rate. Voices pick these up at their next
+    // internal block, and the Plaits engines interpolate them across it.
+    using plaits::ModDestination;
+    const float harmonics = harmonicsSmoother_.Process(params_.harmonics);
+    const float timbre = timbreSmoother_.Process(params_.timbre);
+    const float morph = morphSmoother_.Process(params_.morph);
+    const float cutoff = cutoffSmoother_.Process(params_.cutoff);
+    const float resonance = resonanceSmoother_.Process(params_.resonance);
+    // Voices past the polyphony never sound, so are left as they are
+    const int polyphony = voiceAllocator_.polyphony();
+    for (int v = 0; v < polyphony; ++v) {
+        voiceAllocator_.set_harmonics(v, modMatrix_.GetModulatedVoiceValue(v, ModDestination::Harmonics, harmonics));
+        voiceAllocator_.set_timbre(v, modMatrix_.GetModulatedVoiceValue(v, ModDestination::Timbre, timbre));
+        voiceAllocator_.set_morph(v, modMatrix_.GetModulatedVoiceValue(v, ModDestination::Morph, morph));
+
+        if (voiceFilter_) {
+            float voiceCutoff = modMatrix_.GetModulatedVoiceValue(v, ModDestination::Cutoff, cutoff);
+            float voiceResonance = modMatrix_.GetModulatedVoiceValue(v, ModDestination::Resonance, resonance);
+            voiceAllocator_.set_filter_target(v, cutoffToHz(voiceCutoff), voiceResonance);
+        }
     }
 
-    // Get modulated values
-    float modulatedHarmonics = getModulatedHarmonics();
-    float modulatedTimbre = getModulatedTimbre();
-    float modulatedMorph = getModulatedMorph();
-    float modulatedCutoff = getModulatedCutoff();
-    float modulatedResonance = getModulatedResonance();
+    // The filters glide to the new settings over the control block instead
+    // of stepping, so fast modulation does not click
+    if (voiceFilter_) {
+        voiceAllocator_.glideFilters(kControlBlockSize);
+    } else {
+        float cutoffHz = cutoffToHz(modMatrix_.GetModulatedValue(ModDestination::Cutoff, cutoff));
+        float modulatedResonance = modMatrix_.GetModulatedValue(ModDestination::Resonance, resonance);
+        filter_.RampTo(cutoffHz, modulatedResonance, kControlBlockSize);
+    }
+}
 
-    // Update shared parameters with modulated values
-    voiceAllocator_.set_engine(engineParam_->getIndex());
-    voiceAllocator_.set_harmonics(modulatedHarmonics);
-    voiceAllocator_.set_timbre(modulatedTimbre);
-    voiceAllocator_.set_morph(modulatedMorph);
+void PlaitsVSTProcessor::filterOutput(float* left, float* right, int startSample, int endSample)
+{
+    // Voices were already filtered individually in voice mode
+    if (voiceFilter_ || endSample <= startSample) {
+        return;
+    }
 
-    // Update filter with modulated values
-    // Map 0-1 to exponential frequency range (20Hz to 20kHz)
-    float cutoffHz = 20.0f * std::pow(1000.0f, modulatedCutoff);
-    filter_.SetCutoff(cutoffHz);
-    filter_.SetResonance(modulatedResonance);
+    // Each channel runs through its own ladder
+    if (right) {
+        filter_.Process(left + startSample, right + startSample,
+                        static_cast<size_t>(endSample - startSample));
+    } else {
+        for (int i = startSample; i < endSample; ++i) {
+            left[i] = filter_.Process(left[i]);
+        }
+    }
+}
+
+void PlaitsVSTProcessor::processBlock(juce::AudioBuffer<float>& buffer,
+                                       juce::MidiBuffer& midiMessages)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    // Pick up parameter changes, and tempo and song position from the host
+    updateParameterSnapshot();
+    updateTransport();
+    if (modulationSeedChanged_.exchange(false)) {
+        modMatrix_.SetSeed(modulationSeed_.load());
+    }
+
+    const int numSamples = buffer.getNumSamples();
+
+    // Nothing playing, no note to start and no filter tail: skip the DSP and
+    // hand the host a cleared buffer
+    bool startsNote = false;
+    for (const auto metadata : midiMessages) {
+        startsNote = startsNote || metadata.getMessage().isNoteOn();
+    }
+    if (!startsNote && voiceAllocator_.isSilent() && (voiceFilter_ || filter_.IsSilent())) {
+        // Keep the modulation sources and the control clock running, so
+        // control ticks land on the same samples as if we had rendered
+        syncModulation(0);
+        modMatrix_.Process(static_cast<float>(hostSampleRate_), numSamples);
+        int untilTick = (samplesUntilControlTick_ - numSamples) % kControlBlockSize;
+        samplesUntilControlTick_ = untilTick < 0 ? untilTick + kControlBlockSize : untilTick;
+
+        for (const auto metadata : midiMessages) {
+            handleMidiMessage(metadata.getMessage());
+        }
+        buffer.clear();
+        return;
+    }
 
     // Get output pointers
     auto* leftChannel = buffer.getWritePointer(0);
     auto* rightChannel = buffer.getNumChannels() > 1 ? buffer.getWritePointer(1) : nullptr;
 
-    // Process all voices
-    if (rightChannel) {
-        voiceAllocator_.Process(leftChannel, rightChannel, static_cast<size_t>(numSamples));
-    } else {
-        // Mono output
-        float tempRight[2048];
-        size_t samples = std::min(static_cast<size_t>(numSamples), sizeof(tempRight) / sizeof(float));
-        voiceAllocator_.Process(leftChannel, tempRight, samples);
+    // Mono output renders the right channel into scratch space
+    float tempRight[2048];
+    float* voiceRight = rightChannel;
+    int renderSamples = numSamples;
+    if (!rightChannel) {
+        voiceRight = tempRight;
+        renderSamples = std::min(numSamples, static_cast<int>(sizeof(tempRight) / sizeof(float)));
     }
 
-    // Apply filter to output
-    for (int i = 0; i < numSamples; ++i) {
-        leftChannel[i] = filter_.Process(leftChannel[i]);
-        if (rightChannel) {
-            rightChannel[i] = filter_.Process(rightChannel[i]);
+    // Work in control-rate segments: modulation is evaluated every
+    // kControlBlockSize samples on a clock that runs across host blocks, so
+    // the sound does not depend on the host buffer size
+    auto event = midiMessages.cbegin();
+    const auto lastEvent = midiMessages.cend();
+    int position = 0;
+    while (position < renderSamples) {
+        if (samplesUntilControlTick_ == 0) {
+            updateControlRate(position);
+            samplesUntilControlTick_ = kControlBlockSize;
         }
+
+        const int segmentStart = position;
+        const int segmentEnd = std::min(renderSamples, position + samplesUntilControlTick_);
+
+        // Render voices up to each MIDI event, then apply it
+        for (; event != lastEvent && (*event).samplePosition < segmentEnd; ++event) {
+            const auto metadata = *event;
+            int eventPosition = juce::jlimit(position, segmentEnd, metadata.samplePosition);
+            renderVoices(leftChannel, voiceRight, position, eventPosition);
+            position = eventPosition;
+
+            handleMidiMessage(metadata.getMessage());
+        }
+        renderVoices(leftChannel, voiceRight, position, segmentEnd);
+        filterOutput(leftChannel, rightChannel, segmentStart, segmentEnd);
+
+        samplesUntilControlTick_ -= segmentEnd - segmentStart;
+        position = segmentEnd;
+    }
+
+    // Events past the rendered range still take effect
+    for (; event != lastEvent; ++event) {
+        handleMidiMessage((*event).getMessage());
     }
 }
 
@@ -347,150 +629,306 @@ juce::AudioProcessorEditor* PlaitsVSTProcessor::createEditor()
     return new PlaitsVSTEditor(*this);
 }
 
-void PlaitsVSTProcessor::getStateInformation(juce::MemoryBlock& destData)
+int PlaitsVSTProcessor::getEngineIndex() const
 {
-    auto state = juce::ValueTree("PlaitsVSTState");
-    state.setProperty("engine", engineParam_->getIndex(), nullptr);
-    state.setProperty("harmonics", harmonicsParam_->get(), nullptr);
-    state.setProperty("timbre", timbreParam_->get(), nullptr);
-    state.setProperty("morph", morphParam_->get(), nullptr);
-    state.setProperty("attack", attackParam_->get(), nullptr);
-    state.setProperty("decay", decayParam_->get(), nullptr);
-    state.setProperty("polyphony", polyphonyParam_->get(), nullptr);
+    const int engine2 = engine2Param_->getIndex();
+    return engine2 > 0 ? Voice::kNumClassicEngines - 1 + engine2 : engineParam_->getIndex();
+}
+
+void PlaitsVSTProcessor::readParameters(PluginState& state, uint64_t parameters) const
+{
+    auto read = [parameters](auto* param, auto& field) {
+        if ((parameters >> param->getParameterIndex()) & 1) {
+            using Param = std::remove_pointer_t<decltype(param)>;
+            if constexpr (std::is_same_v<Param, juce::AudioParameterChoice>) {
+                field = param->getIndex();
+            } else {
+                field = param->get();
+            }
+        }
+    };
+
+    // The engine comes from both engine parameters
+    const uint64_t engineParameters = (uint64_t(1) << engineParam_->getParameterIndex())
+        | (uint64_t(1) << engine2Param_->getParameterIndex());
+    if (parameters & engineParameters) {
+        state.engine = getEngineIndex();
+    }
+    read(harmonicsParam_, state.harmonics);
+    read(timbreParam_, state.timbre);
+    read(morphParam_, state.morph);
+    read(attackParam_, state.attack);
+    read(decayParam_, state.decay);
+    read(polyphonyParam_, state.polyphony);
 
     // Filter params
-    state.setProperty("cutoff", cutoffParam_->get(), nullptr);
-    state.setProperty("resonance", resonanceParam_->get(), nullptr);
+    read(cutoffParam_, state.cutoff);
+    read(resonanceParam_, state.resonance);
+    read(filterModeParam_, state.filterMode);
+
+    // LFO params
+    read(lfo1RateParam_, state.lfo[0].rate);
+    read(lfo1ShapeParam_, state.lfo[0].shape);
+    read(lfo1DestParam_, state.lfo[0].dest);
+    read(lfo1AmountParam_, state.lfo[0].amount);
+    read(lfo2RateParam_, state.lfo[1].rate);
+    read(lfo2ShapeParam_, state.lfo[1].shape);
+    read(lfo2DestParam_, state.lfo[1].dest);
+    read(lfo2AmountParam_, state.lfo[1].amount);
+
+    // ENV params
+    read(env1AttackParam_, state.env[0].attack);
+    read(env1DecayParam_, state.env[0].decay);
+    read(env1DestParam_, state.env[0].dest);
+    read(env1AmountParam_, state.env[0].amount);
+    read(env2AttackParam_, state.env[1].attack);
+    read(env2DecayParam_, state.env[1].decay);
+    read(env2DestParam_, state.env[1].dest);
+    read(env2AmountParam_, state.env[1].amount);
+
+    // Rendering options
+    read(multiThreadedParam_, state.multiThreaded);
+}
 
-    // LFO1 params
-    state.setProperty("lfo1rate", lfo1RateParam_->getIndex(), nullptr);
-    state.setProperty("lfo1shape", lfo1ShapeParam_->getIndex(), nullptr);
-    state.setProperty("lfo1dest", lfo1DestParam_->getIndex(), nullptr);
-    state.setProperty("lfo1amount", lfo1AmountParam_->get(), nullptr);
+PluginState PlaitsVSTProcessor::captureState() const
+{
+    PluginState state;
+    readParameters(state);
 
-    // LFO2 params
-    state.setProperty("lfo2rate", lfo2RateParam_->getIndex(), nullptr);
-    state.setProperty("lfo2shape", lfo2ShapeParam_->getIndex(), nullptr);
-    state.setProperty("lfo2dest", lfo2DestParam_->getIndex(), nullptr);
-    state.setProperty("lfo2amount", lfo2AmountParam_->get(), nullptr);
+    // S&H seed
+    state.modulationSeed = modulationSeed_.load();
+    return state;
+}
 
-    // ENV1 params
-    state.setProperty("env1attack", env1AttackParam_->get(), nullptr);
-    state.setProperty("env1decay", env1DecayParam_->get(), nullptr);
-    state.setProperty("env1dest", env1DestParam_->getIndex(), nullptr);
-    state.setProperty("env1amount", env1AmountParam_->get(), nullptr);
+uint64_t PlaitsVSTProcessor::applyState(const PluginState& state)
+{
+    // Set every parameter without notifying the host one at a time...
+    uint64_t changed = 0;
+    auto set = [&changed](juce::RangedAudioParameter* param, float value) {
+        const float normalised = param->convertTo0to1(value);
+        if (normalised != param->getValue()) {
+            param->setValue(normalised);
+            changed |= uint64_t(1) << param->getParameterIndex();
+        }
+    };
+    // A newer model leaves the classic choice as it was, for when the
+    // second parameter is turned off again
+    const int engine2 = juce::jmax(0, state.engine - Voice::kNumClassicEngines + 1);
+    if (engine2 == 0) {
+        set(engineParam_, static_cast<float>(state.engine));
+    }
+    set(engine2Param_, static_cast<float>(engine2));
+    set(harmonicsParam_, state.harmonics);
+    set(timbreParam_, state.timbre);
+    set(morphParam_, state.morph);
+    set(attackParam_, state.attack);
+    set(decayParam_, state.decay);
+    set(polyphonyParam_, static_cast<float>(state.polyphony));
+
+    set(cutoffParam_, state.cutoff);
+    set(resonanceParam_, state.resonance);
+    set(filterModeParam_, static_cast<float>(state.filterMode));
+
+    set(lfo1RateParam_, static_cast<float>(state.lfo[0].rate));
+    set(lfo1ShapeParam_, static_cast<float>(state.lfo[0].shape));
+    set(lfo1DestParam_, static_cast<float>(state.lfo[0].dest));
+    set(lfo1AmountParam_, static_cast<float>(state.lfo[0].amount));
+    set(lfo2RateParam_, static_cast<float>(state.lfo[1].rate));
+    set(lfo2ShapeParam_, static_cast<float>(state.lfo[1].shape));
+    set(lfo2DestParam_, static_cast<float>(state.lfo[1].dest));
+    set(lfo2AmountParam_, static_cast<float>(state.lfo[1].amount));
+
+    set(env1AttackParam_, state.env[0].attack);
+    set(env1DecayParam_, state.env[0].decay);
+    set(env1DestParam_, static_cast<float>(state.env[0].dest));
+    set(env1AmountParam_, static_cast<float>(state.env[0].amount));
+    set(env2AttackParam_, state.env[1].attack);
+    set(env2DecayParam_, state.env[1].decay);
+    set(env2DestParam_, static_cast<float>(state.env[1].dest));
+    set(env2AmountParam_, static_cast<float>(state.env[1].amount));
+
+    // setValue() does not notify the listener, so restart the threads here
+    if (state.multiThreaded != multiThreadedParam_->get()) {
+        set(multiThreadedParam_, state.multiThreaded ? 1.0f : 0.0f);
+        triggerAsyncUpdate();
+    }
 
-    // ENV2 params
-    state.setProperty("env2attack", env2AttackParam_->get(), nullptr);
-    state.setProperty("env2decay", env2DecayParam_->get(), nullptr);
-    state.setProperty("env2dest", env2DestParam_->getIndex(), nullptr);
-    state.setProperty("env2amount", env2AmountParam_->get(), nullptr);
+    // Picked up by the audio thread at the next block
+    if (state.modulationSeed != modulationSeed_.load()) {
+        modulationSeed_.store(state.modulationSeed);
+        modulationSeedChanged_.store(true);
+    }
 
-    juce::MemoryOutputStream stream(destData, false);
-    state.writeToStream(stream);
+    // ...then publish the result (as the parameters clamped it) in one go
+    pendingState_.writeBuffer() = captureState();
+    pendingState_.publish();
+    return changed;
+}
+
+void PlaitsVSTProcessor::applyPreset(const PluginState& preset, uint32_t fields)
+{
+    // Presets hold the voice settings only
+    uint64_t changed = 0;
+    {
+        const std::lock_guard<std::mutex> lock(stateWriterMutex_);
+        PluginState state = captureState();
+        if (fields & kPresetEngine) state.engine = preset.engine;
+        if (fields & kPresetHarmonics) state.harmonics = preset.harmonics;
+        if (fields & kPresetTimbre) state.timbre = preset.timbre;
+        if (fields & kPresetMorph) state.morph = preset.morph;
+        if (fields & kPresetAttack) state.attack = preset.attack;
+        if (fields & kPresetDecay) state.decay = preset.decay;
+        if (fields & kPresetPolyphony) state.polyphony = preset.polyphony;
+        changed = applyState(state);
+    }
+
+    // Loading a preset is an edit made in the plugin: report each parameter
+    // it changed as a gesture, so the host records it (automation, undo,
+    // unsaved changes) as it would a knob turn
+    for (auto* param : getParameters()) {
+        if ((changed >> param->getParameterIndex()) & 1) {
+            param->beginChangeGesture();
+            param->sendValueChangedMessageToListeners(param->getValue());
+            param->endChangeGesture();
+        }
+    }
+}
+
+void PlaitsVSTProcessor::getStateInformation(juce::MemoryBlock& destData)
+{
+    destData.setSize(PluginState::kSerializedSize);
+    captureState().write(static_cast<uint8_t*>(destData.getData()));
 }
 
 void PlaitsVSTProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    auto state = juce::ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
-    if (state.isValid())
     {
-        if (state.hasProperty("engine"))
-            *engineParam_ = static_cast<int>(state.getProperty("engine"));
-        if (state.hasProperty("harmonics"))
-            *harmonicsParam_ = static_cast<float>(state.getProperty("harmonics"));
-        if (state.hasProperty("timbre"))
-            *timbreParam_ = static_cast<float>(state.getProperty("timbre"));
-        if (state.hasProperty("morph"))
-            *morphParam_ = static_cast<float>(state.getProperty("morph"));
-        if (state.hasProperty("attack"))
-            *attackParam_ = static_cast<float>(state.getProperty("attack"));
-        if (state.hasProperty("decay"))
-            *decayParam_ = static_cast<float>(state.getProperty("decay"));
-        if (state.hasProperty("polyphony"))
-            *polyphonyParam_ = static_cast<int>(state.getProperty("polyphony"));
-
-        // Filter params
-        if (state.hasProperty("cutoff"))
-            *cutoffParam_ = static_cast<float>(state.getProperty("cutoff"));
-        if (state.hasProperty("resonance"))
-            *resonanceParam_ = static_cast<float>(state.getProperty("resonance"));
-
-        // LFO1 params
-        if (state.hasProperty("lfo1rate"))
-            *lfo1RateParam_ = static_cast<int>(state.getProperty("lfo1rate"));
-        if (state.hasProperty("lfo1shape"))
-            *lfo1ShapeParam_ = static_cast<int>(state.getProperty("lfo1shape"));
-        if (state.hasProperty("lfo1dest"))
-            *lfo1DestParam_ = static_cast<int>(state.getProperty("lfo1dest"));
-        if (state.hasProperty("lfo1amount"))
-            *lfo1AmountParam_ = static_cast<int>(state.getProperty("lfo1amount"));
-
-        // LFO2 params
-        if (state.hasProperty("lfo2rate"))
-            *lfo2RateParam_ = static_cast<int>(state.getProperty("lfo2rate"));
-        if (state.hasProperty("lfo2shape"))
-            *lfo2ShapeParam_ = static_cast<int>(state.getProperty("lfo2shape"));
-        if (state.hasProperty("lfo2dest"))
-            *lfo2DestParam_ = static_cast<int>(state.getProperty("lfo2dest"));
-        if (state.hasProperty("lfo2amount"))
-            *lfo2AmountParam_ = static_cast<int>(state.getProperty("lfo2amount"));
-
-        // ENV1 params
-        if (state.hasProperty("env1attack"))
-            *env1AttackParam_ = static_cast<float>(state.getProperty("env1attack"));
-        if (state.hasProperty("env1decay"))
-            *env1DecayParam_ = static_cast<float>(state.getProperty("env1decay"));
-        if (state.hasProperty("env1dest"))
-            *env1DestParam_ = static_cast<int>(state.getProperty("env1dest"));
-        if (state.hasProperty("env1amount"))
-            *env1AmountParam_ = static_cast<int>(state.getProperty("env1amount"));
-
-        // ENV2 params
-        if (state.hasProperty("env2attack"))
-            *env2AttackParam_ = static_cast<float>(state.getProperty("env2attack"));
-        if (state.hasProperty("env2decay"))
-            *env2DecayParam_ = static_cast<float>(state.getProperty("env2decay"));
-        if (state.hasProperty("env2dest"))
-            *env2DestParam_ = static_cast<int>(state.getProperty("env2dest"));
-        if (state.hasProperty("env2amount"))
-            *env2AmountParam_ = static_cast<int>(state.getProperty("env2amount"));
-    }
-}
-
-void PlaitsVSTProcessor::updateModulationParams()
-{
-    // LFO1
-    modMatrix_.GetLfo1().SetRate(static_cast<plaits::LfoRateDivision>(lfo1RateParam_->getIndex()));
-    modMatrix_.GetLfo1().SetShape(static_cast<plaits::LfoShape>(lfo1ShapeParam_->getIndex()));
-    modMatrix_.SetDestination(plaits::ModSource::Lfo1,
-                              static_cast<plaits::ModDestination>(lfo1DestParam_->getIndex()));
-    modMatrix_.SetAmount(plaits::ModSource::Lfo1, static_cast<int8_t>(lfo1AmountParam_->get()));
-
-    // LFO2
-    modMatrix_.GetLfo2().SetRate(static_cast<plaits::LfoRateDivision>(lfo2RateParam_->getIndex()));
-    modMatrix_.GetLfo2().SetShape(static_cast<plaits::LfoShape>(lfo2ShapeParam_->getIndex()));
-    modMatrix_.SetDestination(plaits::ModSource::Lfo2,
-                              static_cast<plaits::ModDestination>(lfo2DestParam_->getIndex()));
-    modMatrix_.SetAmount(plaits::ModSource::Lfo2, static_cast<int8_t>(lfo2AmountParam_->get()));
-
-    // ENV1 - map 0-1 to ms (0-500 attack, 10-2000 decay)
-    float env1AttackMs = env1AttackParam_->get() * 500.0f;
-    float env1DecayMs = 10.0f + env1DecayParam_->get() * 1990.0f;
-    modMatrix_.GetEnv1().SetAttack(env1AttackMs);
-    modMatrix_.GetEnv1().SetDecay(env1DecayMs);
-    modMatrix_.SetDestination(plaits::ModSource::Env1,
-                              static_cast<plaits::ModDestination>(env1DestParam_->getIndex()));
-    modMatrix_.SetAmount(plaits::ModSource::Env1, static_cast<int8_t>(env1AmountParam_->get()));
-
-    // ENV2
-    float env2AttackMs = env2AttackParam_->get() * 500.0f;
-    float env2DecayMs = 10.0f + env2DecayParam_->get() * 1990.0f;
-    modMatrix_.GetEnv2().SetAttack(env2AttackMs);
-    modMatrix_.GetEnv2().SetDecay(env2DecayMs);
-    modMatrix_.SetDestination(plaits::ModSource::Env2,
-                              static_cast<plaits::ModDestination>(env2DestParam_->getIndex()));
-    modMatrix_.SetAmount(plaits::ModSource::Env2, static_cast<int8_t>(env2AmountParam_->get()));
+        // Anything the saved data lacks keeps its current value
+        const std::lock_guard<std::mutex> lock(stateWriterMutex_);
+        PluginState state = captureState();
+
+        if (!state.read(data, static_cast<size_t>(sizeInBytes))) {
+            // Sessions saved before the binary format
+            auto tree = juce::ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
+            if (!tree.isValid()) {
+                return;
+            }
+            readLegacyState(tree, state);
+        }
+
+        applyState(state);
+    }
+
+    // The host restored the values itself, so tell it once that they have
+    // changed (for VST3, kParamValuesChanged) for it to re-read them
+    updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+}
+
+void PlaitsVSTProcessor::readLegacyState(const juce::ValueTree& tree, PluginState& state)
+{
+    auto read = [&tree](const char* key, auto& field) {
+        if (tree.hasProperty(key)) {
+            using Field = std::decay_t<decltype(field)>;
+            if constexpr (std::is_same_v<Field, float>) {
+                field = static_cast<float>(tree.getProperty(key));
+            } else if constexpr (std::is_same_v<Field, bool>) {
+                field = static_cast<bool>(tree.getProperty(key));
+            } else {
+                field = static_cast<Field>(static_cast<int>(tree.getProperty(key)));
+            }
+        }
+    };
+
+    read("engine", state.engine);
+    read("harmonics", state.harmonics);
+    read("timbre", state.timbre);
+    read("morph", state.morph);
+    read("attack", state.attack);
+    read("decay", state.decay);
+    read("polyphony", state.polyphony);
+
+    // Filter params
+    read("cutoff", state.cutoff);
+    read("resonance", state.resonance);
+    read("filtermode", state.filterMode);
+
+    // LFO params
+    read("lfo1rate", state.lfo[0].rate);
+    read("lfo1shape", state.lfo[0].shape);
+    read("lfo1dest", state.lfo[0].dest);
+    read("lfo1amount", state.lfo[0].amount);
+    read("lfo2rate", state.lfo[1].rate);
+    read("lfo2shape", state.lfo[1].shape);
+    read("lfo2dest", state.lfo[1].dest);
+    read("lfo2amount", state.lfo[1].amount);
+
+    // ENV params
+    read("env1attack", state.env[0].attack);
+    read("env1decay", state.env[0].decay);
+    read("env1dest", state.env[0].dest);
+    read("env1amount", state.env[0].amount);
+    read("env2attack", state.env[1].attack);
+    read("env2decay", state.env[1].decay);
+    read("env2dest", state.env[1].dest);
+    read("env2amount", state.env[1].amount);
+
+    // Rendering options and S&H seed
+    read("multithreaded", state.multiThreaded);
+    read("modseed", state.modulationSeed);
+}
+
+uint32_t PlaitsVSTProcessor::readPresetFields(const juce::ValueTree& tree)
+{
+    const std::pair<const char*, uint32_t> keys[] = {
+        { "engine", kPresetEngine },
+        { "harmonics", kPresetHarmonics },
+        { "timbre", kPresetTimbre },
+        { "morph", kPresetMorph },
+        { "attack", kPresetAttack },
+        { "decay", kPresetDecay },
+        { "polyphony", kPresetPolyphony }
+    };
+
+    uint32_t fields = 0;
+    for (const auto& [key, field] : keys) {
+        if (tree.hasProperty(key)) {
+            fields |= field;
+        }
+    }
+    return fields;
+}
+
+void PlaitsVSTProcessor::updateModulationParams(uint64_t dirty)
+{
+    using plaits::ModSource;
+
+    // LFO1 and LFO2
+    plaits::Lfo* lfos[2] = { &modMatrix_.GetLfo1(), &modMatrix_.GetLfo2() };
+    const ModSource lfoSources[2] = { ModSource::Lfo1, ModSource::Lfo2 };
+    for (int i = 0; i < 2; ++i) {
+        if (!(dirty & lfoParameterMask_[i])) {
+            continue;
+        }
+        const auto& lfo = params_.lfo[i];
+        lfos[i]->SetRate(static_cast<plaits::LfoRateDivision>(lfo.rate));
+        lfos[i]->SetShape(static_cast<plaits::LfoShape>(lfo.shape));
+        modMatrix_.SetDestination(lfoSources[i], static_cast<plaits::ModDestination>(lfo.dest));
+        modMatrix_.SetAmount(lfoSources[i], static_cast<int8_t>(lfo.amount));
+    }
+
+    // ENV1 and ENV2 - map 0-1 to ms (0-500 attack, 10-2000 decay)
+    plaits::ModEnvelope* envs[2] = { &modMatrix_.GetEnv1(), &modMatrix_.GetEnv2() };
+    const ModSource envSources[2] = { ModSource::Env1, ModSource::Env2 };
+    for (int i = 0; i < 2; ++i) {
+        if (!(dirty & envParameterMask_[i])) {
+            continue;
+        }
+        const auto& env = params_.env[i];
+        envs[i]->SetAttack(static_cast<uint16_t>(env.attack * 500.0f));
+        envs[i]->SetDecay(static_cast<uint16_t>(10.0f + env.decay * 1990.0f));
+        modMatrix_.SetDestination(envSources[i], static_cast<plaits::ModDestination>(env.dest));
+        modMatrix_.SetAmount(envSources[i], static_cast<int8_t>(env.amount));
+    }
 }
 
 float PlaitsVSTProcessor::getModulatedHarmonics() const
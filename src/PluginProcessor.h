@@ -4,10 +4,16 @@
 #include "dsp/voice_allocator.h"
 #include "dsp/modulation_matrix.h"
 #include "dsp/moog_filter.h"
+#include "dsp/parameter_smoother.h"
+#include "dsp/plugin_state.h"
+#include "dsp/triple_buffer.h"
+#include <mutex>
 
 class PresetManager;
 
-class PlaitsVSTProcessor : public juce::AudioProcessor
+class PlaitsVSTProcessor : public juce::AudioProcessor,
+                           private juce::AudioProcessorParameter::Listener,
+                           private juce::AsyncUpdater
 {
 public:
     PlaitsVSTProcessor();
@@ -24,7 +30,9 @@ public:
     bool acceptsMidi() const override { return true; }
     bool producesMidi() const override { return false; }
     bool isMidiEffect() const override { return false; }
-    double getTailLengthSeconds() const override { return 0.0; }
+
+    // Voices end with their envelopes, but the filters ring on after them
+    double getTailLengthSeconds() const override { return VoiceAllocator::kMaxFilterTailSeconds; }
 
     int getNumPrograms() override { return 1; }
     int getCurrentProgram() override { return 0; }
@@ -35,8 +43,32 @@ public:
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
+    // Fill the fields of state that a ValueTree (an old saved session or an
+    // XML preset) has properties for, leaving the rest as they are
+    static void readLegacyState(const juce::ValueTree& tree, PluginState& state);
+
+    // The voice settings a preset holds, as bits of applyPreset()'s fields
+    enum PresetField : uint32_t {
+        kPresetEngine = 1u << 0,
+        kPresetHarmonics = 1u << 1,
+        kPresetTimbre = 1u << 2,
+        kPresetMorph = 1u << 3,
+        kPresetAttack = 1u << 4,
+        kPresetDecay = 1u << 5,
+        kPresetPolyphony = 1u << 6,
+        kAllPresetFields = (1u << 7) - 1
+    };
+
+    // The PresetField bits an XML preset's ValueTree has properties for
+    static uint32_t readPresetFields(const juce::ValueTree& tree);
+
+    // The UI engine index (0-23) the two engine parameters select: a newer
+    // model when "Engine 2" is on, else the classic engine
+    int getEngineIndex() const;
+
     // Parameter accessors
     juce::AudioParameterChoice* getEngineParam() { return engineParam_; }
+    juce::AudioParameterChoice* getEngine2Param() { return engine2Param_; }
     juce::AudioParameterFloat* getHarmonicsParam() { return harmonicsParam_; }
     juce::AudioParameterFloat* getTimbreParam() { return timbreParam_; }
     juce::AudioParameterFloat* getMorphParam() { return morphParam_; }
@@ -47,6 +79,7 @@ public:
     // Filter params
     juce::AudioParameterFloat* getCutoffParam() { return cutoffParam_; }
     juce::AudioParameterFloat* getResonanceParam() { return resonanceParam_; }
+    juce::AudioParameterChoice* getFilterModeParam() { return filterModeParam_; }
 
     // LFO1 params
     juce::AudioParameterChoice* getLfo1RateParam() { return lfo1RateParam_; }
@@ -72,6 +105,10 @@ public:
     juce::AudioParameterChoice* getEnv2DestParam() { return env2DestParam_; }
     juce::AudioParameterInt* getEnv2AmountParam() { return env2AmountParam_; }
 
+    // Opt-in parallel voice rendering across the spare CPU cores; not
+    // automatable, as changing it restarts the render threads
+    juce::AudioParameterBool* getMultiThreadedParam() { return multiThreadedParam_; }
+
     // Modulation matrix access for UI visualization
     const plaits::ModulationMatrix& getModMatrix() const { return modMatrix_; }
 
@@ -85,17 +122,104 @@ public:
     // Preset manager
     PresetManager& getPresetManager();
 
+    // Switch to a preset's voice settings, keeping everything else; called
+    // on the message thread, and glitch-free while the audio thread runs.
+    // Settings missing from fields keep their current values
+    void applyPreset(const PluginState& preset, uint32_t fields = kAllPresetFields);
+
 private:
+    // Parameter listener: flags changed parameters, from any thread
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override {}
+
+    // Start or stop the render threads to match the multi-threaded parameter.
+    // The async update does so on the message thread when the parameter
+    // changes, with processing suspended so no render is using the threads
+    void updateRenderThreads();
+    void handleAsyncUpdate() override;
+
+    // If any parameter changed, refresh the snapshot and re-apply the settings
+    // that depend on the changed ones; a block with no changes reads nothing
+    void updateParameterSnapshot();
+
+    // Copy the parameters whose index bits are set into state
+    void readParameters(PluginState& state, uint64_t parameters = ~uint64_t(0)) const;
+
+    // Saved state: a binary PluginState, with the older ValueTree format
+    // still read for sessions saved before it
+    PluginState captureState() const;
+
+    // Set every parameter from state, and hand the audio thread the whole
+    // state at once so it never plays a half-applied one. Presets (message
+    // thread) and restored sessions (any host thread) can arrive together,
+    // so callers hold stateWriterMutex_ from reading the current state to
+    // applying the new one. The host is not notified; returns the index bits
+    // of the parameters that changed, for the caller to report
+    uint64_t applyState(const PluginState& state);
+
     void handleMidiMessage(const juce::MidiMessage& msg);
-    void updateModulationParams();
+    void renderVoices(float* left, float* right, int startSample, int endSample);
+
+    // Read tempo and song position from the host (once per block)
+    void updateTransport();
+
+    // Lock the LFOs to the song position at a sample offset into the block
+    void syncModulation(int sampleOffset);
+
+    // Evaluate modulation and push it to the voices and filter; runs once
+    // every kControlBlockSize samples, sampleOffset into the block
+    void updateControlRate(int sampleOffset);
+    void filterOutput(float* left, float* right, int startSample, int endSample);
+
+    // One control tick per internal voice block, so at the native rate each
+    // render sees exactly one set of parameters
+    static constexpr int kControlBlockSize = static_cast<int>(Voice::kInternalBlockSize);
+    // Re-apply the LFO and envelope slots whose parameters are dirty
+    void updateModulationParams(uint64_t dirty);
+
+    // Plain copy of the parameters, owned by the audio thread
+    PluginState params_;
+
+    // Complete states from applyState(), taken at the start of a block. It
+    // has one writer at a time: stateWriterMutex_, never taken by the audio
+    // thread, serialises them
+    TripleBuffer<PluginState> pendingState_;
+    std::mutex stateWriterMutex_;
+
+    // One bit per parameter index, set by the listener and cleared by the
+    // audio thread; everything starts dirty so the first block applies all
+    std::atomic<uint64_t> dirtyParameters_{~uint64_t(0)};
+    uint64_t lfoParameterMask_[2] = {};
+    uint64_t envParameterMask_[2] = {};
 
     VoiceAllocator voiceAllocator_;
     double hostSampleRate_ = 44100.0;
+    bool prepared_ = false;
+    bool voiceFilter_ = false;
+    int samplesUntilControlTick_ = 0;
+
+    // Seed for the LFOs' sample & hold, saved in the state; set from the
+    // message thread and applied on the audio thread
+    std::atomic<uint32_t> modulationSeed_{0};
+    std::atomic<bool> modulationSeedChanged_{false};
+
+    // Host transport, read at the start of each block
+    double hostBpm_ = 120.0;
+    double blockPpq_ = 0.0;
+    bool transportPlaying_ = false;
+
+    // Base values glide to parameter changes at the control rate, so jumps
+    // and automation sound the same at any host buffer size
+    static constexpr float kSmoothingMs = 10.0f;
+    plaits::ParameterSmoother harmonicsSmoother_;
+    plaits::ParameterSmoother timbreSmoother_;
+    plaits::ParameterSmoother morphSmoother_;
+    plaits::ParameterSmoother cutoffSmoother_;
+    plaits::ParameterSmoother resonanceSmoother_;
 
     // Modulation system
     plaits::ModulationMatrix modMatrix_;
     plaits::MoogFilter filter_;
-    int activeVoiceCount_ = 0;
 
     // Parameters
     juce::AudioParameterChoice* engineParam_ = nullptr;
@@ -109,6 +233,7 @@ private:
     // Filter params
     juce::AudioParameterFloat* cutoffParam_ = nullptr;
     juce::AudioParameterFloat* resonanceParam_ = nullptr;
+    juce::AudioParameterChoice* filterModeParam_ = nullptr;
 
     // LFO1 params
     juce::AudioParameterChoice* lfo1RateParam_ = nullptr;
@@ -134,6 +259,12 @@ private:
     juce::AudioParameterChoice* env2DestParam_ = nullptr;
     juce::AudioParameterInt* env2AmountParam_ = nullptr;
 
+    // Rendering options
+    juce::AudioParameterBool* multiThreadedParam_ = nullptr;
+
+    // The newer models (Off, then UI engines 16-23)
+    juce::AudioParameterChoice* engine2Param_ = nullptr;
+
     // Preset manager
     std::unique_ptr<PresetManager> presetManager_;
 
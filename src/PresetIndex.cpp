@@ -0,0 +1,216 @@
+// PresetIndex - background index of the user presets folder
+// PlaitsVST: MIT License
+
+#include "PresetIndex.h"
+#include "PluginProcessor.h"
+#include <map>
+
+namespace {
+    constexpr int kIndexMagic = 0x58444950;  // "PIDX"
+    constexpr int kIndexVersion = 2;
+}
+
+PresetIndex::PresetIndex()
+    : juce::Thread("PlaitsVST Preset Index")
+    , entries_(std::make_shared<const Entries>())
+{
+    startThread(juce::Thread::Priority::background);
+}
+
+PresetIndex::~PresetIndex()
+{
+    stopThread(2000);
+}
+
+juce::File PresetIndex::getPresetsFolder()
+{
+    auto musicFolder = juce::File::getSpecialLocation(juce::File::userMusicDirectory);
+    return musicFolder.getChildFile("PlaitsVST").getChildFile("Presets");
+}
+
+juce::File PresetIndex::getIndexFile()
+{
+    auto dataFolder = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory);
+    return dataFolder.getChildFile("PlaitsVST").getChildFile("PresetIndex.bin");
+}
+
+std::shared_ptr<const PresetIndex::Entries> PresetIndex::getEntries() const
+{
+    std::lock_guard<std::mutex> lock(entriesMutex_);
+    return entries_;
+}
+
+void PresetIndex::rescan()
+{
+    notify();
+}
+
+void PresetIndex::run()
+{
+    while (!threadShouldExit()) {
+        scan();
+        wait(-1);
+    }
+}
+
+void PresetIndex::scan()
+{
+    auto folder = getPresetsFolder();
+    if (!folder.isDirectory()) {
+        publish({});
+        return;
+    }
+
+    const juce::int64 folderModified = folder.getLastModificationTime().toMilliseconds();
+    const auto indexFile = getIndexFile();
+
+    juce::int64 cachedFolderModified = 0;
+    Entries cached;
+    bool haveIndex = readIndex(indexFile, cachedFolderModified, cached);
+
+    // Nothing has been added, removed or renamed since the index was written
+    if (haveIndex && cachedFolderModified == folderModified) {
+        publish(std::move(cached));
+        return;
+    }
+
+    std::map<juce::String, Entry*> cachedByName;
+    for (auto& entry : cached) {
+        cachedByName[entry.file.getFileName()] = &entry;
+    }
+
+    Entries entries;
+    auto files = folder.findChildFiles(juce::File::findFiles, false, "*.xml");
+    entries.reserve(static_cast<size_t>(files.size()));
+
+    for (const auto& file : files) {
+        if (threadShouldExit()) {
+            return;
+        }
+
+        const juce::int64 modified = file.getLastModificationTime().toMilliseconds();
+        auto it = cachedByName.find(file.getFileName());
+        if (it != cachedByName.end() && it->second->modified == modified) {
+            it->second->file = file;
+            entries.push_back(std::move(*it->second));
+            continue;
+        }
+
+        Entry entry;
+        entry.file = file;
+        entry.modified = modified;
+        if (readPresetFile(file, entry)) {
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    writeIndex(indexFile, folderModified, entries);
+    publish(std::move(entries));
+}
+
+bool PresetIndex::readPresetFile(const juce::File& file, Entry& entry)
+{
+    auto xml = juce::XmlDocument::parse(file);
+    if (xml == nullptr) {
+        return false;
+    }
+
+    auto tree = juce::ValueTree::fromXml(*xml);
+    if (!tree.isValid()) {
+        return false;
+    }
+
+    if (tree.hasProperty("name")) {
+        entry.name = tree.getProperty("name").toString();
+    } else {
+        entry.name = file.getFileNameWithoutExtension();
+    }
+
+    PlaitsVSTProcessor::readLegacyState(tree, entry.state);
+    entry.fields = PlaitsVSTProcessor::readPresetFields(tree);
+    return true;
+}
+
+bool PresetIndex::readIndex(const juce::File& indexFile, juce::int64& folderModified, Entries& entries)
+{
+    juce::FileInputStream stream(indexFile);
+    if (!stream.openedOk()) {
+        return false;
+    }
+
+    if (stream.readInt() != kIndexMagic || stream.readInt() != kIndexVersion) {
+        return false;
+    }
+
+    folderModified = stream.readInt64();
+    const int count = stream.readInt();
+    if (count < 0) {
+        return false;
+    }
+
+    const auto folder = getPresetsFolder();
+    uint8_t blob[PluginState::kSerializedSize];
+
+    for (int i = 0; i < count; ++i) {
+        Entry entry;
+        entry.file = folder.getChildFile(stream.readString());
+        entry.name = stream.readString();
+        entry.modified = stream.readInt64();
+
+        const int blobSize = stream.readInt();
+        if (blobSize != PluginState::kSerializedSize ||
+            stream.read(blob, blobSize) != blobSize ||
+            !entry.state.read(blob, static_cast<size_t>(blobSize))) {
+            entries.clear();
+            return false;
+        }
+        entry.fields = static_cast<uint32_t>(stream.readInt());
+        entries.push_back(std::move(entry));
+    }
+
+    return true;
+}
+
+void PresetIndex::writeIndex(const juce::File& indexFile, juce::int64 folderModified, const Entries& entries)
+{
+    if (!indexFile.getParentDirectory().createDirectory()) {
+        return;
+    }
+
+    // Written beside the old index and then swapped in, so another process
+    // never reads a partial one
+    juce::TemporaryFile temp(indexFile);
+    {
+        juce::FileOutputStream stream(temp.getFile());
+        if (!stream.openedOk()) {
+            return;
+        }
+
+        stream.writeInt(kIndexMagic);
+        stream.writeInt(kIndexVersion);
+        stream.writeInt64(folderModified);
+        stream.writeInt(static_cast<int>(entries.size()));
+
+        uint8_t blob[PluginState::kSerializedSize];
+        for (const auto& entry : entries) {
+            stream.writeString(entry.file.getFileName());
+            stream.writeString(entry.name);
+            stream.writeInt64(entry.modified);
+
+            entry.state.write(blob);
+            stream.writeInt(PluginState::kSerializedSize);
+            stream.write(blob, PluginState::kSerializedSize);
+            stream.writeInt(static_cast<int>(entry.fields));
+        }
+    }
+    temp.overwriteTargetFileWithTemporary();
+}
+
+void PresetIndex::publish(Entries entries)
+{
+    {
+        std::lock_guard<std::mutex> lock(entriesMutex_);
+        entries_ = std::make_shared<const Entries>(std::move(entries));
+    }
+    sendChangeMessage();
+}
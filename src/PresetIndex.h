@@ -0,0 +1,66 @@
+// PresetIndex - background index of the user presets folder
+// PlaitsVST: MIT License
+
+#pragma once
+
+#include <juce_events/juce_events.h>
+#include <juce_data_structures/juce_data_structures.h>
+#include "dsp/plugin_state.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Index of the user presets folder, shared by every plugin instance in the
+// process (hold it through a juce::SharedResourcePointer). The folder is
+// scanned on a background thread. The result is cached in a binary index
+// file, which stays valid while the folder's modification time is unchanged.
+// Inside a changed folder, only new or modified files are parsed again.
+// Creating the index never touches the disk. Listeners are told on the
+// message thread whenever a scan publishes new entries.
+class PresetIndex : public juce::ChangeBroadcaster,
+                    private juce::Thread
+{
+public:
+    struct Entry {
+        juce::String name;
+        juce::File file;
+        juce::int64 modified = 0;
+        PluginState state;
+
+        // The settings the file has (PlaitsVSTProcessor::PresetField bits)
+        uint32_t fields = 0;
+    };
+
+    using Entries = std::vector<Entry>;
+
+    PresetIndex();
+    ~PresetIndex() override;
+
+    // The entries from the latest scan (empty until the first one finishes)
+    std::shared_ptr<const Entries> getEntries() const;
+
+    // Scan again in the background, e.g. after saving a preset
+    void rescan();
+
+    static juce::File getPresetsFolder();
+    static juce::File getIndexFile();
+
+private:
+    void run() override;
+    void scan();
+
+    // Parse one preset file; false if it isn't a valid preset
+    static bool readPresetFile(const juce::File& file, Entry& entry);
+
+    // Index file: magic, version, folder mtime, then the entries (file name,
+    // name, mtime, state blob and fields)
+    static bool readIndex(const juce::File& indexFile, juce::int64& folderModified, Entries& entries);
+    static void writeIndex(const juce::File& indexFile, juce::int64 folderModified, const Entries& entries);
+
+    void publish(Entries entries);
+
+    mutable std::mutex entriesMutex_;
+    std::shared_ptr<const Entries> entries_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetIndex)
+};
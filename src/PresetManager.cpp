@@ -17,21 +17,45 @@ PresetManager::PresetManager(PlaitsVSTProcessor& processor)
 {
 }
 
+PresetManager::~PresetManager()
+{
+    index_->removeChangeListener(this);
+}
+
 void PresetManager::initialize()
 {
     loadFactoryPresets();
     loadUserPresets();
     rebuildPresetList();
+    index_->addChangeListener(this);
 
     if (!presets_.empty()) {
         loadPreset(0);
     }
 }
 
-juce::File PresetManager::getUserPresetsFolder()
+void PresetManager::changeListenerCallback(juce::ChangeBroadcaster*)
 {
-    auto musicFolder = juce::File::getSpecialLocation(juce::File::userMusicDirectory);
-    return musicFolder.getChildFile("PlaitsVST").getChildFile("Presets");
+    // Keep the current preset selected while the list changes around it
+    Preset current;
+    bool haveCurrent = !presets_.empty();
+    if (haveCurrent) {
+        current = presets_[static_cast<size_t>(currentPresetIndex_)];
+    }
+
+    loadUserPresets();
+    rebuildPresetList();
+
+    currentPresetIndex_ = 0;
+    if (haveCurrent) {
+        for (int i = 0; i < static_cast<int>(presets_.size()); ++i) {
+            const auto& p = presets_[static_cast<size_t>(i)];
+            if (p.isFactory == current.isFactory && p.name == current.name && p.file == current.file) {
+                currentPresetIndex_ = i;
+                break;
+            }
+        }
+    }
 }
 
 void PresetManager::loadFactoryPresets()
@@ -74,17 +98,15 @@ void PresetManager::loadFactoryPresets()
         Preset preset;
         preset.name = data.name;
         preset.isFactory = true;
+        preset.fields = PlaitsVSTProcessor::kAllPresetFields;
 
-        juce::ValueTree state("PlaitsVSTState");
-        state.setProperty("name", data.name, nullptr);
-        state.setProperty("engine", data.engine, nullptr);
-        state.setProperty("harmonics", data.harmonics, nullptr);
-        state.setProperty("timbre", data.timbre, nullptr);
-        state.setProperty("morph", data.morph, nullptr);
-        state.setProperty("attack", data.attack, nullptr);
-        state.setProperty("decay", data.decay, nullptr);
-        state.setProperty("polyphony", data.voices, nullptr);
-        preset.state = state;
+        preset.state.engine = data.engine;
+        preset.state.harmonics = data.harmonics;
+        preset.state.timbre = data.timbre;
+        preset.state.morph = data.morph;
+        preset.state.attack = data.attack;
+        preset.state.decay = data.decay;
+        preset.state.polyphony = data.voices;
 
         factoryPresets_.push_back(preset);
     }
@@ -94,37 +116,17 @@ void PresetManager::loadUserPresets()
 {
     userPresets_.clear();
 
-    auto folder = getUserPresetsFolder();
-    if (!folder.exists()) {
-        return;
-    }
-
-    auto files = folder.findChildFiles(juce::File::findFiles, false, "*.xml");
-    for (const auto& file : files) {
-        auto preset = loadPresetFromFile(file, false);
-        if (preset.state.isValid()) {
-            userPresets_.push_back(preset);
-        }
-    }
-}
-
-PresetManager::Preset PresetManager::loadPresetFromFile(const juce::File& file, bool isFactory)
-{
-    Preset preset;
-    preset.file = file;
-    preset.isFactory = isFactory;
-
-    auto xml = juce::XmlDocument::parse(file);
-    if (xml != nullptr) {
-        preset.state = juce::ValueTree::fromXml(*xml);
-        if (preset.state.hasProperty("name")) {
-            preset.name = preset.state.getProperty("name").toString();
-        } else {
-            preset.name = file.getFileNameWithoutExtension();
-        }
+    auto entries = index_->getEntries();
+    userPresets_.reserve(entries->size());
+    for (const auto& entry : *entries) {
+        Preset preset;
+        preset.name = entry.name;
+        preset.file = entry.file;
+        preset.isFactory = false;
+        preset.state = entry.state;
+        preset.fields = entry.fields;
+        userPresets_.push_back(preset);
     }
-
-    return preset;
 }
 
 void PresetManager::rebuildPresetList()
@@ -164,29 +166,7 @@ void PresetManager::loadPreset(int index)
 
 void PresetManager::applyPresetToProcessor(const Preset& preset)
 {
-    const auto& state = preset.state;
-
-    if (state.hasProperty("engine")) {
-        *processor_.getEngineParam() = static_cast<int>(state.getProperty("engine"));
-    }
-    if (state.hasProperty("harmonics")) {
-        *processor_.getHarmonicsParam() = static_cast<float>(state.getProperty("harmonics"));
-    }
-    if (state.hasProperty("timbre")) {
-        *processor_.getTimbreParam() = static_cast<float>(state.getProperty("timbre"));
-    }
-    if (state.hasProperty("morph")) {
-        *processor_.getMorphParam() = static_cast<float>(state.getProperty("morph"));
-    }
-    if (state.hasProperty("attack")) {
-        *processor_.getAttackParam() = static_cast<float>(state.getProperty("attack"));
-    }
-    if (state.hasProperty("decay")) {
-        *processor_.getDecayParam() = static_cast<float>(state.getProperty("decay"));
-    }
-    if (state.hasProperty("polyphony")) {
-        *processor_.getPolyphonyParam() = static_cast<int>(state.getProperty("polyphony"));
-    }
+    processor_.applyPreset(preset.state, preset.fields);
 }
 
 void PresetManager::nextPreset()
@@ -208,7 +188,7 @@ void PresetManager::previousPreset()
 juce::ValueTree PresetManager::captureCurrentState()
 {
     juce::ValueTree state("PlaitsVSTState");
-    state.setProperty("engine", processor_.getEngineParam()->getIndex(), nullptr);
+    state.setProperty("engine", processor_.getEngineIndex(), nullptr);
     state.setProperty("harmonics", processor_.getHarmonicsParam()->get(), nullptr);
     state.setProperty("timbre", processor_.getTimbreParam()->get(), nullptr);
     state.setProperty("morph", processor_.getMorphParam()->get(), nullptr);
@@ -228,7 +208,7 @@ juce::String PresetManager::generateRandomName()
 
 void PresetManager::saveCurrentAsNewPreset()
 {
-    auto folder = getUserPresetsFolder();
+    auto folder = PresetIndex::getPresetsFolder();
     if (!folder.exists()) {
         folder.createDirectory();
     }
@@ -260,11 +240,15 @@ void PresetManager::saveCurrentAsNewPreset()
     preset.name = name;
     preset.file = file;
     preset.isFactory = false;
-    preset.state = state;
+    PlaitsVSTProcessor::readLegacyState(state, preset.state);
+    preset.fields = PlaitsVSTProcessor::readPresetFields(state);
     userPresets_.push_back(preset);
 
     rebuildPresetList();
 
+    // Bring the shared index (and every other instance) up to date
+    index_->rescan();
+
     // Find and select the new preset
     for (int i = 0; i < static_cast<int>(presets_.size()); ++i) {
         if (presets_[static_cast<size_t>(i)].name == name) {
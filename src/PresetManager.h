@@ -2,23 +2,30 @@
 
 #include <juce_core/juce_core.h>
 #include <juce_data_structures/juce_data_structures.h>
+#include "PresetIndex.h"
 #include <vector>
 #include <random>
 
 class PlaitsVSTProcessor;
 
-class PresetManager
+class PresetManager : private juce::ChangeListener
 {
 public:
     struct Preset {
         juce::String name;
         juce::File file;
         bool isFactory;
-        juce::ValueTree state;
+        PluginState state;
+
+        // The settings the preset has (PlaitsVSTProcessor::PresetField bits)
+        uint32_t fields = 0;
     };
 
     explicit PresetManager(PlaitsVSTProcessor& processor);
+    ~PresetManager() override;
 
+    // Doesn't touch the disk: user presets are added once the shared
+    // PresetIndex has scanned them
     void initialize();
 
     // Preset access
@@ -42,17 +49,19 @@ public:
     juce::String getCurrentPresetName() const;
 
 private:
+    // The index published new entries
+    void changeListenerCallback(juce::ChangeBroadcaster*) override;
+
     void loadFactoryPresets();
     void loadUserPresets();
     void rebuildPresetList();
     juce::String generateRandomName();
-    juce::File getUserPresetsFolder();
 
-    Preset loadPresetFromFile(const juce::File& file, bool isFactory);
     void applyPresetToProcessor(const Preset& preset);
     juce::ValueTree captureCurrentState();
 
     PlaitsVSTProcessor& processor_;
+    juce::SharedResourcePointer<PresetIndex> index_;
     std::vector<Preset> factoryPresets_;
     std::vector<Preset> userPresets_;
     std::vector<Preset> presets_;  // Merged and sorted
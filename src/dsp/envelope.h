@@ -16,6 +16,7 @@ public:
 
     bool active() const { return stage_ != Stage::Idle; }
     bool done() const { return stage_ == Stage::Idle; }
+    bool decaying() const { return stage_ == Stage::Decay; }
 
 private:
     enum class Stage { Idle, Attack, Decay };
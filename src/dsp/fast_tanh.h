@@ -0,0 +1,27 @@
+// Rational tanh approximation shared by the ladder filters
+// Part of PlaitsVST - GPL v3
+
+#pragma once
+
+#include "plaits/dsp/simd_float4.h"
+
+namespace plaits {
+
+// x(27 + x^2) / (27 + 9x^2): exact at 0, and reaches +/-1 with zero slope at
+// +/-3, where the input is clamped. Cheap enough for every ladder stage.
+inline float FastTanh(float x)
+{
+    x = x < -3.0f ? -3.0f : (x > 3.0f ? 3.0f : x);
+    float x2 = x * x;
+    return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+}
+
+// Four lanes at once, with the same operations as the scalar version
+inline Float4 FastTanh(Float4 x)
+{
+    x = Max(Min(x, Float4(3.0f)), Float4(-3.0f));
+    Float4 x2 = x * x;
+    return x * (Float4(27.0f) + x2) / (Float4(27.0f) + Float4(9.0f) * x2);
+}
+
+} // namespace plaits
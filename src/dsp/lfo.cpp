@@ -2,7 +2,7 @@
 // Part of PlaitsVST - GPL v3
 
 #include "lfo.h"
-#include <cstdlib>
+#include <cmath>
 
 namespace plaits {
 
@@ -37,12 +37,24 @@ void Lfo::Init()
     rate_division_ = LfoRateDivision::Div_1_4;
     shape_ = LfoShape::Triangle;
     tempo_bpm_ = 120.0;
+    rate_scale_ = 1.0f;
+    SetSeed(kDefaultSeed);
 }
 
 void Lfo::Reset()
 {
     phase_ = 0.0f;
     sh_triggered_ = false;
+    has_song_position_ = false;
+    sh_value_ = 0.0f;
+    rng_state_ = seed_;
+}
+
+void Lfo::SetSeed(uint32_t seed)
+{
+    // xorshift never leaves zero
+    seed_ = seed != 0 ? seed : kDefaultSeed;
+    rng_state_ = seed_;
 }
 
 float Lfo::ComputePhaseIncrement(float sample_rate) const
@@ -54,7 +66,7 @@ float Lfo::ComputePhaseIncrement(float sample_rate) const
     float period_seconds = beats * 60.0f / static_cast<float>(tempo_bpm_);
 
     // Phase increment per sample
-    return 1.0f / (period_seconds * sample_rate);
+    return rate_scale_ / (period_seconds * sample_rate);
 }
 
 float Lfo::ComputeWaveform(float phase) const
@@ -94,24 +106,43 @@ float Lfo::ComputeWaveform(float phase) const
     }
 }
 
+void Lfo::SetSongPosition(double ppq)
+{
+    song_position_ = ppq;
+    has_song_position_ = true;
+}
+
 float Lfo::Process(float sample_rate, int num_samples)
 {
-    float increment = ComputePhaseIncrement(sample_rate) * static_cast<float>(num_samples);
     float old_phase = phase_;
-
-    phase_ += increment;
-
-    // Handle S&H: sample new random value at start of cycle
-    if (shape_ == LfoShape::SampleAndHold) {
-        if (phase_ >= 1.0f || (old_phase > phase_)) {
-            // New cycle started - sample new value
-            sh_value_ = (static_cast<float>(rand()) / static_cast<float>(RAND_MAX)) * 2.0f - 1.0f;
+    bool new_cycle;
+
+    if (has_song_position_) {
+        // Phase straight from the song position at the end of this step, in
+        // double precision: it never drifts, and a looping host gets the
+        // same phase every time round
+        double beats = kDivisionBeats[static_cast<int>(rate_division_)];
+        double advance = num_samples * tempo_bpm_ / (60.0 * sample_rate);
+        double cycles = (song_position_ + advance) / beats;
+        phase_ = static_cast<float>(cycles - std::floor(cycles));
+        if (phase_ >= 1.0f) {
+            phase_ = 0.0f;
+        }
+        has_song_position_ = false;
+        new_cycle = phase_ < old_phase;
+    } else {
+        phase_ += ComputePhaseIncrement(sample_rate) * static_cast<float>(num_samples);
+        new_cycle = phase_ >= 1.0f;
+
+        // Wrap phase
+        while (phase_ >= 1.0f) {
+            phase_ -= 1.0f;
         }
     }
 
-    // Wrap phase
-    while (phase_ >= 1.0f) {
-        phase_ -= 1.0f;
+    // Handle S&H: sample new random value at start of cycle
+    if (shape_ == LfoShape::SampleAndHold && new_cycle) {
+        sh_value_ = NextRandom();
     }
 
     output_ = ComputeWaveform(phase_);
@@ -43,9 +43,23 @@ public:
     void SetShape(LfoShape shape) { shape_ = shape; }
     void SetTempo(double bpm) { tempo_bpm_ = bpm; }
 
+    // Multiplier on the synced rate, for rate modulation (1 = as set)
+    void SetRateScale(float scale) { rate_scale_ = scale; }
+
+    // Seed for the sample & hold generator; Reset() restarts its sequence,
+    // so the same seed gives the same S&H values every render
+    void SetSeed(uint32_t seed);
+    uint32_t GetSeed() const { return seed_; }
+
     LfoRateDivision GetRate() const { return rate_division_; }
     LfoShape GetShape() const { return shape_; }
 
+    // Lock the next Process() to the host's song position (in quarter notes
+    // at the start of the step): the phase is derived from it instead of
+    // accumulated, and the rate scale is ignored. Call before every
+    // Process() while the transport plays; without it the LFO free-runs on.
+    void SetSongPosition(double ppq);
+
     // Process and return current value (-1 to +1)
     // num_samples: number of samples to advance (for block-based processing)
     float Process(float sample_rate, int num_samples = 1);
@@ -61,14 +75,31 @@ private:
     float ComputePhaseIncrement(float sample_rate) const;
     float ComputeWaveform(float phase) const;
 
+    // xorshift32: lock-free and private to this LFO, unlike rand()
+    float NextRandom()
+    {
+        rng_state_ ^= rng_state_ << 13;
+        rng_state_ ^= rng_state_ >> 17;
+        rng_state_ ^= rng_state_ << 5;
+        return static_cast<float>(rng_state_) / 4294967296.0f * 2.0f - 1.0f;
+    }
+
+    static constexpr uint32_t kDefaultSeed = 0x2545f491u;
+
     LfoRateDivision rate_division_ = LfoRateDivision::Div_1_4;
     LfoShape shape_ = LfoShape::Triangle;
     double tempo_bpm_ = 120.0;
+    float rate_scale_ = 1.0f;
 
     float phase_ = 0.0f;
     float output_ = 0.0f;
     float sh_value_ = 0.0f;  // Sample & hold current value
     bool sh_triggered_ = false;
+    uint32_t seed_ = kDefaultSeed;
+    uint32_t rng_state_ = kDefaultSeed;
+
+    double song_position_ = 0.0;
+    bool has_song_position_ = false;
 };
 
 } // namespace plaits
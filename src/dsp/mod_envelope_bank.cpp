@@ -0,0 +1,54 @@
+// Modulation Envelope Bank - one AD modulation envelope per voice
+// Part of PlaitsVST - GPL v3
+
+#include "mod_envelope_bank.h"
+#include <algorithm>
+#include <cmath>
+
+namespace plaits {
+
+void ModEnvelopeBank::Init()
+{
+    attack_ms_ = 10.0f;
+    decay_ms_ = 200.0f;
+    Reset();
+}
+
+void ModEnvelopeBank::Reset()
+{
+    for (int i = 0; i < kMaxVoices; ++i) {
+        phase_[i] = kIdlePhase;
+        output_[i] = 0.0f;
+    }
+}
+
+void ModEnvelopeBank::Trigger(int voice)
+{
+    if (voice >= 0 && voice < kMaxVoices) {
+        phase_[voice] = 0.0f;
+    }
+}
+
+void ModEnvelopeBank::Process(float sample_rate, int num_samples)
+{
+    // Same timing and curves as ModEnvelope::Process
+    float samples_f = static_cast<float>(num_samples);
+    float attack_increment = samples_f / std::max((attack_ms_ / 1000.0f) * sample_rate, 1.0f);
+    float decay_increment = samples_f / std::max((decay_ms_ / 1000.0f) * sample_rate, 1.0f);
+    const float curve = 4.0f;
+
+    for (int i = 0; i < kMaxVoices; ++i) {
+        float phase = phase_[i];
+
+        // The attack stops exactly at the top, so the decay starts from 1
+        phase = phase < 1.0f
+            ? std::min(phase + attack_increment, 1.0f)
+            : std::min(phase + decay_increment, kIdlePhase);
+
+        float decay = std::exp(-curve * (phase - 1.0f));
+        output_[i] = phase < 1.0f ? phase : (phase < kIdlePhase ? decay : 0.0f);
+        phase_[i] = phase;
+    }
+}
+
+} // namespace plaits
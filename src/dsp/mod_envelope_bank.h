@@ -0,0 +1,49 @@
+// Modulation Envelope Bank - one AD modulation envelope per voice
+// Part of PlaitsVST - GPL v3
+
+#pragma once
+
+namespace plaits {
+
+// kMaxVoices copies of ModEnvelope sharing attack and decay times, stored as
+// structure-of-arrays and advanced together in one branch-free loop.
+//
+// Each envelope keeps a single phase: [0, 1) is the attack, [1, 2) the decay
+// and 2 means idle, so the whole state update is a select and a min.
+class ModEnvelopeBank {
+public:
+    static constexpr int kMaxVoices = 16;
+
+    ModEnvelopeBank() = default;
+    ~ModEnvelopeBank() = default;
+
+    void Init();
+    void Reset();
+
+    // Set times in milliseconds, shared by all voices
+    void SetAttack(float attack_ms) { attack_ms_ = attack_ms; }
+    void SetDecay(float decay_ms) { decay_ms_ = decay_ms; }
+
+    // Restart one voice's envelope from the attack
+    void Trigger(int voice);
+
+    // Advance every envelope by num_samples
+    void Process(float sample_rate, int num_samples);
+
+    // Current output of one voice's envelope (0 to 1)
+    float GetOutput(int voice) const { return output_[voice]; }
+    const float* outputs() const { return output_; }
+
+    bool IsActive(int voice) const { return phase_[voice] < kIdlePhase; }
+
+private:
+    static constexpr float kIdlePhase = 2.0f;
+
+    float attack_ms_ = 10.0f;
+    float decay_ms_ = 200.0f;
+
+    alignas(16) float phase_[kMaxVoices] = {};
+    alignas(16) float output_[kMaxVoices] = {};
+};
+
+} // namespace plaits
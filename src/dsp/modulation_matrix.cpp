@@ -17,6 +17,8 @@ void ModulationMatrix::Init()
     lfo2_.Init();
     env1_.Init();
     env2_.Init();
+    voice_env1_.Init();
+    voice_env2_.Init();
 
     // Default routing
     destinations_[0] = ModDestination::Timbre;
@@ -24,16 +26,17 @@ void ModulationMatrix::Init()
     destinations_[2] = ModDestination::Harmonics;
     destinations_[3] = ModDestination::Cutoff;
 
-    for (int i = 0; i < 4; ++i) {
+    for (int i = 0; i < kNumSources; ++i) {
         amounts_[i] = 0;
         source_outputs_[i] = 0;
     }
 
-    for (int i = 0; i < static_cast<int>(ModDestination::NumDestinations); ++i) {
+    for (int i = 0; i < kNumDestinations; ++i) {
         mod_values_[i] = 0;
     }
 
     tempo_bpm_ = 120.0;
+    routing_dirty_ = true;
 }
 
 void ModulationMatrix::Reset()
@@ -42,32 +45,42 @@ void ModulationMatrix::Reset()
     lfo2_.Reset();
     env1_.Reset();
     env2_.Reset();
+    voice_env1_.Reset();
+    voice_env2_.Reset();
 
-    for (int i = 0; i < static_cast<int>(ModDestination::NumDestinations); ++i) {
+    for (int i = 0; i < kNumDestinations; ++i) {
         mod_values_[i] = 0;
+        for (int v = 0; v < kMaxVoices; ++v) {
+            voice_mod_values_[i][v] = 0;
+        }
     }
 }
 
 void ModulationMatrix::SetDestination(ModSource source, ModDestination dest)
 {
     int idx = static_cast<int>(source);
-    if (idx >= 0 && idx < 4) {
+    if (idx >= 0 && idx < kNumSources && destinations_[idx] != dest) {
         destinations_[idx] = dest;
+        routing_dirty_ = true;
     }
 }
 
 void ModulationMatrix::SetAmount(ModSource source, int8_t amount)
 {
     int idx = static_cast<int>(source);
-    if (idx >= 0 && idx < 4) {
-        amounts_[idx] = std::clamp(amount, static_cast<int8_t>(-64), static_cast<int8_t>(63));
+    if (idx >= 0 && idx < kNumSources) {
+        amount = std::clamp(amount, static_cast<int8_t>(-64), static_cast<int8_t>(63));
+        if (amounts_[idx] != amount) {
+            amounts_[idx] = amount;
+            routing_dirty_ = true;
+        }
     }
 }
 
 ModDestination ModulationMatrix::GetDestination(ModSource source) const
 {
     int idx = static_cast<int>(source);
-    if (idx >= 0 && idx < 4) {
+    if (idx >= 0 && idx < kNumSources) {
         return destinations_[idx];
     }
     return ModDestination::Timbre;
@@ -76,7 +89,7 @@ ModDestination ModulationMatrix::GetDestination(ModSource source) const
 int8_t ModulationMatrix::GetAmount(ModSource source) const
 {
     int idx = static_cast<int>(source);
-    if (idx >= 0 && idx < 4) {
+    if (idx >= 0 && idx < kNumSources) {
         return amounts_[idx];
     }
     return 0;
@@ -89,109 +102,143 @@ void ModulationMatrix::SetTempo(double bpm)
     lfo2_.SetTempo(bpm);
 }
 
+void ModulationMatrix::SetSeed(uint32_t seed)
+{
+    lfo1_.SetSeed(seed);
+    lfo2_.SetSeed(seed ^ 0x9e3779b9u);
+}
+
+void ModulationMatrix::SetSongPosition(double ppq)
+{
+    lfo1_.SetSongPosition(ppq);
+    lfo2_.SetSongPosition(ppq);
+}
+
 void ModulationMatrix::TriggerEnvelopes()
 {
     env1_.Trigger();
     env2_.Trigger();
 }
 
+void ModulationMatrix::TriggerVoice(int voice)
+{
+    voice_env1_.Trigger(voice);
+    voice_env2_.Trigger(voice);
+}
+
+void ModulationMatrix::Compile()
+{
+    for (int i = 0; i < kNumSources; ++i) {
+        for (int j = 0; j <= kNumSources; ++j) {
+            amount_gains_[i][j] = 0.0f;
+        }
+    }
+    for (int d = 0; d < kNumDestinations; ++d) {
+        for (int i = 0; i < kNumSources; ++i) {
+            routes_[d][i] = 0.0f;
+        }
+    }
+
+    for (int i = 0; i < kNumSources; ++i) {
+        float amount = amounts_[i] / 64.0f;  // Normalize to -1 to ~1
+        amount_gains_[i][kNumSources] = amount;
+
+        int dest = static_cast<int>(destinations_[i]);
+        if (dest >= 0 && dest < kNumDestinations) {
+            routes_[dest][i] = 1.0f;
+        }
+
+        // A source routed to an LFO's amount scales that LFO's own amount
+        // (at half strength); an LFO cannot modulate its own amount
+        int target = -1;
+        if (destinations_[i] == ModDestination::Lfo1Amount) {
+            target = static_cast<int>(ModSource::Lfo1);
+        } else if (destinations_[i] == ModDestination::Lfo2Amount) {
+            target = static_cast<int>(ModSource::Lfo2);
+        }
+        if (target >= 0 && target != i) {
+            amount_gains_[target][i] += amount * 0.5f;
+        }
+    }
+
+    routing_dirty_ = false;
+}
+
+void ModulationMatrix::Evaluate(const float* sources, float* mod_values) const
+{
+    // LFOs are bipolar (-1 to 1); envelopes stay unipolar (0 to 1), so a
+    // positive amount pushes the value UP when the envelope is active
+    float weighted[kNumSources];
+    for (int i = 0; i < kNumSources; ++i) {
+        float effective_amount = amount_gains_[i][kNumSources];
+        for (int j = 0; j < kNumSources; ++j) {
+            effective_amount += amount_gains_[i][j] * sources[j];
+        }
+        weighted[i] = sources[i] * effective_amount;
+    }
+
+    for (int d = 0; d < kNumDestinations; ++d) {
+        float sum = 0.0f;
+        for (int i = 0; i < kNumSources; ++i) {
+            sum += routes_[d][i] * weighted[i];
+        }
+        mod_values[d] = std::clamp(sum, -1.0f, 1.0f);
+    }
+}
+
 void ModulationMatrix::Process(float sample_rate, int num_samples)
 {
     // For efficiency, we process at a reduced control rate
     // Process once per block rather than per-sample
     // This is fine for LFOs and envelopes which are low-frequency
+    if (routing_dirty_) {
+        Compile();
+    }
 
-    // Apply any LFO rate modulation before processing LFOs
-    // Check if any mod source targets LFO rates
-    float lfo1_rate_mod = 0.0f;
-    float lfo2_rate_mod = 0.0f;
-
-    // First pass: get envelope outputs (they don't depend on LFOs)
+    // Envelopes first: they don't depend on the LFOs
     env1_.Process(sample_rate, num_samples);
     env2_.Process(sample_rate, num_samples);
     source_outputs_[2] = env1_.GetOutput();  // ENV outputs 0-1 (unipolar)
     source_outputs_[3] = env2_.GetOutput();
 
-    // Calculate rate modulation from envelopes if routed
-    for (int i = 2; i < 4; ++i) {  // ENV1 and ENV2
-        ModDestination dest = destinations_[i];
-        float amount = amounts_[i] / 64.0f;  // Normalize to -1 to ~1
-        float output = source_outputs_[i];  // Keep unipolar 0-1
-
-        if (dest == ModDestination::Lfo1Rate) {
-            lfo1_rate_mod += output * amount;
-        } else if (dest == ModDestination::Lfo2Rate) {
-            lfo2_rate_mod += output * amount;
-        }
-    }
+    // LFO rate modulation, from the new envelope values and the LFOs' last
+    // outputs, sweeps each LFO up to two octaves either side of its rate
+    Evaluate(source_outputs_, mod_values_);
+    lfo1_.SetRateScale(std::exp2(2.0f * mod_values_[static_cast<int>(ModDestination::Lfo1Rate)]));
+    lfo2_.SetRateScale(std::exp2(2.0f * mod_values_[static_cast<int>(ModDestination::Lfo2Rate)]));
 
-    // TODO: Apply rate modulation to LFOs (would need rate scaling method)
-    // For now, rate modulation affects the output amount instead
-
-    // Process LFOs
     lfo1_.Process(sample_rate, num_samples);
     lfo2_.Process(sample_rate, num_samples);
     source_outputs_[0] = lfo1_.GetOutput();  // Already -1 to 1
     source_outputs_[1] = lfo2_.GetOutput();
 
-    // Clear modulation values
-    for (int i = 0; i < static_cast<int>(ModDestination::NumDestinations); ++i) {
-        mod_values_[i] = 0;
-    }
-
-    // Calculate total modulation per destination
-    for (int i = 0; i < 4; ++i) {
-        ModDestination dest = destinations_[i];
-        float amount = amounts_[i] / 64.0f;  // Normalize to -1 to ~1
-
-        float output;
-        if (i < 2) {
-            // LFOs are already bipolar (-1 to 1)
-            output = source_outputs_[i];
-        } else {
-            // Envelopes are unipolar (0 to 1)
-            // Keep them unipolar - positive amount = add, negative = subtract
-            // This makes +amount push the value UP when envelope is active
-            output = source_outputs_[i];
-        }
-
-        // Check for amount modulation
-        float effective_amount = amount;
-        if (i == 0) {  // LFO1
-            // Check if anything modulates LFO1 Amount
-            for (int j = 0; j < 4; ++j) {
-                if (j != i && destinations_[j] == ModDestination::Lfo1Amount) {
-                    float mod_amt = amounts_[j] / 64.0f;
-                    float mod_out = (j < 2) ? source_outputs_[j] : source_outputs_[j];
-                    effective_amount += mod_out * mod_amt * 0.5f;  // Scale modulation of amount
-                }
-            }
-        } else if (i == 1) {  // LFO2
-            for (int j = 0; j < 4; ++j) {
-                if (j != i && destinations_[j] == ModDestination::Lfo2Amount) {
-                    float mod_amt = amounts_[j] / 64.0f;
-                    float mod_out = (j < 2) ? source_outputs_[j] : source_outputs_[j];
-                    effective_amount += mod_out * mod_amt * 0.5f;
-                }
-            }
-        }
-
-        int dest_idx = static_cast<int>(dest);
-        if (dest_idx >= 0 && dest_idx < static_cast<int>(ModDestination::NumDestinations)) {
-            mod_values_[dest_idx] += output * effective_amount;
+    Evaluate(source_outputs_, mod_values_);
+
+    // Per-voice envelopes, with the shared LFOs
+    voice_env1_.SetAttack(env1_.GetAttack());
+    voice_env1_.SetDecay(env1_.GetDecay());
+    voice_env2_.SetAttack(env2_.GetAttack());
+    voice_env2_.SetDecay(env2_.GetDecay());
+    voice_env1_.Process(sample_rate, num_samples);
+    voice_env2_.Process(sample_rate, num_samples);
+
+    float sources[kNumSources];
+    std::copy(source_outputs_, source_outputs_ + kNumSources, sources);
+    float values[kNumDestinations];
+    for (int v = 0; v < kMaxVoices; ++v) {
+        sources[static_cast<int>(ModSource::Env1)] = voice_env1_.GetOutput(v);
+        sources[static_cast<int>(ModSource::Env2)] = voice_env2_.GetOutput(v);
+        Evaluate(sources, values);
+        for (int d = 0; d < kNumDestinations; ++d) {
+            voice_mod_values_[d][v] = values[d];
         }
     }
-
-    // Clamp final modulation values
-    for (int i = 0; i < static_cast<int>(ModDestination::NumDestinations); ++i) {
-        mod_values_[i] = std::clamp(mod_values_[i], -1.0f, 1.0f);
-    }
 }
 
 float ModulationMatrix::GetModulation(ModDestination dest) const
 {
     int idx = static_cast<int>(dest);
-    if (idx >= 0 && idx < static_cast<int>(ModDestination::NumDestinations)) {
+    if (idx >= 0 && idx < kNumDestinations) {
         return mod_values_[idx];
     }
     return 0.0f;
@@ -205,10 +252,25 @@ float ModulationMatrix::GetModulatedValue(ModDestination dest, float base_value)
     return std::clamp(modulated, 0.0f, 1.0f);
 }
 
+float ModulationMatrix::GetVoiceModulation(int voice, ModDestination dest) const
+{
+    int idx = static_cast<int>(dest);
+    if (voice >= 0 && voice < kMaxVoices &&
+        idx >= 0 && idx < kNumDestinations) {
+        return voice_mod_values_[idx][voice];
+    }
+    return 0.0f;
+}
+
+float ModulationMatrix::GetModulatedVoiceValue(int voice, ModDestination dest, float base_value) const
+{
+    return std::clamp(base_value + GetVoiceModulation(voice, dest), 0.0f, 1.0f);
+}
+
 const char* ModulationMatrix::GetDestinationName(ModDestination dest)
 {
     int idx = static_cast<int>(dest);
-    if (idx >= 0 && idx < static_cast<int>(ModDestination::NumDestinations)) {
+    if (idx >= 0 && idx < kNumDestinations) {
         return kDestinationNames[idx];
     }
     return "???";
@@ -5,6 +5,7 @@
 
 #include "lfo.h"
 #include "mod_envelope.h"
+#include "mod_envelope_bank.h"
 
 namespace plaits {
 
@@ -31,6 +32,9 @@ enum class ModSource {
 
 class ModulationMatrix {
 public:
+    static constexpr int kNumSources = static_cast<int>(ModSource::NumSources);
+    static constexpr int kNumDestinations = static_cast<int>(ModDestination::NumDestinations);
+
     ModulationMatrix() = default;
     ~ModulationMatrix() = default;
 
@@ -59,9 +63,22 @@ public:
     // Set tempo for LFOs
     void SetTempo(double bpm);
 
+    // Seed the LFOs' sample & hold generators (each LFO gets its own stream)
+    void SetSeed(uint32_t seed);
+
+    // Lock the LFOs to the host's song position (quarter notes at the start
+    // of the next Process); see Lfo::SetSongPosition
+    void SetSongPosition(double ppq);
+
     // Trigger envelopes (call on first note after silence)
     void TriggerEnvelopes();
 
+    // Polyphonic envelopes: every voice also has its own ENV1 and ENV2,
+    // restarted by each note that voice plays. They follow the ENV1/ENV2
+    // times; the LFOs are shared by all voices.
+    static constexpr int kMaxVoices = ModEnvelopeBank::kMaxVoices;
+    void TriggerVoice(int voice);
+
     // Process all mod sources (call once per audio block)
     void Process(float sample_rate, int num_samples);
 
@@ -71,29 +88,55 @@ public:
     // Get modulated value: applies modulation to base value (0-1 normalized)
     float GetModulatedValue(ModDestination dest, float base_value) const;
 
+    // As above, with one voice's envelopes in place of the global ones
+    float GetVoiceModulation(int voice, ModDestination dest) const;
+    float GetModulatedVoiceValue(int voice, ModDestination dest, float base_value) const;
+
     // Get destination name for display
     static const char* GetDestinationName(ModDestination dest);
 
 private:
+    // Rebuild the gain matrices from destinations_ and amounts_
+    void Compile();
+
+    // Per-destination modulation (-1 to +1) for one set of source outputs
+    void Evaluate(const float* sources, float* mod_values) const;
+
     Lfo lfo1_;
     Lfo lfo2_;
     ModEnvelope env1_;
     ModEnvelope env2_;
 
     // Routing: each source has one destination and amount
-    ModDestination destinations_[4] = {
+    ModDestination destinations_[kNumSources] = {
         ModDestination::Timbre,     // LFO1 default
         ModDestination::Morph,      // LFO2 default
         ModDestination::Harmonics,  // ENV1 default
         ModDestination::Cutoff      // ENV2 default
     };
-    int8_t amounts_[4] = {0, 0, 0, 0};  // All off by default
+    int8_t amounts_[kNumSources] = {0, 0, 0, 0};  // All off by default
+
+    // Compiled routing, rebuilt only when the routing changes. With s the
+    // source outputs and a trailing 1:
+    //   effective amount = amount_gains_ * [s, 1]
+    //   modulation       = routes_ * (s .* effective amount)
+    // amount_gains_ holds each source's own amount in its last column and any
+    // LFO amount modulation in the others; routes_ is 1 where a source feeds
+    // a destination. Both are dense, so evaluation has no branches.
+    float amount_gains_[kNumSources][kNumSources + 1] = {};
+    float routes_[kNumDestinations][kNumSources] = {};
+    bool routing_dirty_ = true;
 
     // Current modulation values per destination (after processing)
-    float mod_values_[static_cast<int>(ModDestination::NumDestinations)] = {0};
+    float mod_values_[kNumDestinations] = {0};
 
     // Cache source outputs
-    float source_outputs_[4] = {0};
+    float source_outputs_[kNumSources] = {0};
+
+    // Per-voice envelopes and the modulation they produce, [destination][voice]
+    ModEnvelopeBank voice_env1_;
+    ModEnvelopeBank voice_env2_;
+    float voice_mod_values_[kNumDestinations][kMaxVoices] = {};
 
     double tempo_bpm_ = 120.0;
 };
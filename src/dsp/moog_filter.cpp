@@ -3,6 +3,7 @@
 // Part of PlaitsVST - GPL v3
 
 #include "moog_filter.h"
+#include "fast_tanh.h"
 #include <algorithm>
 
 namespace plaits {
@@ -18,23 +19,46 @@ void MoogFilter::Init(float sample_rate)
 
 void MoogFilter::Reset()
 {
-    for (int i = 0; i < 4; ++i) {
-        stage_[i] = 0.0f;
+    for (int c = 0; c < kNumChannels; ++c) {
+        for (int i = 0; i < 4; ++i) {
+            stage_[c][i] = 0.0f;
+        }
     }
-    for (int i = 0; i < 3; ++i) {
-        stage_tanh_[i] = 0.0f;
+}
+
+bool MoogFilter::IsSilent() const
+{
+    for (int c = 0; c < kNumChannels; ++c) {
+        for (int i = 0; i < 4; ++i) {
+            if (std::abs(stage_[c][i]) >= kSilenceThreshold) {
+                return false;
+            }
+        }
     }
+    return true;
 }
 
 void MoogFilter::SetCutoff(float cutoff_hz)
 {
-    cutoff_hz_ = std::clamp(cutoff_hz, 20.0f, 20000.0f);
-    UpdateCoefficients();
+    cutoff_hz = std::clamp(cutoff_hz, 20.0f, 20000.0f);
+    if (cutoff_hz != cutoff_hz_) {
+        cutoff_hz_ = cutoff_hz;
+        UpdateCoefficients();
+    }
 }
 
 void MoogFilter::SetResonance(float resonance)
 {
-    resonance_ = std::clamp(resonance, 0.0f, 1.0f);
+    resonance = std::clamp(resonance, 0.0f, 1.0f);
+    if (resonance != resonance_) {
+        resonance_ = resonance;
+        UpdateCoefficients();
+    }
+}
+
+void MoogFilter::SetSampleRate(float sample_rate)
+{
+    sample_rate_ = sample_rate;
     UpdateCoefficients();
 }
 
@@ -47,40 +71,154 @@ void MoogFilter::UpdateCoefficients()
     float wc = 2.0f * std::tan(3.14159265f * fc);
 
     // One-pole coefficient (simplified for efficiency)
-    g_ = wc / (1.0f + wc);
+    g_target_ = wc / (1.0f + wc);
 
     // Resonance feedback - scale to 0-4 range (4 = self-oscillation)
     // Slightly reduce max to prevent instability
-    k_ = resonance_ * 3.8f;
+    k_target_ = resonance_ * 3.8f;
+
+    g_ = g_target_;
+    k_ = k_target_;
+    ramp_samples_ = 0;
 }
 
-float MoogFilter::Process(float input)
+void MoogFilter::RampTo(float cutoff_hz, float resonance, size_t num_samples)
 {
-    // Soft-clip the input to prevent harsh distortion at high resonance
-    float x = input;
+    cutoff_hz = std::clamp(cutoff_hz, 20.0f, 20000.0f);
+    resonance = std::clamp(resonance, 0.0f, 1.0f);
 
-    // Feedback from output with resonance
-    float feedback = k_ * stage_[3];
+    // Already there, or on the way: no need for another tan()
+    if (cutoff_hz == cutoff_hz_ && resonance == resonance_) {
+        return;
+    }
 
-    // Soft-clip the feedback to tame self-oscillation
-    feedback = std::tanh(feedback);
+    float g = g_;
+    float k = k_;
 
-    // Input minus feedback
-    float u = x - feedback;
+    cutoff_hz_ = cutoff_hz;
+    resonance_ = resonance;
+    UpdateCoefficients();
 
-    // Soft-clip the input to the ladder
-    u = std::tanh(u);
+    if (num_samples > 0) {
+        g_increment_ = (g_target_ - g) / static_cast<float>(num_samples);
+        k_increment_ = (k_target_ - k) / static_cast<float>(num_samples);
+        g_ = g;
+        k_ = k;
+        ramp_samples_ = num_samples;
+    }
+}
+
+float MoogFilter::Process(float input)
+{
+    AdvanceRamp();
+    return ProcessChannel(0, input);
+}
+
+float MoogFilter::ProcessChannel(int channel, float input)
+{
+    float* stage = stage_[channel];
+
+    // Feedback from output with resonance, soft-clipped to tame
+    // self-oscillation
+    float feedback = FastTanh(k_ * stage[3]);
+
+    // Input minus feedback, soft-clipped into the ladder
+    float u = FastTanh(input - feedback);
 
     // 4 cascaded one-pole lowpass filters
     // Each stage: y = y + g * (tanh(x) - tanh(y))
     // Using tanh for nonlinear saturation like analog Moog
+    float t0 = FastTanh(stage[0]);
+    float t1 = FastTanh(stage[1]);
+    float t2 = FastTanh(stage[2]);
+    float t3 = FastTanh(stage[3]);
 
-    stage_[0] += g_ * (u - std::tanh(stage_[0]));
-    stage_[1] += g_ * (std::tanh(stage_[0]) - std::tanh(stage_[1]));
-    stage_[2] += g_ * (std::tanh(stage_[1]) - std::tanh(stage_[2]));
-    stage_[3] += g_ * (std::tanh(stage_[2]) - std::tanh(stage_[3]));
+    stage[0] += g_ * (u - t0);
+    stage[1] += g_ * (FastTanh(stage[0]) - t1);
+    stage[2] += g_ * (FastTanh(stage[1]) - t2);
+    stage[3] += g_ * (FastTanh(stage[2]) - t3);
+
+    return stage[3];
+}
+
+namespace {
+    // One sample through the ladder, lanes 0 and 1 for the left and right
+    // channels; s holds the four stages
+    inline Float4 ladderStep(Float4 x, Float4* s, Float4 g, Float4 k)
+    {
+        Float4 feedback = FastTanh(k * s[3]);
+        Float4 u = FastTanh(x - feedback);
+
+        Float4 t0 = FastTanh(s[0]);
+        Float4 t1 = FastTanh(s[1]);
+        Float4 t2 = FastTanh(s[2]);
+        Float4 t3 = FastTanh(s[3]);
+
+        s[0] += g * (u - t0);
+        s[1] += g * (FastTanh(s[0]) - t1);
+        s[2] += g * (FastTanh(s[1]) - t2);
+        s[3] += g * (FastTanh(s[2]) - t3);
+        return s[3];
+    }
+}
 
-    return stage_[3];
+void MoogFilter::Process(float* left, float* right, size_t size)
+{
+    // The ladder is a per-sample recurrence, so with two channels lanes 2
+    // and 3 stay idle at zero
+    Float4 s[4];
+    for (int i = 0; i < 4; ++i) {
+        s[i] = Float4::Set(stage_[0][i], stage_[1][i], 0.0f, 0.0f);
+    }
+    Float4 g(g_);
+    Float4 k(k_);
+
+    auto step = [&] {
+        if (ramp_samples_ > 0) {
+            AdvanceRamp();
+            g = Float4(g_);
+            k = Float4(k_);
+        }
+    };
+
+    // Four samples at a time: transpose the channels' blocks so each vector
+    // holds one sample of both, and back
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        Float4 a = Float4::Load(left + i);
+        Float4 b = Float4::Load(right + i);
+        Float4 c(0.0f);
+        Float4 d(0.0f);
+        Transpose(a, b, c, d);
+
+        step();
+        a = ladderStep(a, s, g, k);
+        step();
+        b = ladderStep(b, s, g, k);
+        step();
+        c = ladderStep(c, s, g, k);
+        step();
+        d = ladderStep(d, s, g, k);
+
+        Transpose(a, b, c, d);
+        a.Store(left + i);
+        b.Store(right + i);
+    }
+
+    for (; i < size; ++i) {
+        step();
+        float out[4];
+        ladderStep(Float4::Set(left[i], right[i], 0.0f, 0.0f), s, g, k).Store(out);
+        left[i] = out[0];
+        right[i] = out[1];
+    }
+
+    float state[4][4];
+    for (int i = 0; i < 4; ++i) {
+        s[i].Store(state[i]);
+        stage_[0][i] = state[i][0];
+        stage_[1][i] = state[i][1];
+    }
 }
 
 } // namespace plaits
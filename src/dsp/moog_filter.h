@@ -4,6 +4,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 
 namespace plaits {
 
@@ -15,18 +16,30 @@ public:
     void Init(float sample_rate);
     void Reset();
 
-    // Set cutoff frequency in Hz (20-20000)
+    // Set cutoff frequency in Hz (20-20000); unchanged values cost nothing
     void SetCutoff(float cutoff_hz);
 
     // Set resonance (0-1, where 1 is self-oscillation)
     void SetResonance(float resonance);
 
+    // Glide to new settings over num_samples, interpolating the coefficients
+    // per sample so control-rate modulation does not step
+    void RampTo(float cutoff_hz, float resonance, size_t num_samples);
+
     // Set sample rate (call if it changes)
-    void SetSampleRate(float sample_rate) { sample_rate_ = sample_rate; }
+    void SetSampleRate(float sample_rate);
 
-    // Process a single sample
+    // Process a single sample through the left channel
     float Process(float input);
 
+    // Process a stereo block in place; each channel has its own ladder state
+    // and both run side by side in the lanes of a Float4
+    void Process(float* left, float* right, size_t size);
+
+    // True once the filter has stopped ringing: with a silent input it would
+    // only output silence, so it can be skipped
+    bool IsSilent() const;
+
     // Get current settings
     float GetCutoff() const { return cutoff_hz_; }
     float GetResonance() const { return resonance_; }
@@ -34,17 +47,41 @@ public:
 private:
     void UpdateCoefficients();
 
+    static constexpr float kSilenceThreshold = 1.0e-6f;
+    static constexpr int kNumChannels = 2;
+
+    float ProcessChannel(int channel, float input);
+
+    // Advance an active coefficient ramp by one sample
+    void AdvanceRamp()
+    {
+        if (ramp_samples_ > 0) {
+            g_ += g_increment_;
+            k_ += k_increment_;
+            if (--ramp_samples_ == 0) {
+                g_ = g_target_;
+                k_ = k_target_;
+            }
+        }
+    }
+
     float sample_rate_ = 44100.0f;
     float cutoff_hz_ = 10000.0f;
     float resonance_ = 0.0f;
 
-    // Filter state - 4 cascaded one-pole sections
-    float stage_[4] = {0, 0, 0, 0};
-    float stage_tanh_[3] = {0, 0, 0};
+    // Filter state - 4 cascaded one-pole sections per channel
+    float stage_[kNumChannels][4] = {};
 
     // Coefficients
     float g_ = 0.0f;      // Cutoff coefficient
     float k_ = 0.0f;      // Resonance coefficient (feedback)
+
+    // Coefficient ramp
+    float g_target_ = 0.0f;
+    float k_target_ = 0.0f;
+    float g_increment_ = 0.0f;
+    float k_increment_ = 0.0f;
+    size_t ramp_samples_ = 0;
 };
 
 } // namespace plaits
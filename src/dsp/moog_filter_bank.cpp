@@ -0,0 +1,306 @@
+// Bank of Moog-style ladder filters, one per voice
+// Part of PlaitsVST - GPL v3
+
+#include "moog_filter_bank.h"
+#include "fast_tanh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace plaits {
+
+void MoogFilterBank::Init(float sample_rate)
+{
+    sample_rate_ = sample_rate;
+    for (int i = 0; i < kMaxFilters; ++i) {
+        cutoff_hz_[i] = 10000.0f;
+        resonance_[i] = 0.0f;
+        UpdateCoefficients(i);
+    }
+    Reset();
+}
+
+void MoogFilterBank::Reset()
+{
+    for (int i = 0; i < kMaxFilters; ++i) {
+        Reset(i);
+    }
+}
+
+void MoogFilterBank::Reset(int filter)
+{
+    for (int c = 0; c < kNumChannels; ++c) {
+        for (int s = 0; s < 4; ++s) {
+            stage_[c][s][filter] = 0.0f;
+        }
+    }
+}
+
+void MoogFilterBank::SetCutoff(int filter, float cutoff_hz)
+{
+    cutoff_hz = std::clamp(cutoff_hz, 20.0f, 20000.0f);
+    if (cutoff_hz != cutoff_hz_[filter]) {
+        cutoff_hz_[filter] = cutoff_hz;
+        UpdateCoefficients(filter);
+    }
+}
+
+void MoogFilterBank::SetResonance(int filter, float resonance)
+{
+    resonance = std::clamp(resonance, 0.0f, 1.0f);
+    if (resonance != resonance_[filter]) {
+        resonance_[filter] = resonance;
+        UpdateCoefficients(filter);
+    }
+}
+
+void MoogFilterBank::SetTarget(int filter, float cutoff_hz, float resonance)
+{
+    cutoff_hz = std::clamp(cutoff_hz, 20.0f, 20000.0f);
+    resonance = std::clamp(resonance, 0.0f, 1.0f);
+    if (cutoff_hz != cutoff_hz_[filter] || resonance != resonance_[filter]) {
+        cutoff_hz_[filter] = cutoff_hz;
+        resonance_[filter] = resonance;
+        UpdateTargets(filter);
+    }
+}
+
+void MoogFilterBank::Glide(size_t num_samples)
+{
+    if (num_samples == 0) {
+        std::copy(g_target_, g_target_ + kMaxFilters, g_);
+        std::copy(k_target_, k_target_ + kMaxFilters, k_);
+        ramp_samples_ = 0;
+        return;
+    }
+
+    float scale = 1.0f / static_cast<float>(num_samples);
+    for (int i = 0; i < kMaxFilters; ++i) {
+        g_increment_[i] = (g_target_[i] - g_[i]) * scale;
+        k_increment_[i] = (k_target_[i] - k_[i]) * scale;
+    }
+    ramp_samples_ = num_samples;
+}
+
+void MoogFilterBank::UpdateTargets(int filter)
+{
+    // Same mapping as MoogFilter::UpdateCoefficients
+    float fc = cutoff_hz_[filter] / sample_rate_;
+    float wc = 2.0f * std::tan(3.14159265f * fc);
+    g_target_[filter] = wc / (1.0f + wc);
+    k_target_[filter] = resonance_[filter] * 3.8f;
+}
+
+void MoogFilterBank::UpdateCoefficients(int filter)
+{
+    UpdateTargets(filter);
+    g_[filter] = g_target_[filter];
+    k_[filter] = k_target_[filter];
+    g_increment_[filter] = 0.0f;
+    k_increment_[filter] = 0.0f;
+}
+
+void MoogFilterBank::Process(float* const* left, float* const* right,
+                             const bool* active, size_t size)
+{
+    // The gliding part of the block runs with per-sample coefficient steps
+    const size_t ramp = std::min(size, ramp_samples_);
+
+    for (int group = 0; group < kMaxFilters / kGroupSize; ++group) {
+        const int base = group * kGroupSize;
+
+        bool anyActive = false;
+        for (int i = base; i < base + kGroupSize; ++i) {
+            anyActive = anyActive || active[i];
+        }
+        if (!anyActive) {
+            // Skipped groups still glide, all at once
+            for (int i = base; i < base + kGroupSize; ++i) {
+                g_[i] += g_increment_[i] * static_cast<float>(ramp);
+                k_[i] += k_increment_[i] * static_cast<float>(ramp);
+            }
+            continue;
+        }
+
+        for (int i = base; i < base + kGroupSize; ++i) {
+            if (!active[i]) {
+                std::memset(left[i], 0, size * sizeof(float));
+                std::memset(right[i], 0, size * sizeof(float));
+            }
+        }
+
+        if (ramp > 0) {
+            ProcessGroup(group, left, right, 0, ramp, true);
+        }
+        if (size > ramp) {
+            ProcessGroup(group, left, right, ramp, size - ramp, false);
+        }
+    }
+
+    // Land exactly on the targets
+    if (ramp > 0) {
+        ramp_samples_ -= ramp;
+        if (ramp_samples_ == 0) {
+            std::copy(g_target_, g_target_ + kMaxFilters, g_);
+            std::copy(k_target_, k_target_ + kMaxFilters, k_);
+        }
+    }
+}
+
+void MoogFilterBank::ProcessFilter(int filter, float* left, float* right, size_t size)
+{
+    constexpr size_t kChunkSize = 32;
+    const int group = filter / kGroupSize;
+    const int base = group * kGroupSize;
+
+    // The group runs as a whole: the other filters run on scratch silence
+    // and get their state back afterwards
+    float saved[kNumChannels][4][kGroupSize];
+    for (int c = 0; c < kNumChannels; ++c) {
+        for (int s = 0; s < 4; ++s) {
+            std::copy(&stage_[c][s][base], &stage_[c][s][base] + kGroupSize, saved[c][s]);
+        }
+    }
+
+    float scratch[kGroupSize][kNumChannels][kChunkSize];
+    float* lefts[kMaxFilters] = {};
+    float* rights[kMaxFilters] = {};
+    for (size_t done = 0; done < size; done += kChunkSize) {
+        const size_t chunk = std::min(kChunkSize, size - done);
+        std::memset(scratch, 0, sizeof(scratch));
+        for (int i = 0; i < kGroupSize; ++i) {
+            lefts[base + i] = scratch[i][0];
+            rights[base + i] = scratch[i][1];
+        }
+        lefts[filter] = left + done;
+        rights[filter] = right + done;
+        ProcessGroup(group, lefts, rights, 0, chunk, false);
+    }
+
+    for (int c = 0; c < kNumChannels; ++c) {
+        for (int s = 0; s < 4; ++s) {
+            for (int i = 0; i < kGroupSize; ++i) {
+                if (base + i != filter) {
+                    stage_[c][s][base + i] = saved[c][s][i];
+                }
+            }
+        }
+    }
+}
+
+namespace {
+    // One sample through four ladders; s holds the four stages
+    inline Float4 ladderStep(Float4 x, Float4* s, Float4 g, Float4 k)
+    {
+        Float4 feedback = FastTanh(k * s[3]);
+        Float4 u = FastTanh(x - feedback);
+
+        Float4 t0 = FastTanh(s[0]);
+        Float4 t1 = FastTanh(s[1]);
+        Float4 t2 = FastTanh(s[2]);
+        Float4 t3 = FastTanh(s[3]);
+
+        s[0] += g * (u - t0);
+        s[1] += g * (FastTanh(s[0]) - t1);
+        s[2] += g * (FastTanh(s[1]) - t2);
+        s[3] += g * (FastTanh(s[2]) - t3);
+        return s[3];
+    }
+}
+
+void MoogFilterBank::ProcessGroup(int group, float* const* left, float* const* right,
+                                  size_t offset, size_t size, bool ramping)
+{
+    const int base = group * kGroupSize;
+    Float4 g = Float4::Load(&g_[base]);
+    Float4 k = Float4::Load(&k_[base]);
+    const Float4 g_increment = Float4::Load(&g_increment_[base]);
+    const Float4 k_increment = Float4::Load(&k_increment_[base]);
+
+    // One coefficient step per sample while gliding
+    auto step = [&] {
+        if (ramping) {
+            g += g_increment;
+            k += k_increment;
+        }
+    };
+
+    Float4 sl[4], sr[4];
+    for (int s = 0; s < 4; ++s) {
+        sl[s] = Float4::Load(&stage_[0][s][base]);
+        sr[s] = Float4::Load(&stage_[1][s][base]);
+    }
+
+    float* l0 = left[base] + offset;
+    float* l1 = left[base + 1] + offset;
+    float* l2 = left[base + 2] + offset;
+    float* l3 = left[base + 3] + offset;
+    float* r0 = right[base] + offset;
+    float* r1 = right[base + 1] + offset;
+    float* r2 = right[base + 2] + offset;
+    float* r3 = right[base + 3] + offset;
+
+    // Four samples of four voices at a time: transpose so each vector holds
+    // one sample of every voice, then run the two channels' ladders together
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        Float4 a = Float4::Load(l0 + i);
+        Float4 b = Float4::Load(l1 + i);
+        Float4 c = Float4::Load(l2 + i);
+        Float4 d = Float4::Load(l3 + i);
+        Float4 e = Float4::Load(r0 + i);
+        Float4 f = Float4::Load(r1 + i);
+        Float4 h = Float4::Load(r2 + i);
+        Float4 j = Float4::Load(r3 + i);
+        Transpose(a, b, c, d);
+        Transpose(e, f, h, j);
+
+        step();
+        a = ladderStep(a, sl, g, k);
+        e = ladderStep(e, sr, g, k);
+        step();
+        b = ladderStep(b, sl, g, k);
+        f = ladderStep(f, sr, g, k);
+        step();
+        c = ladderStep(c, sl, g, k);
+        h = ladderStep(h, sr, g, k);
+        step();
+        d = ladderStep(d, sl, g, k);
+        j = ladderStep(j, sr, g, k);
+
+        Transpose(a, b, c, d);
+        Transpose(e, f, h, j);
+        a.Store(l0 + i);
+        b.Store(l1 + i);
+        c.Store(l2 + i);
+        d.Store(l3 + i);
+        e.Store(r0 + i);
+        f.Store(r1 + i);
+        h.Store(r2 + i);
+        j.Store(r3 + i);
+    }
+
+    for (; i < size; ++i) {
+        step();
+        float out[4];
+        ladderStep(Float4::Set(l0[i], l1[i], l2[i], l3[i]), sl, g, k).Store(out);
+        l0[i] = out[0];
+        l1[i] = out[1];
+        l2[i] = out[2];
+        l3[i] = out[3];
+        ladderStep(Float4::Set(r0[i], r1[i], r2[i], r3[i]), sr, g, k).Store(out);
+        r0[i] = out[0];
+        r1[i] = out[1];
+        r2[i] = out[2];
+        r3[i] = out[3];
+    }
+
+    for (int s = 0; s < 4; ++s) {
+        sl[s].Store(&stage_[0][s][base]);
+        sr[s].Store(&stage_[1][s][base]);
+    }
+    g.Store(&g_[base]);
+    k.Store(&k_[base]);
+}
+
+} // namespace plaits
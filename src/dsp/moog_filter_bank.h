@@ -0,0 +1,75 @@
+// Bank of Moog-style ladder filters, one per voice
+// Part of PlaitsVST - GPL v3
+
+#pragma once
+
+#include <cstddef>
+
+namespace plaits {
+
+// Up to kMaxFilters stereo ladders with the same model as MoogFilter, run
+// four at a time in the lanes of a Float4. State and coefficients are stored as
+// structure-of-arrays so each group of four loads as whole vectors.
+class MoogFilterBank {
+public:
+    static constexpr int kMaxFilters = 16;
+    static constexpr int kGroupSize = 4;
+
+    MoogFilterBank() = default;
+    ~MoogFilterBank() = default;
+
+    void Init(float sample_rate);
+    void Reset();
+    void Reset(int filter);
+
+    // Per-filter settings, as for MoogFilter; these take effect at once
+    void SetCutoff(int filter, float cutoff_hz);
+    void SetResonance(int filter, float resonance);
+
+    // Glide instead: SetTarget() sets where a filter should go, and Glide()
+    // moves every filter's coefficients linearly to its target over the
+    // next num_samples processed (as MoogFilter::RampTo)
+    void SetTarget(int filter, float cutoff_hz, float resonance);
+    void Glide(size_t num_samples);
+
+    float GetCutoff(int filter) const { return cutoff_hz_[filter]; }
+    float GetResonance(int filter) const { return resonance_[filter]; }
+
+    // Filter each active filter's stereo buffer in place (left[i], right[i]
+    // belong to filter i). Groups with no active filter are skipped; inactive
+    // filters in a processed group have their buffers cleared and run on
+    // silence.
+    void Process(float* const* left, float* const* right, const bool* active, size_t size);
+
+    // Filter one filter's stereo buffer in place on its own, at its current
+    // coefficients. The other filters and the glide are left as they were,
+    // for a voice that starts within audio the bank has already processed.
+    void ProcessFilter(int filter, float* left, float* right, size_t size);
+
+private:
+    void UpdateTargets(int filter);
+    void UpdateCoefficients(int filter);
+    void ProcessGroup(int group, float* const* left, float* const* right,
+                      size_t offset, size_t size, bool ramping);
+
+    static constexpr int kNumChannels = 2;
+
+    float sample_rate_ = 44100.0f;
+    float cutoff_hz_[kMaxFilters] = {};
+    float resonance_[kMaxFilters] = {};
+
+    alignas(16) float g_[kMaxFilters] = {};
+    alignas(16) float k_[kMaxFilters] = {};
+
+    // Coefficient glide, shared length for the whole bank
+    alignas(16) float g_target_[kMaxFilters] = {};
+    alignas(16) float k_target_[kMaxFilters] = {};
+    alignas(16) float g_increment_[kMaxFilters] = {};
+    alignas(16) float k_increment_[kMaxFilters] = {};
+    size_t ramp_samples_ = 0;
+
+    // [channel][ladder stage][filter]
+    alignas(16) float stage_[kNumChannels][4][kMaxFilters] = {};
+};
+
+} // namespace plaits
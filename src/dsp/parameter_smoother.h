@@ -0,0 +1,42 @@
+// Parameter Smoother - one-pole glide for control-rate parameters
+// Part of PlaitsVST - GPL v3
+
+#pragma once
+
+#include <cmath>
+
+namespace plaits {
+
+// Exponential approach to a target, advanced once per control tick. The
+// coefficient is derived from the tick length, so the glide takes the same
+// time whatever the host buffer size.
+class ParameterSmoother {
+public:
+    ParameterSmoother() = default;
+    ~ParameterSmoother() = default;
+
+    // time_ms is the time constant (~63% of the way to a new target)
+    void Init(float sample_rate, float time_ms, int step_samples)
+    {
+        float steps = time_ms * 0.001f * sample_rate / static_cast<float>(step_samples);
+        coefficient_ = steps > 1.0f ? 1.0f - std::exp(-1.0f / steps) : 1.0f;
+    }
+
+    // Jump straight to a value
+    void Reset(float value) { value_ = value; }
+
+    // Move one tick towards the target and return the new value
+    float Process(float target)
+    {
+        value_ += coefficient_ * (target - value_);
+        return value_;
+    }
+
+    float GetValue() const { return value_; }
+
+private:
+    float coefficient_ = 1.0f;
+    float value_ = 0.0f;
+};
+
+} // namespace plaits
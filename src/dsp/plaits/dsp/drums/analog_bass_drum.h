@@ -82,11 +82,11 @@ class AnalogBassDrum {
       float self_fm_amount,
       float* out,
       size_t size) {
-    const int kTriggerPulseDuration = 1.0e-3f * kSampleRate;
-    const int kFMPulseDuration = 6.0e-3f * kSampleRate;
-    const float kPulseDecayTime = 0.2e-3f * kSampleRate;
-    const float kPulseFilterTime = 0.1e-3f * kSampleRate;
-    const float kRetrigPulseDuration = 0.05f * kSampleRate;
+    const int kTriggerPulseDuration = 1.0e-3f * SampleRate();
+    const int kFMPulseDuration = 6.0e-3f * SampleRate();
+    const float kPulseDecayTime = 0.2e-3f * SampleRate();
+    const float kPulseFilterTime = 0.1e-3f * SampleRate();
+    const float kRetrigPulseDuration = 0.05f * SampleRate();
     
     const float scale = 0.001f / f0;
     const float q = 1500.0f * stmlib::SemitonesToRatio(decay * 80.0f);
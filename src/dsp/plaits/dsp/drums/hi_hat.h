@@ -110,12 +110,12 @@ class RingModNoise {
   
   void Render(float f0, float* temp_1, float* temp_2, float* out, size_t size) {
     const float ratio = f0 / (0.01f + f0);
-    const float f1a = 200.0f / kSampleRate * ratio;
-    const float f1b = 7530.0f / kSampleRate * ratio;
-    const float f2a = 510.0f / kSampleRate * ratio;
-    const float f2b = 8075.0f / kSampleRate * ratio;
-    const float f3a = 730.0f / kSampleRate * ratio;
-    const float f3b = 10500.0f / kSampleRate * ratio;
+    const float f1a = 200.0f / SampleRate() * ratio;
+    const float f1b = 7530.0f / SampleRate() * ratio;
+    const float f2a = 510.0f / SampleRate() * ratio;
+    const float f2b = 8075.0f / SampleRate() * ratio;
+    const float f3a = 730.0f / SampleRate() * ratio;
+    const float f3b = 10500.0f / SampleRate() * ratio;
     const float f[3][2] = { { f1a, f1b }, { f2a, f2b }, { f3a, f3b } };
     
     std::fill(&out[0], &out[size], 0.0f);
@@ -206,9 +206,9 @@ class HiHat {
     metallic_noise_.Render(2.0f * f0, temp_1, temp_2, out, size);
 
     // Apply BPF on the metallic noise.
-    float cutoff = 150.0f / kSampleRate * stmlib::SemitonesToRatio(
+    float cutoff = 150.0f / SampleRate() * stmlib::SemitonesToRatio(
         tone * 72.0f);
-    CONSTRAIN(cutoff, 0.0f, 16000.0f / kSampleRate);
+    CONSTRAIN(cutoff, 0.0f, 16000.0f / SampleRate());
     noise_coloration_svf_.set_f_q<stmlib::FREQUENCY_ACCURATE>(
         cutoff, resonance ? 3.0f + 3.0f * tone : 1.0f);
     noise_coloration_svf_.Process<stmlib::FILTER_MODE_BAND_PASS>(
@@ -48,7 +48,7 @@ class SyntheticBassDrumClick {
     lp_ = 0.0f;
     hp_ = 0.0f;
     filter_.Init();
-    filter_.set_f_q<stmlib::FREQUENCY_FAST>(5000.0f / kSampleRate, 2.0f);
+    filter_.set_f_q<stmlib::FREQUENCY_FAST>(5000.0f / SampleRate(), 2.0f);
   }
   
   float Process(float in) {
@@ -146,11 +146,11 @@ class SyntheticBassDrum {
     dirtiness *= std::max(1.0f - 8.0f * f0, 0.0f);
     
     const float fm_decay = 1.0f - \
-        1.0f / (0.008f * (1.0f + fm_envelope_decay * 4.0f) * kSampleRate);
+        1.0f / (0.008f * (1.0f + fm_envelope_decay * 4.0f) * SampleRate());
 
-    const float body_env_decay = 1.0f - 1.0f / (0.02f * kSampleRate) * \
+    const float body_env_decay = 1.0f - 1.0f / (0.02f * SampleRate()) * \
         stmlib::SemitonesToRatio(-decay * 60.0f);
-    const float transient_env_decay = 1.0f - 1.0f / (0.005f * kSampleRate);
+    const float transient_env_decay = 1.0f - 1.0f / (0.005f * SampleRate());
     const float tone_f = std::min(
         4.0f * f0 * stmlib::SemitonesToRatio(tone * 108.0f),
         1.0f);
@@ -159,8 +159,8 @@ class SyntheticBassDrum {
     if (trigger) {
       fm_ = 1.0f;
       body_env_ = transient_env_ = 0.3f + 0.7f * accent;
-      body_env_pulse_width_ = kSampleRate * 0.001f;
-      fm_pulse_width_ = kSampleRate * 0.0013f;
+      body_env_pulse_width_ = SampleRate() * 0.001f;
+      fm_pulse_width_ = SampleRate() * 0.0013f;
     }
     
     stmlib::ParameterInterpolator sustain_gain(
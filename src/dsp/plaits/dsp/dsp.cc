@@ -0,0 +1,48 @@
+// Copyright 2016 Emilie Gillet.
+//
+// Author: Emilie Gillet (emilie.o.gillet@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 
+// See http://creativecommons.org/licenses/MIT/ for more information.
+//
+// -----------------------------------------------------------------------------
+//
+// Utility DSP routines.
+
+#include "plaits/dsp/dsp.h"
+
+namespace plaits {
+
+const SampleRateSettings kDefaultSampleRateSettings = {
+  kDefaultSampleRate,
+  kDefaultSampleRate * kSampleRateCorrection,
+  (440.0f / 8.0f) / (kDefaultSampleRate * kSampleRateCorrection)
+};
+
+thread_local const SampleRateSettings* current_sample_rate_settings = \
+    &kDefaultSampleRateSettings;
+
+void SampleRateSettings::Init(float rate) {
+  sample_rate = rate;
+  corrected_sample_rate = rate * kSampleRateCorrection;
+  a0 = (440.0f / 8.0f) / corrected_sample_rate;
+}
+
+}  // namespace plaits
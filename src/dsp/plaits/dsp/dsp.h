@@ -33,7 +33,7 @@
 
 namespace plaits {
   
-static const float kSampleRate = 48000.0f;
+static const float kDefaultSampleRate = 48000.0f;
 
 // There is no proper PLL for I2S, only a divider on the system clock to derive
 // the bit clock.
@@ -44,8 +44,53 @@ static const float kSampleRate = 48000.0f;
 //
 // That's only 4.6 cts of error, but we care!
 
-static const float kCorrectedSampleRate = 47872.34f;
-const float a0 = (440.0f / 8.0f) / kCorrectedSampleRate;
+static const float kSampleRateCorrection = 47872.34f / kDefaultSampleRate;
+
+// The rendering sample rate is configurable at run time, so that voices can
+// render directly at the host rate. Each thread renders at the settings that
+// a ScopedSampleRate installs for the lifetime of a scope (the default rate
+// outside any), so voices at different rates can render side by side. The
+// settings must be in place for Voice::Init() and for every render, since
+// some engines derive their coefficients from them during initialization.
+// The hardware tuning correction is preserved at every rate.
+struct SampleRateSettings {
+  float sample_rate;
+  float corrected_sample_rate;
+  float a0;
+
+  void Init(float rate);
+};
+
+extern const SampleRateSettings kDefaultSampleRateSettings;
+extern thread_local const SampleRateSettings* current_sample_rate_settings;
+
+class ScopedSampleRate {
+ public:
+  explicit ScopedSampleRate(const SampleRateSettings* settings)
+      : previous_(current_sample_rate_settings) {
+    current_sample_rate_settings = settings;
+  }
+  ~ScopedSampleRate() {
+    current_sample_rate_settings = previous_;
+  }
+
+ private:
+  const SampleRateSettings* previous_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedSampleRate);
+};
+
+inline float SampleRate() {
+  return current_sample_rate_settings->sample_rate;
+}
+
+inline float CorrectedSampleRate() {
+  return current_sample_rate_settings->corrected_sample_rate;
+}
+
+inline float A0() {
+  return current_sample_rate_settings->a0;
+}
 
 const size_t kMaxBlockSize = 24;
 const size_t kBlockSize = 12;
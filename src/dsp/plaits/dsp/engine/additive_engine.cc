@@ -43,6 +43,8 @@ void AdditiveEngine::Init(BufferAllocator* allocator) {
   for (int i = 0; i < kNumHarmonicOscillators; ++i) {
     harmonic_oscillator_[i].Init();
   }
+  integer_shape_.valid = false;
+  organ_shape_.valid = false;
 }
 
 void AdditiveEngine::Reset() {
@@ -52,19 +54,23 @@ void AdditiveEngine::Reset() {
       0.0f);
 }
 
-void AdditiveEngine::UpdateAmplitudes(
+void AdditiveEngine::ComputeSpectrumShape(
     float centroid,
     float slope,
     float bumps,
-    float* amplitudes,
-    const int* harmonic_indices,
-    size_t num_harmonics) {
+    size_t num_harmonics,
+    SpectrumShape* shape) {
+  if (shape->valid &&
+      shape->centroid == centroid &&
+      shape->slope == slope &&
+      shape->bumps == bumps) {
+    return;
+  }
+  
   const float n = (static_cast<float>(num_harmonics) - 1.0f);
   const float margin = (1.0f / slope - 1.0f) / (1.0f + bumps);
   const float center = centroid * (n + margin) - 0.5f * margin;
 
-  float sum = 0.001f;
-
   for (size_t i = 0; i < num_harmonics; ++i) {
     float order = fabsf(static_cast<float>(i) - center) * slope;
     float gain = 1.0f - order;
@@ -77,7 +83,28 @@ void AdditiveEngine::UpdateAmplitudes(
     gain *= bump_factor;
     gain *= gain;
     gain *= gain;
-    
+    shape->gain[i] = gain;
+  }
+  
+  shape->valid = true;
+  shape->centroid = centroid;
+  shape->slope = slope;
+  shape->bumps = bumps;
+}
+
+void AdditiveEngine::UpdateAmplitudes(
+    float centroid,
+    float slope,
+    float bumps,
+    float* amplitudes,
+    const int* harmonic_indices,
+    size_t num_harmonics,
+    SpectrumShape* shape) {
+  ComputeSpectrumShape(centroid, slope, bumps, num_harmonics, shape);
+
+  float sum = 0.001f;
+
+  for (size_t i = 0; i < num_harmonics; ++i) {
     int j = harmonic_indices[i];
     
     // Warning about the following line: this is not a proper LP filter because
@@ -88,7 +115,7 @@ void AdditiveEngine::UpdateAmplitudes(
     // normalized spectrum, and both of them cause more annoyances than this
     // "incorrect" solution.
     
-    ONE_POLE(amplitudes[j], gain, 0.001f);
+    ONE_POLE(amplitudes[j], shape->gain[i], 0.001f);
     sum += amplitudes[j];
   }
 
@@ -133,7 +160,8 @@ void AdditiveEngine::Render(
       bumps,
       &amplitudes_[0],
       integer_harmonics,
-      24);
+      24,
+      &integer_shape_);
   harmonic_oscillator_[0].Render<1>(f0, &amplitudes_[0], out, size);
   harmonic_oscillator_[1].Render<13>(f0, &amplitudes_[12], out, size);
 
@@ -143,7 +171,8 @@ void AdditiveEngine::Render(
       bumps,
       &amplitudes_[24],
       organ_harmonics,
-      8);
+      8,
+      &organ_shape_);
 
   harmonic_oscillator_[2].Render<1>(f0, &amplitudes_[24], aux, size);
 }
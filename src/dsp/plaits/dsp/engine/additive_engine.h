@@ -53,17 +53,37 @@ class AdditiveEngine : public Engine {
       bool* already_enveloped);
  
  private:
+  // Target spectrum of one set of harmonics. It depends only on the
+  // centroid, slope and bumps, so it is kept until one of them changes.
+  struct SpectrumShape {
+    bool valid;
+    float centroid;
+    float slope;
+    float bumps;
+    float gain[kNumHarmonics];
+  };
+
+  void ComputeSpectrumShape(
+      float centroid,
+      float slope,
+      float bumps,
+      size_t num_harmonics,
+      SpectrumShape* shape);
+
   void UpdateAmplitudes(
       float centroid,
       float slope,
       float bumps,
       float* amplitudes,
       const int* harmonic_indices,
-      size_t num_harmonics);
+      size_t num_harmonics,
+      SpectrumShape* shape);
       
   HarmonicOscillator<kHarmonicBatchSize> harmonic_oscillator_[kNumHarmonicOscillators];
   
   float* amplitudes_;
+  SpectrumShape integer_shape_;
+  SpectrumShape organ_shape_;
   
   DISALLOW_COPY_AND_ASSIGN(AdditiveEngine);
 };
@@ -29,6 +29,9 @@
 #ifndef PLAITS_DSP_ENGINE_ENGINE_H_
 #define PLAITS_DSP_ENGINE_ENGINE_H_
 
+#include <atomic>
+#include <new>
+
 #include "plaits/dsp/dsp.h"
 
 #include "stmlib/dsp/units.h"
@@ -39,7 +42,7 @@ namespace plaits {
 inline float NoteToFrequency(float midi_note) {
   midi_note -= 9.0f;
   CONSTRAIN(midi_note, -128.0f, 127.0f);
-  return a0 * 0.25f * stmlib::SemitonesToRatio(midi_note);
+  return A0() * 0.25f * stmlib::SemitonesToRatio(midi_note);
 }
 
 enum TriggerState {
@@ -78,7 +81,7 @@ struct PostProcessingSettings {
 class Engine {
  public:
   Engine() { }
-  ~Engine() { }
+  virtual ~Engine() { }
   virtual void Init(stmlib::BufferAllocator* allocator) = 0;
   virtual void Reset() = 0;
   virtual void LoadUserData(const uint8_t* user_data) = 0;
@@ -91,41 +94,145 @@ class Engine {
   PostProcessingSettings post_processing_settings;
 };
 
-template<int max_size>
+// Size of the largest of a list of engine types.
+template<typename... Engines>
+struct LargestEngine;
+
+template<typename E>
+struct LargestEngine<E> {
+  static const size_t size = sizeof(E);
+};
+
+template<typename E, typename... Rest>
+struct LargestEngine<E, Rest...> {
+  static const size_t size = sizeof(E) > LargestEngine<Rest...>::size
+      ? sizeof(E)
+      : LargestEngine<Rest...>::size;
+};
+
+const size_t kEngineAlignment = 16;
+
+// What an engine costs a voice, to budget polyphony with.
+struct EngineCost {
+  // Size of the engine object, in the registry's storage.
+  size_t storage_bytes;
+  // Memory the engine's Init() takes from the allocator. Zero until the
+  // engine, or another of its type, has been selected.
+  size_t arena_bytes;
+  // Smoothed time taken by Render(), per sample. Zero until a render of the
+  // engine has been timed.
+  float ns_per_sample;
+};
+
+typedef Engine* (*EngineFactory)(void* storage);
+
+template<typename T>
+Engine* ConstructEngine(void* storage) {
+  return new(storage) T;
+}
+
+// Holds a factory per engine, and constructs only the selected engine into a
+// single slot of storage_size bytes. Engines that are never selected are
+// never constructed nor initialized.
+template<int max_size, size_t storage_size>
 class EngineRegistry {
  public:
-  EngineRegistry() { }
-  ~EngineRegistry() { }
+  EngineRegistry() : active_(NULL) { }
+  ~EngineRegistry() {
+    Destroy();
+  }
   
   void Init() {
+    Destroy();
     num_engines_ = 0;
   }
 
-  inline Engine* get(int index) {
-    return engine_[index];
-  }
-  
-  void RegisterInstance(
-      Engine* instance,
+  template<typename T>
+  void Register(
       bool already_enveloped,
       float out_gain,
       float aux_gain) {
+    static_assert(sizeof(T) <= storage_size, "Engine storage is too small");
+    static_assert(alignof(T) <= kEngineAlignment, "Engine is over-aligned");
     if (num_engines_ >= max_size) {
       return;
     }
-    engine_[num_engines_] = instance;
-    PostProcessingSettings* s = &instance->post_processing_settings;
+    factory_[num_engines_] = &ConstructEngine<T>;
+    storage_bytes_[num_engines_] = sizeof(T);
+    arena_bytes_[num_engines_] = 0;
+    ns_per_sample_[num_engines_].store(0.0f, std::memory_order_relaxed);
+    PostProcessingSettings* s = &settings_[num_engines_];
     s->already_enveloped = already_enveloped;
     s->out_gain = out_gain;
     s->aux_gain = aux_gain;
     ++num_engines_;
   }
   
+  // Returns the engine for index. When it is of a different type than the
+  // active engine, the active engine is destroyed and the new one is
+  // constructed and initialized from the (freed) allocator, which records
+  // what it takes for every entry of that type. Engines of the same type
+  // share their instance, as the 6-op banks do.
+  Engine* Activate(int index, stmlib::BufferAllocator* allocator) {
+    if (!active_ || factory_[index] != active_factory_) {
+      Destroy();
+      allocator->Free();
+      size_t free = allocator->free();
+      active_ = factory_[index](storage_);
+      active_factory_ = factory_[index];
+      active_->Init(allocator);
+      for (int i = 0; i < num_engines_; ++i) {
+        if (factory_[i] == active_factory_) {
+          arena_bytes_[i] = free - allocator->free();
+        }
+      }
+    }
+    active_->post_processing_settings = settings_[index];
+    return active_;
+  }
+  
+  // Folds a timed render of engine index into its smoothed cost. Called from
+  // the thread rendering the voice; cost() may read it from any thread.
+  void RecordRenderTime(int index, float ns_per_sample) {
+    std::atomic<float>* cost = &ns_per_sample_[index];
+    float smoothed = cost->load(std::memory_order_relaxed);
+    if (smoothed == 0.0f) {
+      smoothed = ns_per_sample;
+    } else {
+      smoothed += 0.1f * (ns_per_sample - smoothed);
+    }
+    cost->store(smoothed, std::memory_order_relaxed);
+  }
+
+  inline Engine* active() { return active_; }
   inline int size() const { return num_engines_; }
+  inline EngineCost cost(int index) const {
+    EngineCost c;
+    c.storage_bytes = storage_bytes_[index];
+    c.arena_bytes = arena_bytes_[index];
+    c.ns_per_sample = ns_per_sample_[index].load(std::memory_order_relaxed);
+    return c;
+  }
 
  private:
-  Engine* engine_[max_size];
+  void Destroy() {
+    if (active_) {
+      active_->~Engine();
+      active_ = NULL;
+    }
+  }
+
+  alignas(kEngineAlignment) uint8_t storage_[storage_size];
+  EngineFactory factory_[max_size];
+  PostProcessingSettings settings_[max_size];
+  size_t storage_bytes_[max_size];
+  size_t arena_bytes_[max_size];
+  std::atomic<float> ns_per_sample_[max_size];
+  Engine* active_;
+  EngineFactory active_factory_;
   int num_engines_;
+
+  DISALLOW_COPY_AND_ASSIGN(EngineRegistry);
 };
 
 }  // namespace plaits
@@ -59,7 +59,7 @@ void WavetableEngine::Init(BufferAllocator* allocator) {
   previous_x_ = 0.0f;
   previous_y_ = 0.0f;
   previous_z_ = 0.0f;
-  previous_f0_ = a0;
+  previous_f0_ = A0();
 
   diff_out_.Init();
   
@@ -30,7 +30,7 @@
 
 #include <algorithm>
 
-#include "plaits/resources.h"
+#include "plaits/dsp/fm/fm_patch_bank.h"
 
 namespace plaits {
 
@@ -61,12 +61,14 @@ void FMVoice::Render(float* buffer, size_t size) {
   voice_.Render(parameters_, buffer, size);
 }
 
-void FMVoice::LoadPatch(const fm::Patch* patch) {
+void FMVoice::LoadPatch(
+    const fm::Patch* patch,
+    const fm::PatchSetup<6>* setup) {
   if (patch == patch_) {
     return;
   }
   patch_ = patch;
-  voice_.SetPatch(patch_);
+  voice_.SetPatch(patch_, setup);
   lfo_.Set(patch_->modulations);
 }
 
@@ -77,11 +79,13 @@ void SixOpEngine::Init(BufferAllocator* allocator) {
 
   algorithms_.Init();
   for (int i = 0; i < kNumSixOpVoices; ++i) {
-    voice_[i].Init(&algorithms_, kCorrectedSampleRate);
+    voice_[i].Init(&algorithms_, CorrectedSampleRate());
   }
   temp_buffer_ = allocator->Allocate<float>(kMaxBlockSize * 4);
   acc_buffer_ = allocator->Allocate<float>(kMaxBlockSize * kNumSixOpVoices);
-  patches_ = allocator->Allocate<fm::Patch>(kNumPatchesPerBank);
+  unpacked_patches_ = allocator->Allocate<fm::Patch>(kNumPatchesPerBank);
+  patches_ = unpacked_patches_;
+  setups_ = NULL;
   
   active_voice_ = kNumSixOpVoices - 1;
   rendered_voice_ = 0;
@@ -92,8 +96,19 @@ void SixOpEngine::Reset() {
 }
 
 void SixOpEngine::LoadUserData(const uint8_t* user_data) {
-  for (int i = 0; i < kNumPatchesPerBank; ++i) {
-    patches_[i].Unpack(user_data + i * fm::Patch::SYX_SIZE);
+  // The ROM banks are unpacked once and shared by every engine. Other data
+  // might change in place, so it is unpacked again on each load.
+  int rom_bank = FindRomPatchBank(user_data);
+  if (rom_bank >= 0) {
+    const FMPatchBank& bank = RomPatchBank(rom_bank);
+    patches_ = bank.patch;
+    setups_ = bank.setup;
+  } else {
+    for (int i = 0; i < kNumPatchesPerBank; ++i) {
+      unpacked_patches_[i].Unpack(user_data + i * fm::Patch::SYX_SIZE);
+    }
+    patches_ = unpacked_patches_;
+    setups_ = NULL;
   }
   for (int i = 0; i < kNumSixOpVoices; ++i) {
     voice_[i].UnloadPatch();
@@ -111,10 +126,10 @@ void SixOpEngine::Render(
   
   if (parameters.trigger & TRIGGER_UNPATCHED) {
     const float t = parameters.morph;
-    voice_[0].mutable_lfo()->Scrub(2.0f * kCorrectedSampleRate * t);
+    voice_[0].mutable_lfo()->Scrub(2.0f * CorrectedSampleRate() * t);
 
     for (int i = 0; i < kNumSixOpVoices; ++i) {
-      voice_[i].LoadPatch(&patches_[patch_index]);
+      voice_[i].LoadPatch(&patches_[patch_index], setup(patch_index));
       Voice<6>::Parameters* p = voice_[i].mutable_parameters();
       p->sustain = i == 0 ? true : false;
       p->gate = false;
@@ -127,7 +142,9 @@ void SixOpEngine::Render(
   } else {
     if (parameters.trigger & TRIGGER_RISING_EDGE) {
       active_voice_ = (active_voice_ + 1) % kNumSixOpVoices;
-      voice_[active_voice_].LoadPatch(&patches_[patch_index]);
+      voice_[active_voice_].LoadPatch(
+          &patches_[patch_index],
+          setup(patch_index));
       voice_[active_voice_].mutable_lfo()->Reset();
     }
     Voice<6>::Parameters* p = voice_[active_voice_].mutable_parameters();
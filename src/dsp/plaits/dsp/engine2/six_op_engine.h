@@ -47,7 +47,9 @@ class FMVoice {
   ~FMVoice() { }
   
   void Init(fm::Algorithms<6>* algorithms, float sample_rate);
-  void LoadPatch(const fm::Patch* patch);
+  void LoadPatch(
+      const fm::Patch* patch,
+      const fm::PatchSetup<6>* setup = NULL);
   void Render(float* buffer, size_t size);
   
   inline void UnloadPatch() {
@@ -101,9 +103,19 @@ class SixOpEngine : public Engine {
   void LoadBank(int bank);
   
  private:
+  inline const fm::PatchSetup<6>* setup(int patch_index) const {
+    return setups_ ? &setups_[patch_index] : NULL;
+  }
+
   stmlib::HysteresisQuantizer2 patch_index_quantizer_;
   fm::Algorithms<6> algorithms_;
-  fm::Patch* patches_;
+  
+  // Either a shared ROM bank and its setups, or patches unpacked into
+  // unpacked_patches_, whose setups the voices compute.
+  const fm::Patch* patches_;
+  const fm::PatchSetup<6>* setups_;
+  fm::Patch* unpacked_patches_;
+  
   FMVoice voice_[kNumSixOpVoices];
   float* temp_buffer_;
   float* acc_buffer_;
@@ -85,7 +85,24 @@ class Envelope {
     std::copy(&increment[0], &increment[num_stages], &increment_[0]);
     std::copy(&level[0], &level[num_stages], &level_[0]);
   }
-  
+
+  // Copy increments computed by an envelope initialized with a scale of 1.0,
+  // applying this envelope's scale. The result is the same as calling the
+  // derived class' Set() on this envelope.
+  void SetUnscaled(
+      const float increment[num_stages],
+      const float level[num_stages]) {
+    for (int i = 0; i < num_stages; ++i) {
+      increment_[i] = increment[i] * scale_;
+    }
+    std::copy(&level[0], &level[num_stages], &level_[0]);
+  }
+
+  void Get(float increment[num_stages], float level[num_stages]) const {
+    std::copy(&increment_[0], &increment_[num_stages], &increment[0]);
+    std::copy(&level_[0], &level_[num_stages], &level[0]);
+  }
+
   inline float RenderAtSample(float t, const float gate_duration) {
     if (t > gate_duration) {
       // Check how far we are into the release phase.
@@ -0,0 +1,50 @@
+// Unpacked DX7 patch banks, shared by every six-op engine
+// Part of PlaitsVST - GPL v3
+
+#include "plaits/dsp/fm/fm_patch_bank.h"
+#include "plaits/resources.h"
+#include <mutex>
+
+namespace plaits {
+
+namespace {
+    constexpr int kNumRomBanks = SYX_BANK_2 + 1;
+
+    FMPatchBank romBanks[kNumRomBanks];
+    std::once_flag romBanksBuilt[kNumRomBanks];
+}
+
+void FMPatchBank::Init(const uint8_t* syx_data)
+{
+    for (int i = 0; i < kNumPatches; ++i) {
+        patch[i].Unpack(syx_data + i * fm::Patch::SYX_SIZE);
+        fm::Voice<6>::ComputeSetup(patch[i], &setup[i]);
+    }
+}
+
+int FindRomPatchBank(const uint8_t* syx_data)
+{
+    for (int i = 0; i < kNumRomBanks; ++i) {
+        if (syx_data == fm_patches_table[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const FMPatchBank& RomPatchBank(int index)
+{
+    std::call_once(romBanksBuilt[index], [index] {
+        romBanks[index].Init(fm_patches_table[index]);
+    });
+    return romBanks[index];
+}
+
+void PreloadRomPatchBanks()
+{
+    for (int i = 0; i < kNumRomBanks; ++i) {
+        RomPatchBank(i);
+    }
+}
+
+} // namespace plaits
@@ -0,0 +1,33 @@
+// Unpacked DX7 patch banks, shared by every six-op engine
+// Part of PlaitsVST - GPL v3
+
+#pragma once
+
+#include <cstdint>
+#include "plaits/dsp/fm/voice.h"
+
+namespace plaits {
+
+// 32 patches of a syx bank, unpacked, and the setup fm::Voice derives from
+// each of them. The setups do not depend on the sample rate.
+struct FMPatchBank {
+    static constexpr int kNumPatches = 32;
+
+    fm::Patch patch[kNumPatches];
+    fm::PatchSetup<6> setup[kNumPatches];
+
+    void Init(const uint8_t* syx_data);
+};
+
+// Index of data in fm_patches_table, or -1 if it is not one of the ROM banks
+int FindRomPatchBank(const uint8_t* syx_data);
+
+// The ROM bank at index in fm_patches_table. Each bank is built the first time
+// it is asked for, once per process, then shared read-only. Callers on the
+// audio thread wait if another thread is building the same bank, so
+// PreloadRomPatchBanks() should be called beforehand.
+const FMPatchBank& RomPatchBank(int index);
+
+void PreloadRomPatchBanks();
+
+} // namespace plaits
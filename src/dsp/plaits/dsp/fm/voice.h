@@ -45,6 +45,19 @@ namespace plaits {
 
 namespace fm {
 
+// Everything Voice::Setup() derives from a patch. The envelope increments are
+// those of envelopes initialized with a scale of 1.0, so that a setup does not
+// depend on the sample rate and can be shared by any voice.
+template<int num_operators>
+struct PatchSetup {
+  float operator_increment[num_operators][4];
+  float operator_level[num_operators][4];
+  float pitch_increment[4];
+  float pitch_level[4];
+  float ratios[num_operators];
+  float level_headroom[num_operators];
+};
+
 template<int num_operators>
 class Voice {
  public:
@@ -83,6 +96,7 @@ class Voice {
     feedback_state_[0] = feedback_state_[1] = 0.0f;
     
     patch_ = NULL;
+    setup_ = NULL;
     gate_ = false;
     note_ = 48.0f;
     normalized_velocity_ = 10.0f;
@@ -90,40 +104,73 @@ class Voice {
     dirty_ = true;
   }
   
-  inline void SetPatch(const Patch* patch) {
+  // When setup is NULL, it is computed from the patch before the next render.
+  inline void SetPatch(
+      const Patch* patch,
+      const PatchSetup<num_operators>* setup = NULL) {
     patch_ = patch;
+    setup_ = setup;
     dirty_ = true;
   }
   
   // Pre-compute everything that can be pre-computed once a patch is loaded:
   // - envelope constants
   // - frequency ratios
-  inline bool Setup() {
-    if (!dirty_) {
-      return false;
-    }
+  static void ComputeSetup(
+      const Patch& patch,
+      PatchSetup<num_operators>* setup) {
+    PitchEnvelope pitch_envelope;
+    pitch_envelope.Init(1.0f);
+    pitch_envelope.Set(
+        patch.pitch_envelope.rate,
+        patch.pitch_envelope.level);
+    pitch_envelope.Get(setup->pitch_increment, setup->pitch_level);
     
-    pitch_envelope_.Set(
-        patch_->pitch_envelope.rate,
-        patch_->pitch_envelope.level);
     for (int i = 0; i < num_operators; ++i) {
-      const Patch::Operator& op = patch_->op[i];
+      const Patch::Operator& op = patch.op[i];
 
       int level = OperatorLevel(op.level);
-      operator_envelope_[i].Set(op.envelope.rate, op.envelope.level, level);
+      OperatorEnvelope operator_envelope;
+      operator_envelope.Init(1.0f);
+      operator_envelope.Set(op.envelope.rate, op.envelope.level, level);
+      operator_envelope.Get(
+          setup->operator_increment[i],
+          setup->operator_level[i]);
     
       // The level increase caused by keyboard scaling plus velocity
       // scaling should not exceed this number - otherwise it would be
       // equivalent to have an operator with a level above 99.
-      level_headroom_[i] = float(127 - level);
+      setup->level_headroom[i] = float(127 - level);
 
       // Pre-compute frequency ratios. Encode the base frequency
       // (1Hz or the root note) as the sign of the ratio.
       float sign = op.mode == 0 ? 1.0f : -1.0f;
-      ratios_[i] = sign * FrequencyRatio(op);
+      setup->ratios[i] = sign * FrequencyRatio(op);
+    }
+  }
+  
+  // Loads the envelopes from the patch's setup. Returns true when the setup
+  // had to be computed first.
+  inline bool Setup() {
+    if (!dirty_) {
+      return false;
+    }
+    
+    bool computed = false;
+    if (!setup_) {
+      ComputeSetup(*patch_, &setup_storage_);
+      setup_ = &setup_storage_;
+      computed = true;
+    }
+    
+    pitch_envelope_.SetUnscaled(setup_->pitch_increment, setup_->pitch_level);
+    for (int i = 0; i < num_operators; ++i) {
+      operator_envelope_[i].SetUnscaled(
+          setup_->operator_increment[i],
+          setup_->operator_level[i]);
     }
     dirty_ = false;
-    return true;
+    return computed;
   }
   
   inline float op_level(int i) const {
@@ -157,7 +204,7 @@ class Voice {
       // both a patch setup and a full render in the time alloted for
       // a render. As a drawback, this causes a 0.5ms blank before a new
       // patch starts playing. But this is a clean blank, as opposed to a
-      // glitchy overrun.
+      // glitchy overrun. Patches with a precomputed setup start at once.
       return;
     }
     
@@ -203,7 +250,8 @@ class Voice {
     for (int i = 0; i < num_operators; ++i) {
       const Patch::Operator& op = patch_->op[i];
       
-      f[i] = ratios_[i] * (ratios_[i] < 0.0f ? -one_hz_ : f0);
+      const float ratio = setup_->ratios[i];
+      f[i] = ratio * (ratio < 0.0f ? -one_hz_ : f0);
 
       const float rate_scaling = RateScaling(note_, op.rate_scaling);
       float level = parameters.sustain
@@ -222,7 +270,7 @@ class Voice {
       
       level += 0.125f * std::min(
           kb_scaling + velocity_scaling + brightness,
-          level_headroom_[i]);
+          setup_->level_headroom[i]);
       
       level_[i] = level;
       
@@ -268,13 +316,13 @@ class Voice {
   float normalized_velocity_;
   float note_;
   
-  float ratios_[num_operators];
-  float level_headroom_[num_operators];
   float level_[num_operators];
   
   float feedback_state_[2];
   
   const Patch* patch_;
+  const PatchSetup<num_operators>* setup_;
+  PatchSetup<num_operators> setup_storage_;
   
   bool dirty_;
   
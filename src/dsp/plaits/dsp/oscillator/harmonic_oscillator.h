@@ -34,7 +34,9 @@
 #include "stmlib/dsp/dsp.h"
 #include "stmlib/dsp/parameter_interpolator.h"
 
+#include "plaits/dsp/dsp.h"
 #include "plaits/dsp/oscillator/sine_oscillator.h"
+#include "plaits/dsp/simd_float4.h"
 
 namespace plaits {
 
@@ -52,6 +54,7 @@ class HarmonicOscillator {
     }
   }
   
+  // size is at most kMaxBlockSize.
   template<int first_harmonic_index>
   void Render(
       float frequency,
@@ -62,44 +65,98 @@ class HarmonicOscillator {
       frequency = 0.5f;
     }
     
-    stmlib::ParameterInterpolator am[num_harmonics];
+    // Within a sample, each harmonic depends on the previous two through
+    // the recurrence, but samples do not depend on each other once the
+    // phase is known. So the phase and amplitudes are stepped sample by
+    // sample first, then the harmonic sums run four samples to a vector,
+    // each lane adding the harmonics in the same order as a scalar loop.
+    const size_t padded_size = (size + 3) & ~size_t(3);
+    float two_x[kMaxBlockSize];
+    float previous[kMaxBlockSize];
+    float current[kMaxBlockSize];
+    float am[num_harmonics][kMaxBlockSize];
+    
     stmlib::ParameterInterpolator fm(&frequency_, frequency, size);
+    for (size_t n = 0; n < size; ++n) {
+      phase_ += fm.Next();
+      if (phase_ >= 1.0f) {
+        phase_ -= 1.0f;
+      }
+      two_x[n] = 2.0f * SineNoWrap(phase_);
+      if (first_harmonic_index != 1) {
+        const float k = first_harmonic_index;
+        previous[n] = Sine(phase_ * (k - 1.0f) + 0.25f);
+        current[n] = Sine(phase_ * k);
+      }
+    }
     
+    // As stmlib::ParameterInterpolator steps them
+    float am_value[num_harmonics];
+    float am_increment[num_harmonics];
     for (int i = 0; i < num_harmonics; ++i) {
       float f = frequency * static_cast<float>(first_harmonic_index + i);
       if (f >= 0.5f) {
         f = 0.5f;
       }
-      am[i].Init(&amplitude_[i], amplitudes[i] * (1.0f - f * 2.0f), size);
+      const float target = amplitudes[i] * (1.0f - f * 2.0f);
+      am_value[i] = amplitude_[i];
+      am_increment[i] = (target - amplitude_[i]) / static_cast<float>(size);
     }
-
-    while (size--) {
-      phase_ += fm.Next();
-      if (phase_ >= 1.0f) {
-        phase_ -= 1.0f;
+    for (size_t n = 0; n < size; ++n) {
+      for (int i = 0; i < num_harmonics; ++i) {
+        am_value[i] += am_increment[i];
+        am[i][n] = am_value[i];
       }
-      const float two_x = 2.0f * SineNoWrap(phase_);
-      float previous, current;
+    }
+    for (int i = 0; i < num_harmonics; ++i) {
+      amplitude_[i] = am_value[i];
+    }
+    
+    // Lanes past the end of the block compute on zeros and are dropped.
+    for (size_t n = size; n < padded_size; ++n) {
+      two_x[n] = previous[n] = current[n] = 0.0f;
+      for (int i = 0; i < num_harmonics; ++i) {
+        am[i][n] = 0.0f;
+      }
+    }
+    
+    for (size_t n = 0; n < padded_size; n += 4) {
+      const Float4 two_x_n = Float4::Load(&two_x[n]);
+      Float4 previous_n, current_n;
       if (first_harmonic_index == 1) {
-        previous = 1.0f;
-        current = two_x * 0.5f;
+        previous_n = 1.0f;
+        current_n = two_x_n * 0.5f;
       } else {
-        const float k = first_harmonic_index;
-        previous = Sine(phase_ * (k - 1.0f) + 0.25f);
-        current = Sine(phase_ * k);
+        previous_n = Float4::Load(&previous[n]);
+        current_n = Float4::Load(&current[n]);
       }
       
-      float sum = 0.0f;
+      Float4 sum = 0.0f;
       for (int i = 0; i < num_harmonics; ++i) {
-        sum += am[i].Next() * current;
-        float temp = current;
-        current = two_x * current - previous;
-        previous = temp;
+        sum += Float4::Load(&am[i][n]) * current_n;
+        const Float4 temp = current_n;
+        current_n = two_x_n * current_n - previous_n;
+        previous_n = temp;
       }
-      if (first_harmonic_index == 1) {
-        *out++ = sum;
-      } else {
-        *out++ += sum;
+      
+      if (n + 4 <= size) {
+        if (first_harmonic_index == 1) {
+          sum.Store(&out[n]);
+        } else {
+          (Float4::Load(&out[n]) + sum).Store(&out[n]);
+        }
+        continue;
+      }
+      
+      float sums[4];
+      sum.Store(sums);
+      const size_t count = size - n;
+      for (size_t j = 0; j < count; ++j) {
+        if (first_harmonic_index == 1) {
+          out[n + j] = sums[j];
+        } else {
+          out[n + j] += sums[j];
+        }
       }
     }
   }
@@ -35,6 +35,7 @@
 #include "stmlib/dsp/units.h"
 
 #include "plaits/resources.h"
+#include "plaits/dsp/physical_modelling/resonator_kernel.h"
 
 namespace plaits {
 
@@ -51,8 +52,8 @@ void Resonator::Init(float position, int resolution) {
     mode_amplitude_[i] = amplitudes.Next() * 0.25f;
   }
   
-  for (int i = 0; i < kMaxNumModes / kModeBatchSize; ++i) {
-    mode_filters_[i].Init();
+  for (int i = 0; i < kMaxNumModes; ++i) {
+    mode_state_1_[i] = mode_state_2_[i] = 0.0f;
   }
 }
 
@@ -88,37 +89,28 @@ void Resonator::Process(
   brightness *= 1.0f - damping * 0.3f;
   float q_loss = brightness * (2.0f - brightness) * 0.85f + 0.15f;
   
-  float mode_q[kModeBatchSize];
-  float mode_f[kModeBatchSize];
-  float mode_a[kModeBatchSize];
-  int batch_counter = 0;
+  // Only whole batches of modes are rendered.
+  const int num_modes = resolution_ - resolution_ % kModeBatchSize;
+  float mode_g[kMaxNumModes];
+  float mode_r_plus_g[kMaxNumModes];
+  float mode_h[kMaxNumModes];
+  float mode_a[kMaxNumModes];
   
-  ResonatorSvf<kModeBatchSize>* batch_processor = &mode_filters_[0];
-  
-  
-  for (int i = 0; i < resolution_; ++i) {
+  for (int i = 0; i < num_modes; ++i) {
     float mode_frequency = harmonic * stretch_factor;
     if (mode_frequency >= 0.499f) {
       mode_frequency = 0.499f;
     }
     const float mode_attenuation = 1.0f - mode_frequency * 2.0f;
+    const float mode_q = 1.0f + mode_frequency * q;
     
-    mode_f[batch_counter] = mode_frequency;
-    mode_q[batch_counter] = 1.0f + mode_frequency * q;
-    mode_a[batch_counter] = mode_amplitude_[i] * mode_attenuation;
-    ++batch_counter;
-    
-    if (batch_counter == kModeBatchSize) {
-      batch_counter = 0;
-      batch_processor->Process<FILTER_MODE_BAND_PASS, true>(
-          mode_f,
-          mode_q,
-          mode_a,
-          in,
-          out,
-          size);
-      ++batch_processor;
-    }
+    // ResonatorSvf coefficients, band-pass
+    const float g = OnePole::tan<FREQUENCY_FAST>(mode_frequency);
+    const float r = 1.0f / mode_q;
+    mode_g[i] = g;
+    mode_h[i] = 1.0f / (1.0f + r * g + g * g);
+    mode_r_plus_g[i] = r + g;
+    mode_a[i] = mode_amplitude_[i] * mode_attenuation;
     
     stretch_factor += stiffness;
     if (stiffness < 0.0f) {
@@ -131,6 +123,17 @@ void Resonator::Process(
     harmonic += f0;
     q *= q_loss;
   }
+  
+  const ModeCoefficients coefficients = {
+      mode_g, mode_r_plus_g, mode_h, mode_a };
+  ProcessModes(
+      coefficients,
+      mode_state_1_,
+      mode_state_2_,
+      num_modes,
+      in,
+      out,
+      size);
 }
 
 }  // namespace plaits
@@ -124,7 +124,12 @@ class Resonator {
   int resolution_;
   
   float mode_amplitude_[kMaxNumModes];
-  ResonatorSvf<kModeBatchSize> mode_filters_[kMaxNumModes / kModeBatchSize];
+
+  // State of the mode filters, kModeBatchSize modes to a ResonatorSvf batch.
+  // They run through ProcessModes() (resonator_kernel.h), which gives
+  // the same output as ResonatorSvf<kModeBatchSize> with wider vectors.
+  float mode_state_1_[kMaxNumModes];
+  float mode_state_2_[kMaxNumModes];
   
   DISALLOW_COPY_AND_ASSIGN(Resonator);
 };
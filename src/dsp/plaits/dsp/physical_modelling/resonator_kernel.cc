@@ -0,0 +1,225 @@
+// Vectorised band-pass mode filters for the modal resonator
+// Part of PlaitsVST - GPL v3
+
+#include "plaits/dsp/physical_modelling/resonator_kernel.h"
+#include "plaits/dsp/simd_float4.h"
+
+#if defined(PLAITSVST_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#define PLAITSVST_AVX_KERNEL 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define PLAITSVST_TARGET_AVX
+#else
+#define PLAITSVST_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+namespace plaits {
+
+namespace {
+    // Modes are processed a few vectors per pass over the block, enough to
+    // overlap their recurrences without running out of registers. Later
+    // passes add later modes, so the sums keep their order.
+    constexpr int kVectorsPerPass = 3;
+
+    template <int kBatches>
+    void ProcessFloat4Pass(const ModeCoefficients& c, float* state_1, float* state_2,
+                           const float* in, float* out, size_t size)
+    {
+        Float4 g[kBatches], r_plus_g[kBatches], h[kBatches], gain[kBatches];
+        Float4 s1[kBatches], s2[kBatches];
+        for (int b = 0; b < kBatches; ++b) {
+            g[b] = Float4::Load(c.g + 4 * b);
+            r_plus_g[b] = Float4::Load(c.r_plus_g + 4 * b);
+            h[b] = Float4::Load(c.h + 4 * b);
+            gain[b] = Float4::Load(c.gain + 4 * b);
+            s1[b] = Float4::Load(state_1 + 4 * b);
+            s2[b] = Float4::Load(state_2 + 4 * b);
+        }
+
+        for (size_t n = 0; n < size; ++n) {
+            const Float4 s_in = in[n];
+            float sum = out[n];
+            for (int b = 0; b < kBatches; ++b) {
+                const Float4 hp = (s_in - r_plus_g[b] * s1[b] - s2[b]) * h[b];
+                const Float4 bp = g[b] * hp + s1[b];
+                s1[b] = g[b] * hp + bp;
+                const Float4 lp = g[b] * bp + s2[b];
+                s2[b] = g[b] * bp + lp;
+                sum += SumInOrder(gain[b] * bp);
+            }
+            out[n] = sum;
+        }
+
+        for (int b = 0; b < kBatches; ++b) {
+            s1[b].Store(state_1 + 4 * b);
+            s2[b].Store(state_2 + 4 * b);
+        }
+    }
+
+    void ProcessFloat4(const ModeCoefficients& c, float* state_1, float* state_2,
+                       int num_batches, const float* in, float* out, size_t size)
+    {
+        ModeCoefficients pass = c;
+        int first = 0;
+        while (first < num_batches) {
+            const int batches = num_batches - first < kVectorsPerPass ? num_batches - first : kVectorsPerPass;
+            pass.g = c.g + 4 * first;
+            pass.r_plus_g = c.r_plus_g + 4 * first;
+            pass.h = c.h + 4 * first;
+            pass.gain = c.gain + 4 * first;
+            float* s1 = state_1 + 4 * first;
+            float* s2 = state_2 + 4 * first;
+            if (batches == 3) {
+                ProcessFloat4Pass<3>(pass, s1, s2, in, out, size);
+            } else if (batches == 2) {
+                ProcessFloat4Pass<2>(pass, s1, s2, in, out, size);
+            } else {
+                ProcessFloat4Pass<1>(pass, s1, s2, in, out, size);
+            }
+            first += batches;
+        }
+    }
+
+#ifdef PLAITSVST_AVX_KERNEL
+    // Two batches per vector: the low half holds the earlier batch
+    template <int kPairs>
+    PLAITSVST_TARGET_AVX
+    void ProcessAvxPass(const ModeCoefficients& c, float* state_1, float* state_2,
+                        const float* in, float* out, size_t size)
+    {
+        __m256 g[kPairs], r_plus_g[kPairs], h[kPairs], gain[kPairs];
+        __m256 s1[kPairs], s2[kPairs];
+        for (int p = 0; p < kPairs; ++p) {
+            g[p] = _mm256_loadu_ps(c.g + 8 * p);
+            r_plus_g[p] = _mm256_loadu_ps(c.r_plus_g + 8 * p);
+            h[p] = _mm256_loadu_ps(c.h + 8 * p);
+            gain[p] = _mm256_loadu_ps(c.gain + 8 * p);
+            s1[p] = _mm256_loadu_ps(state_1 + 8 * p);
+            s2[p] = _mm256_loadu_ps(state_2 + 8 * p);
+        }
+
+        for (size_t n = 0; n < size; ++n) {
+            const __m256 s_in = _mm256_set1_ps(in[n]);
+            float sum = out[n];
+            for (int p = 0; p < kPairs; ++p) {
+                const __m256 hp = _mm256_mul_ps(
+                    _mm256_sub_ps(_mm256_sub_ps(s_in, _mm256_mul_ps(r_plus_g[p], s1[p])), s2[p]), h[p]);
+                const __m256 g_hp = _mm256_mul_ps(g[p], hp);
+                const __m256 bp = _mm256_add_ps(g_hp, s1[p]);
+                s1[p] = _mm256_add_ps(g_hp, bp);
+                const __m256 g_bp = _mm256_mul_ps(g[p], bp);
+                const __m256 lp = _mm256_add_ps(g_bp, s2[p]);
+                s2[p] = _mm256_add_ps(g_bp, lp);
+
+                const __m256 weighted = _mm256_mul_ps(gain[p], bp);
+                sum += SumInOrder(Float4(_mm256_castps256_ps128(weighted)));
+                sum += SumInOrder(Float4(_mm256_extractf128_ps(weighted, 1)));
+            }
+            out[n] = sum;
+        }
+
+        for (int p = 0; p < kPairs; ++p) {
+            _mm256_storeu_ps(state_1 + 8 * p, s1[p]);
+            _mm256_storeu_ps(state_2 + 8 * p, s2[p]);
+        }
+    }
+
+    PLAITSVST_TARGET_AVX
+    void ProcessAvx(const ModeCoefficients& c, float* state_1, float* state_2,
+                    int num_batches, const float* in, float* out, size_t size)
+    {
+        const int num_pairs = num_batches / 2;
+        ModeCoefficients pass = c;
+        int first = 0;
+        while (first < num_pairs) {
+            const int pairs = num_pairs - first < kVectorsPerPass ? num_pairs - first : kVectorsPerPass;
+            pass.g = c.g + 8 * first;
+            pass.r_plus_g = c.r_plus_g + 8 * first;
+            pass.h = c.h + 8 * first;
+            pass.gain = c.gain + 8 * first;
+            float* s1 = state_1 + 8 * first;
+            float* s2 = state_2 + 8 * first;
+            if (pairs == 3) {
+                ProcessAvxPass<3>(pass, s1, s2, in, out, size);
+            } else if (pairs == 2) {
+                ProcessAvxPass<2>(pass, s1, s2, in, out, size);
+            } else {
+                ProcessAvxPass<1>(pass, s1, s2, in, out, size);
+            }
+            first += pairs;
+        }
+
+        // An odd batch out goes last, as four lanes
+        if (num_batches % 2) {
+            const int last = num_batches - 1;
+            ModeCoefficients tail = { c.g + 4 * last, c.r_plus_g + 4 * last, c.h + 4 * last, c.gain + 4 * last };
+            ProcessFloat4Pass<1>(tail, state_1 + 4 * last, state_2 + 4 * last, in, out, size);
+        }
+    }
+
+    bool CpuHasAvx()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        // The OS must also save the upper halves of the registers
+        return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+        return __builtin_cpu_supports("avx");
+#endif
+    }
+#endif
+}
+
+bool ModeKernelSupported(ModeKernel kernel)
+{
+    switch (kernel) {
+        case MODE_KERNEL_FLOAT4:
+            return true;
+        case MODE_KERNEL_AVX:
+#ifdef PLAITSVST_AVX_KERNEL
+        {
+            static const bool supported = CpuHasAvx();
+            return supported;
+        }
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+ModeKernel DefaultModeKernel()
+{
+    static const ModeKernel kernel =
+        ModeKernelSupported(MODE_KERNEL_AVX) ? MODE_KERNEL_AVX : MODE_KERNEL_FLOAT4;
+    return kernel;
+}
+
+void ProcessModes(
+    ModeKernel kernel,
+    const ModeCoefficients& coefficients,
+    float* state_1,
+    float* state_2,
+    int num_modes,
+    const float* in,
+    float* out,
+    size_t size)
+{
+    const int num_batches = num_modes / 4;
+#ifdef PLAITSVST_AVX_KERNEL
+    if (kernel == MODE_KERNEL_AVX && ModeKernelSupported(MODE_KERNEL_AVX)) {
+        ProcessAvx(coefficients, state_1, state_2, num_batches, in, out, size);
+        return;
+    }
+#else
+    (void)kernel;
+#endif
+    ProcessFloat4(coefficients, state_1, state_2, num_batches, in, out, size);
+}
+
+} // namespace plaits
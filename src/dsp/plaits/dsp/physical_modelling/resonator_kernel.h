@@ -0,0 +1,56 @@
+// Vectorised band-pass mode filters for the modal resonator
+// Part of PlaitsVST - GPL v3
+
+#pragma once
+
+#include <cstddef>
+
+namespace plaits {
+
+// Coefficients of one block of ResonatorSvf band-pass modes, one entry per
+// mode, in the order Resonator sums them
+struct ModeCoefficients {
+    const float* g;
+    const float* r_plus_g;
+    const float* h;
+    const float* gain;
+};
+
+enum ModeKernel {
+    MODE_KERNEL_FLOAT4,  // four modes per vector (SSE2, NEON or scalar)
+    MODE_KERNEL_AVX      // eight modes per vector, x86 with AVX only
+};
+
+bool ModeKernelSupported(ModeKernel kernel);
+
+// The widest kernel this CPU runs, checked once
+ModeKernel DefaultModeKernel();
+
+// Runs num_modes (a multiple of 4) modes over in[] and adds their summed
+// band-pass output to out[], continuing from and updating state_1/state_2.
+// The result is exactly that of num_modes / 4 ResonatorSvf<4> batches run
+// one after the other: each mode computes the same operations, and each
+// sample adds each batch's modes in order before adding the batch to out.
+void ProcessModes(
+    ModeKernel kernel,
+    const ModeCoefficients& coefficients,
+    float* state_1,
+    float* state_2,
+    int num_modes,
+    const float* in,
+    float* out,
+    size_t size);
+
+inline void ProcessModes(
+    const ModeCoefficients& coefficients,
+    float* state_1,
+    float* state_2,
+    int num_modes,
+    const float* in,
+    float* out,
+    size_t size)
+{
+    ProcessModes(DefaultModeKernel(), coefficients, state_1, state_2, num_modes, in, out, size);
+}
+
+} // namespace plaits
@@ -54,7 +54,7 @@ void String::Reset() {
   string_.Reset();
   stretch_.Reset();
   iir_damping_filter_.Init();
-  dc_blocker_.Init(1.0f - 20.0f / kSampleRate);
+  dc_blocker_.Init(1.0f - 20.0f / SampleRate());
   dispersion_noise_ = 0.0f;
   curved_bridge_ = 0.0f;
   out_sample_[0] = out_sample_[1] = 0.0f;
@@ -123,7 +123,7 @@ void String::ProcessInternal(
       &delay_, delay * damping_compensation, size);
   
   float stretch_point = non_linearity_amount * (2.0f - non_linearity_amount) * 0.225f;
-  float stretch_correction = (160.0f / kSampleRate) * delay;
+  float stretch_correction = (160.0f / SampleRate()) * delay;
   CONSTRAIN(stretch_correction, 1.0f, 2.1f);
   
   float noise_amount_sqrt = non_linearity_amount > 0.75f
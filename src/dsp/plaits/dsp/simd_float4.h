@@ -0,0 +1,199 @@
+// Four-lane float vector for code that runs voices side by side
+// Part of PlaitsVST - GPL v3
+
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#ifndef PLAITSVST_SSE2
+#define PLAITSVST_SSE2 1
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PLAITSVST_NEON 1
+#endif
+
+namespace plaits {
+
+// Float4 holds one value per lane. Mask4 holds one condition per lane.
+// Lane-parallel code replaces each branch with a Select() on the condition's
+// mask. Each lane then computes exactly what the scalar code would, with
+// the same operations in the same order. The SSE2 and NEON versions are
+// single instructions; the scalar fallback loops over the four lanes.
+// SumInOrder() adds the lanes as ((a0 + a1) + a2) + a3, the order a scalar
+// loop over them would. Transpose() turns four vectors of four samples into
+// four vectors of one sample per lane, and back.
+
+#if defined(PLAITSVST_SSE2)
+
+struct Mask4 { __m128 v; };
+
+struct Float4 {
+    __m128 v;
+
+    Float4() = default;
+    Float4(float x) : v(_mm_set1_ps(x)) {}
+    explicit Float4(__m128 x) : v(x) {}
+
+    static Float4 Load(const float* p) { return Float4(_mm_loadu_ps(p)); }
+    static Float4 Set(float a, float b, float c, float d) { return Float4(_mm_setr_ps(a, b, c, d)); }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline Float4 operator+(Float4 a, Float4 b) { return Float4(_mm_add_ps(a.v, b.v)); }
+inline Float4 operator-(Float4 a, Float4 b) { return Float4(_mm_sub_ps(a.v, b.v)); }
+inline Float4 operator*(Float4 a, Float4 b) { return Float4(_mm_mul_ps(a.v, b.v)); }
+inline Float4 operator/(Float4 a, Float4 b) { return Float4(_mm_div_ps(a.v, b.v)); }
+inline Float4 Min(Float4 a, Float4 b) { return Float4(_mm_min_ps(a.v, b.v)); }
+inline Float4 Max(Float4 a, Float4 b) { return Float4(_mm_max_ps(a.v, b.v)); }
+
+inline Mask4 operator<(Float4 a, Float4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline Mask4 operator>=(Float4 a, Float4 b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+inline Mask4 operator&(Mask4 a, Mask4 b) { return { _mm_and_ps(a.v, b.v) }; }
+inline Mask4 operator|(Mask4 a, Mask4 b) { return { _mm_or_ps(a.v, b.v) }; }
+inline Mask4 AndNot(Mask4 a, Mask4 b) { return { _mm_andnot_ps(b.v, a.v) }; }  // a & !b
+inline Mask4 NoLanes() { return { _mm_setzero_ps() }; }
+inline Mask4 AllLanes() { return { _mm_castsi128_ps(_mm_set1_epi32(-1)) }; }
+inline bool Any(Mask4 m) { return _mm_movemask_ps(m.v) != 0; }
+
+inline Float4 Select(Mask4 m, Float4 a, Float4 b)
+{
+    return Float4(_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)));
+}
+
+inline float SumInOrder(Float4 a)
+{
+    __m128 sum = _mm_add_ss(a.v, _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(1, 1, 1, 1)));
+    sum = _mm_add_ss(sum, _mm_movehl_ps(a.v, a.v));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 3, 3, 3)));
+    return _mm_cvtss_f32(sum);
+}
+
+inline void Transpose(Float4& a, Float4& b, Float4& c, Float4& d)
+{
+    _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v);
+}
+
+#elif defined(PLAITSVST_NEON)
+
+struct Mask4 { uint32x4_t v; };
+
+struct Float4 {
+    float32x4_t v;
+
+    Float4() = default;
+    Float4(float x) : v(vdupq_n_f32(x)) {}
+    explicit Float4(float32x4_t x) : v(x) {}
+
+    static Float4 Load(const float* p) { return Float4(vld1q_f32(p)); }
+    static Float4 Set(float a, float b, float c, float d)
+    {
+        const float lanes[4] = { a, b, c, d };
+        return Load(lanes);
+    }
+    void Store(float* p) const { vst1q_f32(p, v); }
+};
+
+inline Float4 operator+(Float4 a, Float4 b) { return Float4(vaddq_f32(a.v, b.v)); }
+inline Float4 operator-(Float4 a, Float4 b) { return Float4(vsubq_f32(a.v, b.v)); }
+inline Float4 operator*(Float4 a, Float4 b) { return Float4(vmulq_f32(a.v, b.v)); }
+inline Float4 operator/(Float4 a, Float4 b) { return Float4(vdivq_f32(a.v, b.v)); }
+inline Float4 Min(Float4 a, Float4 b) { return Float4(vminq_f32(a.v, b.v)); }
+inline Float4 Max(Float4 a, Float4 b) { return Float4(vmaxq_f32(a.v, b.v)); }
+
+inline Mask4 operator<(Float4 a, Float4 b) { return { vcltq_f32(a.v, b.v) }; }
+inline Mask4 operator>=(Float4 a, Float4 b) { return { vcgeq_f32(a.v, b.v) }; }
+inline Mask4 operator&(Mask4 a, Mask4 b) { return { vandq_u32(a.v, b.v) }; }
+inline Mask4 operator|(Mask4 a, Mask4 b) { return { vorrq_u32(a.v, b.v) }; }
+inline Mask4 AndNot(Mask4 a, Mask4 b) { return { vbicq_u32(a.v, b.v) }; }  // a & !b
+inline Mask4 NoLanes() { return { vdupq_n_u32(0) }; }
+inline Mask4 AllLanes() { return { vdupq_n_u32(0xffffffffu) }; }
+inline bool Any(Mask4 m) { return vmaxvq_u32(m.v) != 0; }
+
+inline Float4 Select(Mask4 m, Float4 a, Float4 b) { return Float4(vbslq_f32(m.v, a.v, b.v)); }
+
+inline float SumInOrder(Float4 a)
+{
+    return ((vgetq_lane_f32(a.v, 0) + vgetq_lane_f32(a.v, 1)) + vgetq_lane_f32(a.v, 2)) + vgetq_lane_f32(a.v, 3);
+}
+
+inline void Transpose(Float4& a, Float4& b, Float4& c, Float4& d)
+{
+    float32x4x2_t ab = vtrnq_f32(a.v, b.v);  // a0 b0 a2 b2, a1 b1 a3 b3
+    float32x4x2_t cd = vtrnq_f32(c.v, d.v);  // c0 d0 c2 d2, c1 d1 c3 d3
+    a.v = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+    b.v = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+    c.v = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    d.v = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+#else
+
+struct Mask4 { bool v[4]; };
+
+struct Float4 {
+    float v[4];
+
+    Float4() = default;
+    Float4(float x) : v{ x, x, x, x } {}
+
+    static Float4 Load(const float* p) { return Set(p[0], p[1], p[2], p[3]); }
+    static Float4 Set(float a, float b, float c, float d)
+    {
+        Float4 r;
+        r.v[0] = a; r.v[1] = b; r.v[2] = c; r.v[3] = d;
+        return r;
+    }
+    void Store(float* p) const { for (int i = 0; i < 4; ++i) p[i] = v[i]; }
+};
+
+#define PLAITSVST_FLOAT4_OP(name, expr) \
+    inline Float4 name(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = (expr); return r; }
+PLAITSVST_FLOAT4_OP(operator+, a.v[i] + b.v[i])
+PLAITSVST_FLOAT4_OP(operator-, a.v[i] - b.v[i])
+PLAITSVST_FLOAT4_OP(operator*, a.v[i] * b.v[i])
+PLAITSVST_FLOAT4_OP(operator/, a.v[i] / b.v[i])
+PLAITSVST_FLOAT4_OP(Min, b.v[i] < a.v[i] ? b.v[i] : a.v[i])
+PLAITSVST_FLOAT4_OP(Max, a.v[i] < b.v[i] ? b.v[i] : a.v[i])
+#undef PLAITSVST_FLOAT4_OP
+
+#define PLAITSVST_MASK4_OP(name, type, expr) \
+    inline Mask4 name(type a, type b) { Mask4 r; for (int i = 0; i < 4; ++i) r.v[i] = (expr); return r; }
+PLAITSVST_MASK4_OP(operator<, Float4, a.v[i] < b.v[i])
+PLAITSVST_MASK4_OP(operator>=, Float4, a.v[i] >= b.v[i])
+PLAITSVST_MASK4_OP(operator&, Mask4, a.v[i] && b.v[i])
+PLAITSVST_MASK4_OP(operator|, Mask4, a.v[i] || b.v[i])
+PLAITSVST_MASK4_OP(AndNot, Mask4, a.v[i] && !b.v[i])
+#undef PLAITSVST_MASK4_OP
+
+inline Mask4 NoLanes() { return { { false, false, false, false } }; }
+inline Mask4 AllLanes() { return { { true, true, true, true } }; }
+inline bool Any(Mask4 m) { return m.v[0] || m.v[1] || m.v[2] || m.v[3]; }
+
+inline Float4 Select(Mask4 m, Float4 a, Float4 b)
+{
+    Float4 r;
+    for (int i = 0; i < 4; ++i) r.v[i] = m.v[i] ? a.v[i] : b.v[i];
+    return r;
+}
+
+inline float SumInOrder(Float4 a) { return ((a.v[0] + a.v[1]) + a.v[2]) + a.v[3]; }
+
+inline void Transpose(Float4& a, Float4& b, Float4& c, Float4& d)
+{
+    Float4* rows[4] = { &a, &b, &c, &d };
+    for (int i = 0; i < 4; ++i) {
+        for (int j = i + 1; j < 4; ++j) {
+            float t = rows[i]->v[j];
+            rows[i]->v[j] = rows[j]->v[i];
+            rows[j]->v[i] = t;
+        }
+    }
+}
+
+#endif
+
+inline Float4& operator+=(Float4& a, Float4 b) { return a = a + b; }
+inline Float4& operator-=(Float4& a, Float4 b) { return a = a - b; }
+
+} // namespace plaits
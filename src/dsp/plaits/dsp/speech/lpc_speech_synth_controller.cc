@@ -238,7 +238,7 @@ void LPCSpeechSynthController::Render(
   
   // All utterances have been normalized for an average f0 of 100 Hz.
   const float pitch_shift = frequency / \
-      (rate_ratio * kLPCSpeechSynthDefaultF0 / kCorrectedSampleRate);
+      (rate_ratio * kLPCSpeechSynthDefaultF0 / CorrectedSampleRate());
   const float time_stretch = SemitonesToRatio(-speed * 24.0f +
         (formant_shift < 0.4f ? (formant_shift - 0.4f) * -45.0f
             : (formant_shift > 0.6f ? (formant_shift - 0.6f) * -45.0f : 0.0f)));
@@ -284,7 +284,7 @@ void LPCSpeechSynthController::Render(
   } else {
     if (remaining_frame_samples_ == 0) {
       synth_.PlayFrame(frames, float(playback_frame_), false);
-      remaining_frame_samples_ = kSampleRate / kLPCSpeechSynthFPS * \
+      remaining_frame_samples_ = SampleRate() / kLPCSpeechSynthFPS * \
           time_stretch;
       ++playback_frame_;
       if (playback_frame_ >= last_playback_frame_) {
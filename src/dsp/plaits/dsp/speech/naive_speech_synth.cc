@@ -90,7 +90,7 @@ void NaiveSpeechSynth::Init() {
     filter_[i].Init();
   }
   pulse_coloration_.Init();
-  pulse_coloration_.set_f_q<FREQUENCY_DIRTY>(800.0f / kSampleRate, 0.5f);
+  pulse_coloration_.set_f_q<FREQUENCY_DIRTY>(800.0f / SampleRate(), 0.5f);
 }
 
 void NaiveSpeechSynth::Render(
@@ -103,7 +103,7 @@ void NaiveSpeechSynth::Render(
     float* output,
     size_t size) {
   if (click) {
-    click_duration_ = kSampleRate * 0.05f;
+    click_duration_ = SampleRate() * 0.05f;
   }
   click_duration_ -= min(click_duration_, size);
   
@@ -148,7 +148,7 @@ void NaiveSpeechSynth::Render(
     if (f >= 160.0f) {
       f = 160.0f;
     }
-    f = a0 * stmlib::SemitonesToRatio(f - 33.0f);
+    f = A0() * stmlib::SemitonesToRatio(f - 33.0f);
     if (click_duration_ && i == 0) {
       f *= 0.5f;
     }
@@ -100,7 +100,7 @@ void SAMSpeechSynth::InterpolatePhonemeData(
     float f_1 = p_1.formant[i].frequency;
     float f_2 = p_2.formant[i].frequency;
     float f = f_1 + (f_2 - f_1) * phoneme_fractional;
-    f *= 8.0f * formant_shift * 4294967296.0f / kSampleRate;
+    f *= 8.0f * formant_shift * 4294967296.0f / SampleRate();
     formant_frequency[i] = static_cast<uint32_t>(f);
   
     float a_1 = formant_amplitude_lut[p_1.formant[i].amplitude];
@@ -122,7 +122,7 @@ void SAMSpeechSynth::Render(
   }
   
   if (consonant) {
-    consonant_samples_ = kSampleRate * 0.05f;
+    consonant_samples_ = SampleRate() * 0.05f;
     int r = (vowel + 3.0f * frequency + 7.0f * formant_shift) * 8.0f;
     consonant_index_ = (r % kSAMNumConsonants);
   }
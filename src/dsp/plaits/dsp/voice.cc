@@ -27,6 +27,8 @@
 // Main synthesis voice.
 
 #include "plaits/dsp/voice.h"
+
+#include <chrono>
 #include "plaits/user_data.h"
 
 namespace plaits {
@@ -35,40 +37,40 @@ using namespace std;
 using namespace stmlib;
 
 void Voice::Init(BufferAllocator* allocator) {
+  rng_state_ = kDefaultRandomSeed;
   engines_.Init();
 
-  engines_.RegisterInstance(&virtual_analog_vcf_engine_, false, 1.0f, 1.0f);
-  engines_.RegisterInstance(&phase_distortion_engine_, false, 0.7f, 0.7f);
-  engines_.RegisterInstance(&six_op_engine_, true, 1.0f, 1.0f);
-  engines_.RegisterInstance(&six_op_engine_, true, 1.0f, 1.0f);
-  engines_.RegisterInstance(&six_op_engine_, true, 1.0f, 1.0f);
-  engines_.RegisterInstance(&wave_terrain_engine_, false, 0.7f, 0.7f);
-  engines_.RegisterInstance(&string_machine_engine_, false, 0.8f, 0.8f);
-  engines_.RegisterInstance(&chiptune_engine_, false, 0.5f, 0.5f);
+  engines_.Register<VirtualAnalogVCFEngine>(false, 1.0f, 1.0f);
+  engines_.Register<PhaseDistortionEngine>(false, 0.7f, 0.7f);
+  engines_.Register<SixOpEngine>(true, 1.0f, 1.0f);
+  engines_.Register<SixOpEngine>(true, 1.0f, 1.0f);
+  engines_.Register<SixOpEngine>(true, 1.0f, 1.0f);
+  engines_.Register<WaveTerrainEngine>(false, 0.7f, 0.7f);
+  engines_.Register<StringMachineEngine>(false, 0.8f, 0.8f);
+  engines_.Register<ChiptuneEngine>(false, 0.5f, 0.5f);
   
-  engines_.RegisterInstance(&virtual_analog_engine_, false, 0.8f, 0.8f);
-  engines_.RegisterInstance(&waveshaping_engine_, false, 0.7f, 0.6f);
-  engines_.RegisterInstance(&fm_engine_, false, 0.6f, 0.6f);
-  engines_.RegisterInstance(&grain_engine_, false, 0.7f, 0.6f);
-  engines_.RegisterInstance(&additive_engine_, false, 0.8f, 0.8f);
-  engines_.RegisterInstance(&wavetable_engine_, false, 0.6f, 0.6f);
-  engines_.RegisterInstance(&chord_engine_, false, 0.8f, 0.8f);
-  engines_.RegisterInstance(&speech_engine_, false, -0.7f, 0.8f);
+  engines_.Register<VirtualAnalogEngine>(false, 0.8f, 0.8f);
+  engines_.Register<WaveshapingEngine>(false, 0.7f, 0.6f);
+  engines_.Register<FMEngine>(false, 0.6f, 0.6f);
+  engines_.Register<GrainEngine>(false, 0.7f, 0.6f);
+  engines_.Register<AdditiveEngine>(false, 0.8f, 0.8f);
+  engines_.Register<WavetableEngine>(false, 0.6f, 0.6f);
+  engines_.Register<ChordEngine>(false, 0.8f, 0.8f);
+  engines_.Register<SpeechEngine>(false, -0.7f, 0.8f);
 
-  engines_.RegisterInstance(&swarm_engine_, false, -3.0f, 1.0f);
-  engines_.RegisterInstance(&noise_engine_, false, -1.0f, -1.0f);
-  engines_.RegisterInstance(&particle_engine_, false, -2.0f, 1.0f);
-  engines_.RegisterInstance(&string_engine_, true, -1.0f, 0.8f);
-  engines_.RegisterInstance(&modal_engine_, true, -1.0f, 0.8f);
-  engines_.RegisterInstance(&bass_drum_engine_, true, 0.8f, 0.8f);
-  engines_.RegisterInstance(&snare_drum_engine_, true, 0.8f, 0.8f);
-  engines_.RegisterInstance(&hi_hat_engine_, true, 0.8f, 0.8f);
+  engines_.Register<SwarmEngine>(false, -3.0f, 1.0f);
+  engines_.Register<NoiseEngine>(false, -1.0f, -1.0f);
+  engines_.Register<ParticleEngine>(false, -2.0f, 1.0f);
+  engines_.Register<StringEngine>(true, -1.0f, 0.8f);
+  engines_.Register<ModalEngine>(true, -1.0f, 0.8f);
+  engines_.Register<BassDrumEngine>(true, 0.8f, 0.8f);
+  engines_.Register<SnareDrumEngine>(true, 0.8f, 0.8f);
+  engines_.Register<HiHatEngine>(true, 0.8f, 0.8f);
   
-  for (int i = 0; i < engines_.size(); ++i) {
-    // All engines will share the same RAM space.
-    allocator->Free();
-    engines_.get(i)->Init(allocator);
-  }
+  // Engines are constructed in BeginRender(), when first selected. They all
+  // share the same RAM space.
+  allocator_ = allocator;
+  render_count_ = 0;
   
   engine_quantizer_.Init(engines_.size(), 0.05f, true);
   previous_engine_index_ = -1;
@@ -92,6 +94,96 @@ void Voice::Render(
     const Modulations& modulations,
     Frame* frames,
     size_t size) {
+  EngineParameters p;
+  BeginRender(patch, modulations, &p);
+  RenderEngine(p, size);
+  bool lpg_bypass = UpdateLpg();
+  const PostProcessingSettings* pp_s = pending_.post_processing_settings;
+
+  out_post_processor_.Process(
+      pp_s->out_gain,
+      lpg_bypass,
+      lpg_envelope_.gain(),
+      lpg_envelope_.frequency(),
+      lpg_envelope_.hf_bleed(),
+      out_buffer_,
+      &frames->out,
+      size,
+      2);
+
+  aux_post_processor_.Process(
+      pp_s->aux_gain,
+      lpg_bypass,
+      lpg_envelope_.gain(),
+      lpg_envelope_.frequency(),
+      lpg_envelope_.hf_bleed(),
+      aux_buffer_,
+      &frames->aux,
+      size,
+      2);
+}
+
+void Voice::Render(
+    const Patch& patch,
+    const Modulations& modulations,
+    float* out,
+    float* aux,
+    size_t size) {
+  EngineParameters p;
+  BeginRender(patch, modulations, &p);
+  RenderEngine(p, size);
+  EndRender(out, aux, size);
+}
+
+void Voice::RenderEngine(const EngineParameters& parameters, size_t size) {
+  ScopedRandomState random_state(&rng_state_);
+  if (!TimeNextRender()) {
+    pending_.engine->Render(
+        parameters, out_buffer_, aux_buffer_, size, &pending_.already_enveloped);
+    return;
+  }
+  
+  const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  pending_.engine->Render(
+      parameters, out_buffer_, aux_buffer_, size, &pending_.already_enveloped);
+  const chrono::duration<float, nano> elapsed =
+      chrono::steady_clock::now() - start;
+  RecordRenderTime(elapsed.count() / float(size));
+}
+
+bool Voice::EndRender(float* out, float* aux, size_t size) {
+  bool lpg_bypass = UpdateLpg();
+  const PostProcessingSettings* pp_s = pending_.post_processing_settings;
+
+  out_post_processor_.Process(
+      pp_s->out_gain,
+      lpg_bypass,
+      lpg_envelope_.gain(),
+      lpg_envelope_.frequency(),
+      lpg_envelope_.hf_bleed(),
+      out_buffer_,
+      out,
+      size);
+
+  aux_post_processor_.Process(
+      pp_s->aux_gain,
+      lpg_bypass,
+      lpg_envelope_.gain(),
+      lpg_envelope_.frequency(),
+      lpg_envelope_.hf_bleed(),
+      aux_buffer_,
+      aux,
+      size);
+  return pending_.already_enveloped || \
+      (!lpg_bypass && lpg_envelope_.gain() < kLpgClosedGain);
+}
+
+bool Voice::BeginRender(
+    const Patch& patch,
+    const Modulations& modulations,
+    EngineParameters* parameters) {
+  ScopedRandomState random_state(&rng_state_);
+
   // Trigger, LPG, internal envelope.
       
   // Delay trigger by 1ms to deal with sequencers or MIDI interfaces whose
@@ -123,8 +215,9 @@ void Voice::Render(
       patch.engine,
       engine_cv_);
   
-  Engine* e = engines_.get(engine_index);
+  Engine* e = engines_.Activate(engine_index, allocator_);
   
+  bool engine_changed = false;
   if (engine_index != previous_engine_index_ || reload_user_data_) {
     UserData user_data;
     const uint8_t* data = user_data.ptr(engine_index);
@@ -137,8 +230,9 @@ void Voice::Render(
     out_post_processor_.Reset();
     previous_engine_index_ = engine_index;
     reload_user_data_ = false;
+    engine_changed = true;
   }
-  EngineParameters p;
+  EngineParameters& p = *parameters;
 
   bool rising_edge = trigger_state_ && !previous_trigger_state;
   float note = (modulations.note + previous_note_) * 0.5f;
@@ -152,7 +246,7 @@ void Voice::Render(
     p.trigger = TRIGGER_UNPATCHED;
   }
   
-  const float short_decay = (200.0f * kBlockSize) / kSampleRate *
+  const float short_decay = (200.0f * kBlockSize) / SampleRate() *
       SemitonesToRatio(-96.0f * patch.decay);
 
   decay_envelope_.Process(short_decay * 2.0f);
@@ -173,10 +267,11 @@ void Voice::Render(
   if (engine_index == 15) {
     internal_envelope_amplitude = 2.0f - p.harmonics * 6.0f;
     CONSTRAIN(internal_envelope_amplitude, 0.0f, 1.0f);
-    speech_engine_.set_prosody_amount(
+    SpeechEngine* speech_engine = static_cast<SpeechEngine*>(e);
+    speech_engine->set_prosody_amount(
         !modulations.trigger_patched || modulations.frequency_patched ?
             0.0f : patch.frequency_modulation_amount);
-    speech_engine_.set_speed( 
+    speech_engine->set_speed( 
         !modulations.trigger_patched || modulations.morph_patched ?
             0.0f : patch.morph_modulation_amount);
   } else if (engine_index == 7) {
@@ -184,9 +279,9 @@ void Voice::Render(
       // Disable internal envelope on TIMBRE, and enable the envelope generator
       // built into the chiptune engine.
       internal_envelope_amplitude_timbre = 0.0f;
-      chiptune_engine_.set_envelope_shape(patch.timbre_modulation_amount);
+      static_cast<ChiptuneEngine*>(e)->set_envelope_shape(patch.timbre_modulation_amount);
     } else {
-      chiptune_engine_.set_envelope_shape(ChiptuneEngine::NO_ENVELOPE);
+      static_cast<ChiptuneEngine*>(e)->set_envelope_shape(ChiptuneEngine::NO_ENVELOPE);
     }
   }
   
@@ -224,49 +319,41 @@ void Voice::Render(
       0.0f,
       1.0f);
 
-  bool already_enveloped = pp_s.already_enveloped;
-  e->Render(p, out_buffer_, aux_buffer_, size, &already_enveloped);
-  
-  bool lpg_bypass = already_enveloped || \
-      (!modulations.level_patched && !modulations.trigger_patched);
+  pending_.engine = e;
+  pending_.post_processing_settings = &pp_s;
+  pending_.already_enveloped = pp_s.already_enveloped;
+  pending_.level_patched = modulations.level_patched;
+  pending_.trigger_patched = modulations.trigger_patched;
+  pending_.note = p.note;
+  pending_.short_decay = short_decay;
+  pending_.compressed_level = compressed_level;
+  pending_.decay = patch.decay;
+  pending_.lpg_colour = patch.lpg_colour;
+  return engine_changed;
+}
+
+bool Voice::UpdateLpg() {
+  const float short_decay = pending_.short_decay;
+  bool lpg_bypass = pending_.already_enveloped || \
+      (!pending_.level_patched && !pending_.trigger_patched);
   
   // Compute LPG parameters.
   if (!lpg_bypass) {
-    const float hf = patch.lpg_colour;
-    const float decay_tail = (20.0f * kBlockSize) / kSampleRate *
-        SemitonesToRatio(-72.0f * patch.decay + 12.0f * hf) - short_decay;
+    const float hf = pending_.lpg_colour;
+    const float decay_tail = (20.0f * kBlockSize) / SampleRate() *
+        SemitonesToRatio(-72.0f * pending_.decay + 12.0f * hf) - short_decay;
     
-    if (modulations.level_patched) {
-      lpg_envelope_.ProcessLP(compressed_level, short_decay, decay_tail, hf);
+    if (pending_.level_patched) {
+      lpg_envelope_.ProcessLP(
+          pending_.compressed_level, short_decay, decay_tail, hf);
     } else {
-      const float attack = NoteToFrequency(p.note) * float(kBlockSize) * 2.0f;
+      const float attack = NoteToFrequency(pending_.note) * float(kBlockSize) * 2.0f;
       lpg_envelope_.ProcessPing(attack, short_decay, decay_tail, hf);
     }
   } else {
     lpg_envelope_.Init();
   }
-  
-  out_post_processor_.Process(
-      pp_s.out_gain,
-      lpg_bypass,
-      lpg_envelope_.gain(),
-      lpg_envelope_.frequency(),
-      lpg_envelope_.hf_bleed(),
-      out_buffer_,
-      &frames->out,
-      size,
-      2);
-
-  aux_post_processor_.Process(
-      pp_s.aux_gain,
-      lpg_bypass,
-      lpg_envelope_.gain(),
-      lpg_envelope_.frequency(),
-      lpg_envelope_.hf_bleed(),
-      aux_buffer_,
-      &frames->aux,
-      size,
-      2);
+  return lpg_bypass;
 }
   
 }  // namespace plaits
@@ -34,6 +34,7 @@
 #include "stmlib/dsp/filter.h"
 #include "stmlib/dsp/limiter.h"
 #include "stmlib/utils/buffer_allocator.h"
+#include "stmlib/utils/random.h"
 
 #include "plaits/dsp/engine/additive_engine.h"
 #include "plaits/dsp/engine/bass_drum_engine.h"
@@ -67,8 +68,22 @@
 namespace plaits {
 
 const int kMaxEngines = 24;
+const int kEngineTimingInterval = 16;
 const int kMaxTriggerDelay = 8;
 const int kTriggerDelay = 5;
+const uint32_t kDefaultRandomSeed = 0x21;
+
+// LPG gain (-60 dB) below which the gate counts as closed.
+const float kLpgClosedGain = 1.0e-3f;
+
+// Only the selected engine is constructed, in a slot large enough for any.
+const size_t kEngineStorageSize = LargestEngine<
+    VirtualAnalogEngine, WaveshapingEngine, FMEngine, GrainEngine,
+    AdditiveEngine, WavetableEngine, ChordEngine, SpeechEngine,
+    SwarmEngine, NoiseEngine, ParticleEngine, StringEngine,
+    ModalEngine, BassDrumEngine, SnareDrumEngine, HiHatEngine,
+    VirtualAnalogVCFEngine, PhaseDistortionEngine, SixOpEngine,
+    WaveTerrainEngine, StringMachineEngine, ChiptuneEngine>::size;
 
 class ChannelPostProcessor {
  public:
@@ -114,6 +129,40 @@ class ChannelPostProcessor {
       }
     }
   }
+
+  // Float variant: same gain staging and clipping as the 16-bit output,
+  // normalized to -1.0 to 1.0. in is used as scratch space.
+  void Process(
+      float gain,
+      bool bypass_lpg,
+      float low_pass_gate_gain,
+      float low_pass_gate_frequency,
+      float low_pass_gate_hf_bleed,
+      float* in,
+      float* out,
+      size_t size) {
+    if (gain < 0.0f) {
+      limiter_.Process(-gain, in, size);
+    }
+    const float post_gain = (gain < 0.0f ? 1.0f : gain) * -1.0f;
+    if (!bypass_lpg) {
+      lpg_.Process(
+          post_gain * low_pass_gate_gain,
+          low_pass_gate_frequency,
+          low_pass_gate_hf_bleed,
+          in,
+          size);
+    } else {
+      for (size_t i = 0; i < size; ++i) {
+        in[i] *= post_gain;
+      }
+    }
+    for (size_t i = 0; i < size; ++i) {
+      float s = in[i];
+      CONSTRAIN(s, -1.0f, 1.0f);
+      out[i] = s;
+    }
+  }
   
  private:
   stmlib::Limiter limiter_;
@@ -166,19 +215,104 @@ class Voice {
     short aux;
   };
   
+  // Engines are constructed and initialized from the allocator when first
+  // selected, so it must outlive the voice.
   void Init(stmlib::BufferAllocator* allocator);
   void ReloadUserData() {
     reload_user_data_ = true;
   }
+
+  // Seeds the voice's own random generator, used by the noise-based
+  // engines. Two voices given the same seed and inputs render identically.
+  void Seed(uint32_t seed) {
+    rng_state_ = seed;
+  }
   void Render(
       const Patch& patch,
       const Modulations& modulations,
       Frame* frames,
       size_t size);
+
+  // Float render path, normalized to -1.0 to 1.0, without the 16-bit
+  // quantization of the Frame path.
+  void Render(
+      const Patch& patch,
+      const Modulations& modulations,
+      float* out,
+      float* aux,
+      size_t size);
   inline int active_engine() const { return previous_engine_index_; }
+
+  // Split float render, for callers that render the engine themselves (the
+  // virtual analog engines of several voices at once, for instance).
+  // BeginRender() handles the trigger, envelopes and engine selection, fills
+  // in the engine's parameters and returns true when the engine has just
+  // been selected or reloaded. The caller then either calls RenderEngine()
+  // or writes size samples to engine_out() and engine_aux() itself, and
+  // finishes the block with EndRender(). Render() is the three in a row.
+  // EndRender() returns true when silence in the block means the note has
+  // ended: the engine envelopes its own output, or the LPG has closed.
+  bool BeginRender(
+      const Patch& patch,
+      const Modulations& modulations,
+      EngineParameters* parameters);
+  void RenderEngine(const EngineParameters& parameters, size_t size);
+  bool EndRender(float* out, float* aux, size_t size);
+  inline float* engine_out() { return out_buffer_; }
+  inline float* engine_aux() { return aux_buffer_; }
+  
+  // Memory and CPU cost of engine index. The memory is known once the engine
+  // has been selected. Every kEngineTimingInterval-th RenderEngine() is
+  // timed. Callers that render the engine themselves time the renders for
+  // which TimeNextRender() returns true, and report them with
+  // RecordRenderTime().
+  inline EngineCost engine_cost(int index) const {
+    return engines_.cost(index);
+  }
+  inline bool TimeNextRender() {
+    return ++render_count_ % kEngineTimingInterval == 0;
+  }
+  inline void RecordRenderTime(float ns_per_sample) {
+    engines_.RecordRenderTime(previous_engine_index_, ns_per_sample);
+  }
     
  private:
   void ComputeDecayParameters(const Patch& settings);
+
+  // Installs the voice's generator state as the current thread's
+  // stmlib::Random state for the lifetime of the scope.
+  class ScopedRandomState {
+   public:
+    explicit ScopedRandomState(uint32_t* state) : state_(state) {
+      stmlib::Random::Seed(*state_);
+    }
+    ~ScopedRandomState() {
+      *state_ = stmlib::Random::state();
+    }
+
+   private:
+    uint32_t* state_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedRandomState);
+  };
+
+  // Updates the LPG envelope once the engine has rendered. Returns true
+  // when the LPG is bypassed.
+  bool UpdateLpg();
+
+  // What BeginRender() leaves for RenderEngine() and UpdateLpg()
+  struct PendingBlock {
+    Engine* engine;
+    const PostProcessingSettings* post_processing_settings;
+    bool already_enveloped;
+    bool level_patched;
+    bool trigger_patched;
+    float note;
+    float short_decay;
+    float compressed_level;
+    float decay;
+    float lpg_colour;
+  };
   
   inline float ApplyModulations(
       float base_value,
@@ -202,34 +336,13 @@ class Voice {
     return value;
   }
 
-  VirtualAnalogEngine virtual_analog_engine_;
-  WaveshapingEngine waveshaping_engine_;
-  FMEngine fm_engine_;
-  GrainEngine grain_engine_;
-  AdditiveEngine additive_engine_;
-  WavetableEngine wavetable_engine_;
-  ChordEngine chord_engine_;
-  SpeechEngine speech_engine_;
-
-  SwarmEngine swarm_engine_;
-  NoiseEngine noise_engine_;
-  ParticleEngine particle_engine_;
-  StringEngine string_engine_;
-  ModalEngine modal_engine_;
-  BassDrumEngine bass_drum_engine_;
-  SnareDrumEngine snare_drum_engine_;
-  HiHatEngine hi_hat_engine_;
-  
-  VirtualAnalogVCFEngine virtual_analog_vcf_engine_;
-  PhaseDistortionEngine phase_distortion_engine_;
-  SixOpEngine six_op_engine_;
-  WaveTerrainEngine wave_terrain_engine_;
-  StringMachineEngine string_machine_engine_;
-  ChiptuneEngine chiptune_engine_;
+  stmlib::BufferAllocator* allocator_;
 
   stmlib::HysteresisQuantizer2 engine_quantizer_;
   
   bool reload_user_data_;
+  uint32_t rng_state_;
+  uint32_t render_count_;
   int previous_engine_index_;
   float engine_cv_;
   
@@ -245,7 +358,8 @@ class Voice {
   ChannelPostProcessor out_post_processor_;
   ChannelPostProcessor aux_post_processor_;
   
-  EngineRegistry<kMaxEngines> engines_;
+  EngineRegistry<kMaxEngines, kEngineStorageSize> engines_;
+  PendingBlock pending_;
   
   float out_buffer_[kMaxBlockSize];
   float aux_buffer_[kMaxBlockSize];
@@ -0,0 +1,85 @@
+// PluginState - compact binary form of the plugin's saved state
+// PlaitsVST: MIT License
+
+#include "plugin_state.h"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+    void writeWord(uint8_t* dest, uint32_t word)
+    {
+        dest[0] = static_cast<uint8_t>(word);
+        dest[1] = static_cast<uint8_t>(word >> 8);
+        dest[2] = static_cast<uint8_t>(word >> 16);
+        dest[3] = static_cast<uint8_t>(word >> 24);
+    }
+
+    uint32_t readWord(const uint8_t* source)
+    {
+        return static_cast<uint32_t>(source[0]) |
+               (static_cast<uint32_t>(source[1]) << 8) |
+               (static_cast<uint32_t>(source[2]) << 16) |
+               (static_cast<uint32_t>(source[3]) << 24);
+    }
+
+    template <typename T>
+    uint32_t toWord(T value)
+    {
+        if constexpr (std::is_same_v<T, float>) {
+            uint32_t word;
+            std::memcpy(&word, &value, sizeof(word));
+            return word;
+        } else {
+            return static_cast<uint32_t>(value);
+        }
+    }
+
+    template <typename T>
+    T fromWord(uint32_t word)
+    {
+        if constexpr (std::is_same_v<T, float>) {
+            float value;
+            std::memcpy(&value, &word, sizeof(value));
+            return value;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return word != 0;
+        } else {
+            return static_cast<T>(word);
+        }
+    }
+}
+
+void PluginState::write(uint8_t* dest) const
+{
+    writeWord(dest, kMagic);
+    writeWord(dest + 4, kVersion);
+    writeWord(dest + 8, static_cast<uint32_t>(kPayloadSize));
+
+    uint8_t* field = dest + kHeaderSize;
+    visitFields(*this, [&field](const auto& value) {
+        writeWord(field, toWord(value));
+        field += 4;
+    });
+}
+
+bool PluginState::read(const void* data, size_t size)
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    if (bytes == nullptr || size < kHeaderSize || readWord(bytes) != kMagic) {
+        return false;
+    }
+
+    // Versions only ever append fields, so whatever is there is read in order
+    size_t payload = std::min(static_cast<size_t>(readWord(bytes + 8)), size - kHeaderSize);
+    const uint8_t* field = bytes + kHeaderSize;
+
+    visitFields(*this, [&field, &payload](auto& value) {
+        if (payload >= 4) {
+            value = fromWord<std::decay_t<decltype(value)>>(readWord(field));
+            field += 4;
+            payload -= 4;
+        }
+    });
+    return true;
+}
@@ -0,0 +1,97 @@
+// PluginState - compact binary form of the plugin's saved state
+// PlaitsVST: MIT License
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Everything the processor saves, as plain values. It is serialised as a
+// fixed little-endian layout behind a magic number and a version, so a
+// session restores with one header check instead of a keyed lookup per
+// property.
+//
+// The layout is append-only: new versions add fields at the end. A blob
+// from an older version leaves the fields it lacks untouched, and fields
+// from a newer version are skipped.
+struct PluginState {
+    static constexpr uint32_t kMagic = 0x54535650;  // "PVST"
+    static constexpr uint32_t kVersion = 1;
+
+    // Header: magic, version, payload size (4 bytes each); every field is
+    // stored in 4 bytes
+    static constexpr size_t kHeaderSize = 12;
+    static constexpr size_t kNumFields = 28;
+    static constexpr size_t kPayloadSize = kNumFields * 4;
+    static constexpr size_t kSerializedSize = kHeaderSize + kPayloadSize;
+
+    struct Lfo {
+        int32_t rate = 4;
+        int32_t shape = 0;
+        int32_t dest = 0;
+        int32_t amount = 0;
+    };
+
+    struct Env {
+        float attack = 0.0f;
+        float decay = 0.5f;
+        int32_t dest = 0;
+        int32_t amount = 0;
+    };
+
+    int32_t engine = 0;
+    float harmonics = 0.5f;
+    float timbre = 0.5f;
+    float morph = 0.5f;
+    float attack = 0.0f;
+    float decay = 0.5f;
+    int32_t polyphony = 8;
+
+    float cutoff = 1.0f;
+    float resonance = 0.0f;
+    int32_t filterMode = 0;
+
+    Lfo lfo[2];
+    Env env[2];
+
+    bool multiThreaded = false;
+    uint32_t modulationSeed = 0;
+
+    // Write kSerializedSize bytes to dest
+    void write(uint8_t* dest) const;
+
+    // Read a blob written by write(). Returns false, leaving the state
+    // untouched, when the data is not a binary state (e.g. an older
+    // ValueTree session).
+    bool read(const void* data, size_t size);
+
+    // Call visitor(field) on every field, in serialised order
+    template <typename Self, typename Visitor>
+    static void visitFields(Self& state, Visitor&& visitor)
+    {
+        visitor(state.engine);
+        visitor(state.harmonics);
+        visitor(state.timbre);
+        visitor(state.morph);
+        visitor(state.attack);
+        visitor(state.decay);
+        visitor(state.polyphony);
+        visitor(state.cutoff);
+        visitor(state.resonance);
+        visitor(state.filterMode);
+        for (auto& lfo : state.lfo) {
+            visitor(lfo.rate);
+            visitor(lfo.shape);
+            visitor(lfo.dest);
+            visitor(lfo.amount);
+        }
+        for (auto& env : state.env) {
+            visitor(env.attack);
+            visitor(env.decay);
+            visitor(env.dest);
+            visitor(env.amount);
+        }
+        visitor(state.multiThreaded);
+        visitor(state.modulationSeed);
+    }
+};
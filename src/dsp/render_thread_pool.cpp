@@ -0,0 +1,173 @@
+// RenderThreadPool - persistent worker threads for parallel voice rendering
+// PlaitsVST: MIT License
+
+#include "render_thread_pool.h"
+#include <algorithm>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace {
+    // Idle workers spin for a few tens of microseconds, then yield, then park
+    constexpr int kSpinIterations = 2000;
+    constexpr int kYieldIterations = 200;
+    constexpr auto kParkTimeout = std::chrono::milliseconds(2);
+
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+
+    // Ticket layout: generation (32 bits) | job count (16 bits) | next job (16 bits)
+    inline uint64_t makeTicket(uint32_t generation, int numJobs, int next)
+    {
+        return (static_cast<uint64_t>(generation) << 32) |
+               (static_cast<uint64_t>(numJobs) << 16) |
+               static_cast<uint64_t>(next);
+    }
+
+    inline uint32_t ticketGeneration(uint64_t ticket) { return static_cast<uint32_t>(ticket >> 32); }
+    inline int ticketNumJobs(uint64_t ticket) { return static_cast<int>((ticket >> 16) & 0xffff); }
+    inline int ticketNext(uint64_t ticket) { return static_cast<int>(ticket & 0xffff); }
+}
+
+RenderThreadPool::~RenderThreadPool()
+{
+    Stop();
+}
+
+void RenderThreadPool::Start(int numThreads)
+{
+    Stop();
+
+    numThreads = std::clamp(numThreads, 0, kMaxThreads);
+    if (numThreads == 0) {
+        return;
+    }
+
+    running_.store(true);
+    threads_.reserve(static_cast<size_t>(numThreads));
+    for (int i = 0; i < numThreads; ++i) {
+        threads_.emplace_back(&RenderThreadPool::workerLoop, this);
+    }
+}
+
+void RenderThreadPool::Stop()
+{
+    if (threads_.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        running_.store(false);
+    }
+    parkCondition_.notify_all();
+
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+void RenderThreadPool::Run(Job job, void* context, int numJobs)
+{
+    if (numJobs <= 0) {
+        return;
+    }
+
+    // Nothing to share: skip the hand-off entirely
+    if (threads_.empty() || numJobs == 1) {
+        for (int i = 0; i < numJobs; ++i) {
+            job(context, i);
+        }
+        return;
+    }
+
+    numJobs = std::min(numJobs, 0xffff);
+
+    job_.store(job, std::memory_order_relaxed);
+    context_.store(context, std::memory_order_relaxed);
+    completed_.store(0, std::memory_order_relaxed);
+
+    uint32_t generation = ticketGeneration(ticket_.load(std::memory_order_relaxed)) + 1;
+    ticket_.store(makeTicket(generation, numJobs, 0), std::memory_order_seq_cst);
+
+    if (parked_.load(std::memory_order_seq_cst) > 0) {
+        parkCondition_.notify_all();
+    }
+
+    // The calling thread works too, so a late or sleeping worker never
+    // holds up the block; it just ends up with fewer jobs
+    runJobs(generation);
+
+    while (completed_.load(std::memory_order_acquire) < numJobs) {
+        cpuRelax();
+    }
+}
+
+void RenderThreadPool::runJobs(uint32_t generation)
+{
+    uint64_t ticket = ticket_.load(std::memory_order_acquire);
+
+    while (ticketGeneration(ticket) == generation &&
+           ticketNext(ticket) < ticketNumJobs(ticket)) {
+        if (!ticket_.compare_exchange_weak(ticket, ticket + 1,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+            continue;
+        }
+
+        // Run() cannot return (and so cannot publish new work) until this
+        // job completes, so the job and context belong to this generation
+        Job job = job_.load(std::memory_order_relaxed);
+        void* context = context_.load(std::memory_order_relaxed);
+        job(context, ticketNext(ticket));
+        completed_.fetch_add(1, std::memory_order_release);
+
+        ticket = ticket_.load(std::memory_order_acquire);
+    }
+}
+
+void RenderThreadPool::workerLoop()
+{
+    uint32_t lastGeneration = ticketGeneration(ticket_.load(std::memory_order_acquire));
+    int idle = 0;
+
+    auto hasWork = [this, &lastGeneration] {
+        return ticketGeneration(ticket_.load(std::memory_order_acquire)) != lastGeneration ||
+               !running_.load(std::memory_order_acquire);
+    };
+
+    while (running_.load(std::memory_order_acquire)) {
+        uint32_t generation = ticketGeneration(ticket_.load(std::memory_order_acquire));
+
+        if (generation != lastGeneration) {
+            lastGeneration = generation;
+            runJobs(generation);
+            idle = 0;
+            continue;
+        }
+
+        if (idle < kSpinIterations) {
+            ++idle;
+            cpuRelax();
+        } else if (idle < kSpinIterations + kYieldIterations) {
+            ++idle;
+            std::this_thread::yield();
+        } else {
+            // The audio thread notifies without taking the lock, so a wakeup
+            // can occasionally be missed; the timeout bounds that to one block
+            std::unique_lock<std::mutex> lock(parkMutex_);
+            parked_.fetch_add(1, std::memory_order_seq_cst);
+            parkCondition_.wait_for(lock, kParkTimeout, hasWork);
+            parked_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+// RenderThreadPool - persistent worker threads for parallel voice rendering
+// PlaitsVST: MIT License
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class RenderThreadPool {
+public:
+    // A job renders one work item; it must not block or allocate
+    using Job = void (*)(void* context, int index);
+
+    static constexpr int kMaxThreads = 15;
+
+    RenderThreadPool() = default;
+    ~RenderThreadPool();
+
+    RenderThreadPool(const RenderThreadPool&) = delete;
+    RenderThreadPool& operator=(const RenderThreadPool&) = delete;
+
+    // Start numThreads workers, replacing any running ones (0 stops the pool)
+    // Allocates and joins threads, so call this off the audio thread
+    void Start(int numThreads);
+    void Stop();
+
+    int numThreads() const { return static_cast<int>(threads_.size()); }
+
+    // Run job(context, i) for every i in [0, numJobs), sharing the jobs
+    // between the workers and the calling thread, and return once all have
+    // finished. Realtime safe: no locks or allocation on the calling thread,
+    // which never waits for a worker to wake up before taking work itself.
+    // Must only be called from one thread at a time.
+    void Run(Job job, void* context, int numJobs);
+
+private:
+    void workerLoop();
+
+    // Take and run jobs from the given generation until none are left
+    void runJobs(uint32_t generation);
+
+    // Generation of the current Run() (high 32 bits), its job count (16 bits)
+    // and the next job index (low 16 bits). Jobs are claimed with a
+    // compare-and-swap, so a worker that wakes late can never take work from
+    // a later generation.
+    std::atomic<uint64_t> ticket_{0};
+    std::atomic<Job> job_{nullptr};
+    std::atomic<void*> context_{nullptr};
+    std::atomic<int> completed_{0};
+
+    std::atomic<bool> running_{false};
+
+    // Idle workers spin, then yield, then park on the condition variable
+    // with a short timeout; the audio thread only notifies when any are parked
+    std::atomic<int> parked_{0};
+    std::mutex parkMutex_;
+    std::condition_variable parkCondition_;
+
+    std::vector<std::thread> threads_;
+};
@@ -2,58 +2,65 @@
 // PlaitsVST: MIT License
 
 #include "resampler.h"
+#include <algorithm>
 
 void Resampler::Init(double sourceSampleRate, double targetSampleRate)
 {
     ratio_ = sourceSampleRate / targetSampleRate;
-    phase_ = 0.0;
-    lastSample_ = 0;
+    Reset();
 }
 
 void Resampler::Reset()
 {
     phase_ = 0.0;
-    lastSample_ = 0;
+    lastSample_ = 0.0f;
+    consumed_ = 0;
+}
+
+size_t Resampler::Process(const float* input, size_t inputSize,
+                          float* output, size_t maxOutputSize)
+{
+    return ProcessSamples(input, inputSize, output, maxOutputSize, 1.0f);
 }
 
 size_t Resampler::Process(const int16_t* input, size_t inputSize,
                           float* output, size_t maxOutputSize)
+{
+    return ProcessSamples(input, inputSize, output, maxOutputSize, 1.0f / 32768.0f);
+}
+
+template <typename T>
+size_t Resampler::ProcessSamples(const T* input, size_t inputSize,
+                                 float* output, size_t maxOutputSize, float scale)
 {
     size_t outputWritten = 0;
 
     while (outputWritten < maxOutputSize) {
-        // Calculate which input samples we're interpolating between
-        size_t idx0 = static_cast<size_t>(phase_);
+        // Output position lies between input[idx - 1] and input[idx],
+        // where input[-1] is the last sample of the previous block
+        size_t idx = static_cast<size_t>(phase_);
 
-        if (idx0 >= inputSize) {
+        if (idx >= inputSize) {
             // Consumed all input
             break;
         }
 
-        // Get samples for interpolation
-        int16_t s0 = (idx0 == 0 && phase_ < 1.0) ? lastSample_ : input[idx0];
-        int16_t s1 = (idx0 + 1 < inputSize) ? input[idx0 + 1] : input[idx0];
+        float s0 = (idx == 0) ? lastSample_ : static_cast<float>(input[idx - 1]) * scale;
+        float s1 = static_cast<float>(input[idx]) * scale;
 
         // Linear interpolation
-        double frac = phase_ - static_cast<double>(idx0);
-        double interpolated = s0 + (s1 - s0) * frac;
-
-        // Convert to float (-1.0 to 1.0)
-        output[outputWritten++] = static_cast<float>(interpolated / 32768.0);
+        float frac = static_cast<float>(phase_ - static_cast<double>(idx));
+        output[outputWritten++] = s0 + (s1 - s0) * frac;
 
         // Advance phase by ratio (consuming ratio_ input samples per output sample)
         phase_ += ratio_;
     }
 
-    // Save last sample for next block's interpolation
-    if (inputSize > 0) {
-        lastSample_ = input[inputSize - 1];
-    }
-
-    // Adjust phase to be relative to next block
-    phase_ -= static_cast<double>(inputSize);
-    if (phase_ < 0.0) {
-        phase_ = 0.0;
+    // Everything before the current position is no longer needed
+    consumed_ = std::min(static_cast<size_t>(phase_), inputSize);
+    if (consumed_ > 0) {
+        lastSample_ = static_cast<float>(input[consumed_ - 1]) * scale;
+        phase_ -= static_cast<double>(consumed_);
     }
 
     return outputWritten;
@@ -14,15 +14,29 @@ public:
     void Init(double sourceSampleRate, double targetSampleRate);
     void Reset();
 
-    // Process input samples (int16) and produce output samples (float)
-    // Returns number of output samples written
+    // Process input samples and produce output samples (float)
+    // Stops when the input is exhausted or maxOutputSize samples have been
+    // written. Returns number of output samples written; input samples that
+    // were not needed are left unconsumed (see consumed()).
+    size_t Process(const float* input, size_t inputSize,
+                   float* output, size_t maxOutputSize);
+
+    // int16 input variant, scaled to -1.0 to 1.0
     size_t Process(const int16_t* input, size_t inputSize,
                    float* output, size_t maxOutputSize);
 
+    // Number of input samples consumed by the last call to Process()
+    size_t consumed() const { return consumed_; }
+
     double ratio() const { return ratio_; }
 
 private:
+    template <typename T>
+    size_t ProcessSamples(const T* input, size_t inputSize,
+                          float* output, size_t maxOutputSize, float scale);
+
     double ratio_ = 1.0;           // source/target ratio
     double phase_ = 0.0;           // Fractional position in input
-    int16_t lastSample_ = 0;       // Previous sample for interpolation
+    float lastSample_ = 0.0f;      // Previous sample for interpolation
+    size_t consumed_ = 0;
 };
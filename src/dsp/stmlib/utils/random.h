@@ -55,7 +55,10 @@ class Random {
   }
 
  private:
-  static uint32_t rng_state_;
+  // One generator per thread, so voices rendering on different threads never
+  // share state. plaits::Voice swaps its own state in and out around
+  // rendering, which makes each voice reproducible on its own.
+  static thread_local uint32_t rng_state_;
 
   DISALLOW_COPY_AND_ASSIGN(Random);
 };
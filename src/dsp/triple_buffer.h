@@ -0,0 +1,50 @@
+// TripleBuffer - hands whole values from one thread to another, lock-free
+// PlaitsVST: MIT License
+
+#pragma once
+
+#include <atomic>
+
+// One writer thread fills the back buffer and publishes it. One reader
+// thread picks up the newest published value. Publishing and reading each
+// swap a single atomic index. Neither side ever waits, and the reader never
+// sees a partly written value. Two buffers wouldn't be enough: with the
+// third, the writer always has a buffer the reader isn't using.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer: fill this, then publish() it
+    T& writeBuffer() { return buffers_[back_]; }
+
+    void publish()
+    {
+        int previous = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+        back_ = previous & kIndexMask;
+    }
+
+    // Reader: the newest published value, or nullptr if nothing was
+    // published since the last read. Valid until the next read().
+    const T* read()
+    {
+        if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0) {
+            return nullptr;
+        }
+        int previous = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = previous & kIndexMask;
+        return &buffers_[front_];
+    }
+
+private:
+    static constexpr int kIndexMask = 3;
+    static constexpr int kFresh = 4;
+
+    T buffers_[3] = {};
+    int back_ = 0;                   // Writer's
+    int front_ = 1;                  // Reader's
+    std::atomic<int> middle_{2};     // Last published, flagged until read
+};
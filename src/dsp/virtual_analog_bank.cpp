@@ -0,0 +1,535 @@
+// Virtual analog engine state for every voice, rendered four voices at a time
+// Part of PlaitsVST - GPL v3
+
+#include "virtual_analog_bank.h"
+#include "plaits/dsp/simd_float4.h"
+#include "plaits/dsp/oscillator/oscillator.h"
+#include "plaits/dsp/oscillator/variable_saw_oscillator.h"
+#include "stmlib/dsp/dsp.h"
+#include <algorithm>
+
+namespace plaits {
+
+namespace {
+    constexpr int kLanes = VirtualAnalogBank::kLanes;
+
+    // stmlib/dsp/polyblep.h, lane by lane
+    inline Float4 ThisBlepSample(Float4 t)
+    {
+        return Float4(0.5f) * t * t;
+    }
+
+    inline Float4 NextBlepSample(Float4 t)
+    {
+        t = Float4(1.0f) - t;
+        return Float4(-0.5f) * t * t;
+    }
+
+    inline Float4 NextIntegratedBlepSample(Float4 t)
+    {
+        const Float4 t1 = Float4(0.5f) * t;
+        const Float4 t2 = t1 * t1;
+        const Float4 t4 = t2 * t2;
+        return Float4(0.1875f) - t1 + Float4(1.5f) * t2 - t4;
+    }
+
+    inline Float4 ThisIntegratedBlepSample(Float4 t)
+    {
+        return NextIntegratedBlepSample(Float4(1.0f) - t);
+    }
+
+    // stmlib::ParameterInterpolator, lane by lane
+    struct Interpolator {
+        Float4 value;
+        Float4 increment;
+
+        void Init(Float4 current, Float4 target, size_t size)
+        {
+            value = current;
+            increment = (target - current) / Float4(static_cast<float>(size));
+        }
+
+        Float4 Next()
+        {
+            value += increment;
+            return value;
+        }
+    };
+
+    template <typename Array>
+    Float4 Gather(const Array& values, const int* voices)
+    {
+        return Float4::Set(values[voices[0]], values[voices[1]], values[voices[2]], values[voices[3]]);
+    }
+
+    template <typename Array>
+    void Scatter(Array& values, const int* voices, int count, Float4 lanes)
+    {
+        float v[kLanes];
+        lanes.Store(v);
+        for (int i = 0; i < count; ++i) {
+            values[voices[i]] = v[i];
+        }
+    }
+
+    inline Mask4 GatherMask(const float* values, const int* voices)
+    {
+        return Gather(values, voices) >= Float4(0.5f);
+    }
+
+    inline void ScatterMask(float* values, const int* voices, int count, Mask4 lanes)
+    {
+        Scatter(values, voices, count, Select(lanes, Float4(1.0f), Float4(0.0f)));
+    }
+
+    // Settings of one VariableShapeOscillator for one voice, clamped as
+    // VariableShapeOscillator::Render() clamps them
+    struct ShapeTarget {
+        float master_frequency;
+        float frequency;
+        float pw;
+        float waveshape;
+    };
+
+    inline ShapeTarget MakeShapeTarget(float master_frequency, float frequency, float pw, float waveshape)
+    {
+        master_frequency = std::min(master_frequency, kMaxFrequency);
+        frequency = std::min(frequency, kMaxFrequency);
+        if (frequency >= 0.25f) {
+            pw = 0.5f;
+        } else {
+            CONSTRAIN(pw, frequency * 2.0f, 1.0f - 2.0f * frequency);
+        }
+        return { master_frequency, frequency, pw, waveshape };
+    }
+
+    // VariableShapeOscillator::Render<true, false>, one sample per lane
+    struct ShapeLanes {
+        Float4 master_phase;
+        Float4 slave_phase;
+        Float4 next_sample;
+        Float4 previous_pw;
+        Mask4 high;
+        Interpolator master_fm;
+        Interpolator fm;
+        Interpolator pwm;
+        Interpolator waveshape_modulation;
+
+        template <typename State>
+        void Load(const State& s, const int* voices, const ShapeTarget* targets, size_t size)
+        {
+            master_phase = Gather(s.master_phase, voices);
+            slave_phase = Gather(s.slave_phase, voices);
+            next_sample = Gather(s.next_sample, voices);
+            previous_pw = Gather(s.previous_pw, voices);
+            high = GatherMask(s.high, voices);
+            master_fm.Init(Gather(s.master_frequency, voices), Float4::Set(
+                targets[0].master_frequency, targets[1].master_frequency,
+                targets[2].master_frequency, targets[3].master_frequency), size);
+            fm.Init(Gather(s.slave_frequency, voices), Float4::Set(
+                targets[0].frequency, targets[1].frequency,
+                targets[2].frequency, targets[3].frequency), size);
+            pwm.Init(Gather(s.pw, voices), Float4::Set(
+                targets[0].pw, targets[1].pw, targets[2].pw, targets[3].pw), size);
+            waveshape_modulation.Init(Gather(s.waveshape, voices), Float4::Set(
+                targets[0].waveshape, targets[1].waveshape,
+                targets[2].waveshape, targets[3].waveshape), size);
+        }
+
+        template <typename State>
+        void Store(State& s, const int* voices, int count) const
+        {
+            Scatter(s.master_phase, voices, count, master_phase);
+            Scatter(s.slave_phase, voices, count, slave_phase);
+            Scatter(s.next_sample, voices, count, next_sample);
+            Scatter(s.previous_pw, voices, count, previous_pw);
+            ScatterMask(s.high, voices, count, high);
+            Scatter(s.master_frequency, voices, count, master_fm.value);
+            Scatter(s.slave_frequency, voices, count, fm.value);
+            Scatter(s.pw, voices, count, pwm.value);
+            Scatter(s.waveshape, voices, count, waveshape_modulation.value);
+        }
+
+        static Float4 ComputeNaiveSample(Float4 phase, Float4 pw, Float4 slope_up, Float4 slope_down,
+                                         Float4 triangle_amount, Float4 square_amount)
+        {
+            const Mask4 low = phase < pw;
+            Float4 saw = phase;
+            Float4 square = Select(low, Float4(0.0f), Float4(1.0f));
+            Float4 triangle = Select(low, phase * slope_up, Float4(1.0f) - (phase - pw) * slope_down);
+            saw += (square - saw) * square_amount;
+            saw += (triangle - saw) * triangle_amount;
+            return saw;
+        }
+
+        Float4 Next()
+        {
+            Float4 this_sample = next_sample;
+            Float4 next = 0.0f;
+
+            const Float4 master_frequency = master_fm.Next();
+            const Float4 slave_frequency = fm.Next();
+            const Float4 pw = pwm.Next();
+            const Float4 waveshape = waveshape_modulation.Next();
+
+            const Float4 square_amount = Max(waveshape - Float4(0.5f), Float4(0.0f)) * Float4(2.0f);
+            const Float4 triangle_amount = Max(Float4(1.0f) - waveshape * Float4(2.0f), Float4(0.0f));
+
+            const Float4 slope_up = Float4(1.0f) / pw;
+            const Float4 slope_down = Float4(1.0f) / (Float4(1.0f) - pw);
+
+            // Hard sync to the master
+            master_phase += master_frequency;
+            const Mask4 reset = master_phase >= Float4(1.0f);
+            master_phase = Select(reset, master_phase - Float4(1.0f), master_phase);
+            const Float4 reset_time = Select(reset, master_phase / master_frequency, Float4(0.0f));
+
+            Float4 phase_at_reset = slave_phase + (Float4(1.0f) - reset_time) * slave_frequency;
+            const Mask4 wrapped = phase_at_reset >= Float4(1.0f);
+            phase_at_reset = Select(wrapped, phase_at_reset - Float4(1.0f), phase_at_reset);
+            const Mask4 transition_during_reset =
+                reset & (wrapped | AndNot(phase_at_reset >= pw, high));
+
+            const Float4 value = ComputeNaiveSample(phase_at_reset, pw, slope_up, slope_down,
+                                                    triangle_amount, square_amount);
+            this_sample = Select(reset, this_sample - value * ThisBlepSample(reset_time), this_sample);
+            next = Select(reset, next - value * NextBlepSample(reset_time), next);
+
+            // Each lane leaves the transition loop at its own break
+            slave_phase += slave_frequency;
+            Mask4 looping = transition_during_reset | AndNot(AllLanes(), reset);
+            while (Any(looping)) {
+                const Mask4 low = AndNot(looping, high);
+                const Mask4 stays_low = low & (slave_phase < pw);
+                looping = AndNot(looping, stays_low);
+                const Mask4 rise = AndNot(low, stays_low);
+                if (Any(rise)) {
+                    const Float4 t = (slave_phase - pw) / (previous_pw - pw + slave_frequency);
+                    Float4 triangle_step = (slope_up + slope_down) * slave_frequency;
+                    triangle_step = triangle_step * triangle_amount;
+
+                    this_sample = Select(rise, this_sample + square_amount * ThisBlepSample(t), this_sample);
+                    next = Select(rise, next + square_amount * NextBlepSample(t), next);
+                    this_sample = Select(rise, this_sample - triangle_step * ThisIntegratedBlepSample(t), this_sample);
+                    next = Select(rise, next - triangle_step * NextIntegratedBlepSample(t), next);
+                    high = high | rise;
+                }
+
+                const Mask4 is_high = looping & high;
+                const Mask4 stays_high = is_high & (slave_phase < Float4(1.0f));
+                looping = AndNot(looping, stays_high);
+                const Mask4 fall = AndNot(is_high, stays_high);
+                if (Any(fall)) {
+                    slave_phase = Select(fall, slave_phase - Float4(1.0f), slave_phase);
+                    const Float4 t = slave_phase / slave_frequency;
+                    Float4 triangle_step = (slope_up + slope_down) * slave_frequency;
+                    triangle_step = triangle_step * triangle_amount;
+
+                    const Float4 square_step = Float4(1.0f) - triangle_amount;
+                    this_sample = Select(fall, this_sample - square_step * ThisBlepSample(t), this_sample);
+                    next = Select(fall, next - square_step * NextBlepSample(t), next);
+                    this_sample = Select(fall, this_sample + triangle_step * ThisIntegratedBlepSample(t), this_sample);
+                    next = Select(fall, next + triangle_step * NextIntegratedBlepSample(t), next);
+                    high = AndNot(high, fall);
+                }
+            }
+
+            slave_phase = Select(reset, reset_time * slave_frequency, slave_phase);
+            high = AndNot(high, reset);
+
+            next += ComputeNaiveSample(slave_phase, pw, slope_up, slope_down,
+                                       triangle_amount, square_amount);
+            previous_pw = pw;
+            next_sample = next;
+
+            return Float4(2.0f) * this_sample - Float4(1.0f);
+        }
+    };
+
+    // VariableSawOscillator::Render, one sample per lane
+    struct SawLanes {
+        Float4 phase;
+        Float4 next_sample;
+        Float4 previous_pw;
+        Mask4 high;
+        Interpolator fm;
+        Interpolator pwm;
+        Interpolator waveshape_modulation;
+
+        template <typename State>
+        void Load(const State& s, const int* voices, Float4 frequency, Float4 pw, Float4 waveshape, size_t size)
+        {
+            phase = Gather(s.phase, voices);
+            next_sample = Gather(s.next_sample, voices);
+            previous_pw = Gather(s.previous_pw, voices);
+            high = GatherMask(s.high, voices);
+            fm.Init(Gather(s.frequency, voices), frequency, size);
+            pwm.Init(Gather(s.pw, voices), pw, size);
+            waveshape_modulation.Init(Gather(s.waveshape, voices), waveshape, size);
+        }
+
+        template <typename State>
+        void Store(State& s, const int* voices, int count) const
+        {
+            Scatter(s.phase, voices, count, phase);
+            Scatter(s.next_sample, voices, count, next_sample);
+            Scatter(s.previous_pw, voices, count, previous_pw);
+            ScatterMask(s.high, voices, count, high);
+            Scatter(s.frequency, voices, count, fm.value);
+            Scatter(s.pw, voices, count, pwm.value);
+            Scatter(s.waveshape, voices, count, waveshape_modulation.value);
+        }
+
+        Float4 Next()
+        {
+            Float4 this_sample = next_sample;
+            Float4 next = 0.0f;
+
+            const Float4 frequency = fm.Next();
+            const Float4 pw = pwm.Next();
+            const Float4 waveshape = waveshape_modulation.Next();
+            const Float4 triangle_amount = waveshape;
+            const Float4 notch_amount = Float4(1.0f) - waveshape;
+            const Float4 slope_up = Float4(1.0f) / pw;
+            const Float4 slope_down = Float4(1.0f) / (Float4(1.0f) - pw);
+
+            phase += frequency;
+
+            const Mask4 rise = AndNot(phase >= pw, high);
+            const Mask4 fall = AndNot(phase >= Float4(1.0f), rise);
+            if (Any(rise)) {
+                const Float4 triangle_step = (slope_up + slope_down) * frequency * triangle_amount;
+                const Float4 notch = (Float4(kVariableSawNotchDepth + 1.0f) - pw) * notch_amount;
+                const Float4 t = (phase - pw) / (previous_pw - pw + frequency);
+                this_sample = Select(rise, this_sample + notch * ThisBlepSample(t), this_sample);
+                next = Select(rise, next + notch * NextBlepSample(t), next);
+                this_sample = Select(rise, this_sample - triangle_step * ThisIntegratedBlepSample(t), this_sample);
+                next = Select(rise, next - triangle_step * NextIntegratedBlepSample(t), next);
+                high = high | rise;
+            }
+            if (Any(fall)) {
+                phase = Select(fall, phase - Float4(1.0f), phase);
+                const Float4 triangle_step = (slope_up + slope_down) * frequency * triangle_amount;
+                const Float4 notch = Float4(kVariableSawNotchDepth + 1.0f) * notch_amount;
+                const Float4 t = phase / frequency;
+                this_sample = Select(fall, this_sample - notch * ThisBlepSample(t), this_sample);
+                next = Select(fall, next - notch * NextBlepSample(t), next);
+                this_sample = Select(fall, this_sample + triangle_step * ThisIntegratedBlepSample(t), this_sample);
+                next = Select(fall, next + triangle_step * NextIntegratedBlepSample(t), next);
+                high = AndNot(high, fall);
+            }
+
+            const Mask4 low = phase < pw;
+            const Float4 notch_saw = Select(low, phase, Float4(1.0f + kVariableSawNotchDepth));
+            const Float4 triangle = Select(low, phase * slope_up, Float4(1.0f) - (phase - pw) * slope_down);
+            next += notch_saw * notch_amount + triangle * triangle_amount;
+            previous_pw = pw;
+            next_sample = next;
+
+            return (Float4(2.0f) * this_sample - Float4(1.0f)) / Float4(1.0f + kVariableSawNotchDepth);
+        }
+    };
+
+    // VirtualAnalogEngine::ComputeDetuning
+    const float kIntervals[5] = { 0.0f, 7.01f, 12.01f, 19.01f, 24.01f };
+
+    inline float Squash(float x)
+    {
+        return x * x * (3.0f - 2.0f * x);
+    }
+
+    float ComputeDetuning(float detune)
+    {
+        detune = 2.05f * detune - 1.025f;
+        CONSTRAIN(detune, -1.0f, 1.0f);
+
+        float sign = detune < 0.0f ? -1.0f : 1.0f;
+        detune = detune * sign * 3.9999f;
+        MAKE_INTEGRAL_FRACTIONAL(detune);
+
+        float a = kIntervals[detune_integral];
+        float b = kIntervals[detune_integral + 1];
+        return (a + (b - a) * Squash(Squash(detune_fractional))) * sign;
+    }
+
+    // Everything VirtualAnalogEngine::Render() works out per block, for one voice
+    struct VoiceSettings {
+        ShapeTarget primary;
+        ShapeTarget auxiliary;
+        ShapeTarget square;
+        float saw_frequency;
+        float saw_pw;
+        float saw_shape;
+        float square_gain;
+        float saw_gain;
+    };
+
+    VoiceSettings ComputeSettings(const EngineParameters& parameters)
+    {
+        const float sync_amount = parameters.timbre * parameters.timbre;
+        const float auxiliary_detune = ComputeDetuning(parameters.harmonics);
+        const float primary_f = NoteToFrequency(parameters.note);
+        const float auxiliary_f = NoteToFrequency(parameters.note + auxiliary_detune);
+        const float primary_sync_f = NoteToFrequency(parameters.note + sync_amount * 48.0f);
+        const float auxiliary_sync_f = NoteToFrequency(
+            parameters.note + auxiliary_detune + sync_amount * 48.0f);
+
+        float shape = parameters.morph * 1.5f;
+        CONSTRAIN(shape, 0.0f, 1.0f);
+
+        float pw = 0.5f + (parameters.morph - 0.66f) * 1.46f;
+        CONSTRAIN(pw, 0.5f, 0.995f);
+
+        float square_pw = 1.3f * parameters.timbre - 0.15f;
+        CONSTRAIN(square_pw, 0.005f, 0.5f);
+
+        const float square_sync_ratio = parameters.timbre < 0.5f
+            ? 0.0f
+            : (parameters.timbre - 0.5f) * (parameters.timbre - 0.5f) * 4.0f * 48.0f;
+
+        const float square_gain = std::min(parameters.timbre * 8.0f, 1.0f);
+
+        float saw_pw = parameters.morph < 0.5f
+            ? parameters.morph + 0.5f
+            : 1.0f - (parameters.morph - 0.5f) * 2.0f;
+        saw_pw *= 1.1f;
+        CONSTRAIN(saw_pw, 0.005f, 1.0f);
+
+        float saw_shape = 10.0f - 21.0f * parameters.morph;
+        CONSTRAIN(saw_shape, 0.0f, 1.0f);
+
+        float saw_gain = 8.0f * (1.0f - parameters.morph);
+        CONSTRAIN(saw_gain, 0.02f, 1.0f);
+
+        const float square_sync_f = NoteToFrequency(parameters.note + square_sync_ratio);
+
+        // VariableSawOscillator::Render() clamps the same way
+        float saw_frequency = std::min(auxiliary_f, kMaxFrequency);
+        if (saw_frequency >= 0.25f) {
+            saw_pw = 0.5f;
+        } else {
+            CONSTRAIN(saw_pw, saw_frequency * 2.0f, 1.0f - 2.0f * saw_frequency);
+        }
+
+        const float norm = 1.0f / (std::max(square_gain, saw_gain));
+
+        VoiceSettings settings;
+        settings.primary = MakeShapeTarget(primary_f, primary_sync_f, pw, shape);
+        settings.auxiliary = MakeShapeTarget(auxiliary_f, auxiliary_sync_f, pw, shape);
+        settings.square = MakeShapeTarget(primary_f, square_sync_f, square_pw, 1.0f);
+        settings.saw_frequency = saw_frequency;
+        settings.saw_pw = saw_pw;
+        settings.saw_shape = saw_shape;
+        settings.square_gain = square_gain * 0.3f * norm;
+        settings.saw_gain = saw_gain * 0.5f * norm;
+        return settings;
+    }
+}
+
+void VirtualAnalogBank::Init()
+{
+    for (int voice = 0; voice < kMaxVoices; ++voice) {
+        Reset(voice);
+    }
+}
+
+void VirtualAnalogBank::ResetShape(ShapeState& state, int voice, float master_phase)
+{
+    state.master_phase[voice] = master_phase;
+    state.slave_phase[voice] = 0.0f;
+    state.next_sample[voice] = 0.0f;
+    state.previous_pw[voice] = 0.5f;
+    state.high[voice] = 0.0f;
+    state.master_frequency[voice] = 0.0f;
+    state.slave_frequency[voice] = 0.01f;
+    state.pw[voice] = 0.5f;
+    state.waveshape[voice] = 0.0f;
+}
+
+void VirtualAnalogBank::Reset(int voice)
+{
+    ResetShape(primary_, voice, 0.0f);
+    ResetShape(auxiliary_, voice, 0.25f);
+    ResetShape(sync_, voice, 0.0f);
+
+    variable_saw_.phase[voice] = 0.0f;
+    variable_saw_.next_sample[voice] = 0.0f;
+    variable_saw_.previous_pw[voice] = 0.5f;
+    variable_saw_.high[voice] = 0.0f;
+    variable_saw_.frequency[voice] = 0.01f;
+    variable_saw_.pw[voice] = 0.5f;
+    variable_saw_.waveshape[voice] = 0.0f;
+
+    square_gain_[voice] = 0.0f;
+    saw_gain_[voice] = 0.0f;
+}
+
+void VirtualAnalogBank::Render(const int* voices, const EngineParameters* parameters,
+                               float* const* out, float* const* aux, int count, size_t size)
+{
+    // Spare lanes repeat the first voice; their results are dropped
+    int lanes[kLanes];
+    VoiceSettings settings[kLanes];
+    for (int i = 0; i < kLanes; ++i) {
+        const int source = i < count ? i : 0;
+        lanes[i] = voices[source];
+        settings[i] = i < count ? ComputeSettings(parameters[i]) : settings[0];
+    }
+
+    auto gather = [&settings](auto member) {
+        return Float4::Set(member(settings[0]), member(settings[1]),
+                           member(settings[2]), member(settings[3]));
+    };
+
+    ShapeLanes primary, auxiliary, square;
+    ShapeTarget targets[kLanes];
+    for (int i = 0; i < kLanes; ++i) targets[i] = settings[i].primary;
+    primary.Load(primary_, lanes, targets, size);
+    for (int i = 0; i < kLanes; ++i) targets[i] = settings[i].auxiliary;
+    auxiliary.Load(auxiliary_, lanes, targets, size);
+    for (int i = 0; i < kLanes; ++i) targets[i] = settings[i].square;
+    square.Load(sync_, lanes, targets, size);
+
+    SawLanes saw;
+    saw.Load(variable_saw_, lanes,
+             gather([](const VoiceSettings& s) { return s.saw_frequency; }),
+             gather([](const VoiceSettings& s) { return s.saw_pw; }),
+             gather([](const VoiceSettings& s) { return s.saw_shape; }), size);
+
+    Interpolator square_gain, saw_gain;
+    square_gain.Init(Gather(square_gain_, lanes),
+                     gather([](const VoiceSettings& s) { return s.square_gain; }), size);
+    saw_gain.Init(Gather(saw_gain_, lanes),
+                  gather([](const VoiceSettings& s) { return s.saw_gain; }), size);
+
+    // OUT = variable square + variable saw; AUX = the two synced varishapes
+    alignas(16) float outLanes[kMaxBlockSize][kLanes];
+    alignas(16) float auxLanes[kMaxBlockSize][kLanes];
+    for (size_t i = 0; i < size; ++i) {
+        const Float4 p = primary.Next();
+        const Float4 a = auxiliary.Next();
+        ((a - p) * Float4(0.5f)).Store(auxLanes[i]);
+
+        const Float4 s = square.Next();
+        const Float4 v = saw.Next();
+        const Float4 saw_level = saw_gain.Next();
+        const Float4 square_level = square_gain.Next();
+        (v * saw_level + square_level * s).Store(outLanes[i]);
+    }
+
+    primary.Store(primary_, lanes, count);
+    auxiliary.Store(auxiliary_, lanes, count);
+    square.Store(sync_, lanes, count);
+    saw.Store(variable_saw_, lanes, count);
+    Scatter(square_gain_, lanes, count, square_gain.value);
+    Scatter(saw_gain_, lanes, count, saw_gain.value);
+
+    for (int lane = 0; lane < count; ++lane) {
+        for (size_t i = 0; i < size; ++i) {
+            out[lane][i] = outLanes[i][lane];
+            aux[lane][i] = auxLanes[i][lane];
+        }
+    }
+}
+
+} // namespace plaits
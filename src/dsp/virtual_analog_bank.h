@@ -0,0 +1,78 @@
+// Virtual analog engine state for every voice, rendered four voices at a time
+// Part of PlaitsVST - GPL v3
+
+#pragma once
+
+#include <cstddef>
+#include "plaits/dsp/engine/engine.h"
+
+namespace plaits {
+
+// Lane-parallel version of VirtualAnalogEngine (VA_VARIANT 2). It holds the
+// engine's four oscillators and two gain interpolators for up to kMaxVoices
+// voices, stored structure-of-arrays by voice. Render() gathers up to four
+// voices into the lanes of one vector and runs their oscillators together.
+// It then scatters the state back, so any set of voices can share a call.
+// Each lane computes what VirtualAnalogEngine::Render() would for that voice.
+//
+// This is the only batched engine. Vectors are Float4 (SSE2, NEON or
+// scalar), so there is no 8-lane AVX path, and the other oscillator-based
+// engines still render one voice at a time.
+class VirtualAnalogBank {
+public:
+    static constexpr int kMaxVoices = 16;
+    static constexpr int kLanes = 4;
+
+    VirtualAnalogBank() = default;
+    ~VirtualAnalogBank() = default;
+
+    void Init();
+
+    // Start a voice over, as VirtualAnalogEngine::Init() does when the engine
+    // is selected
+    void Reset(int voice);
+
+    // Render count (1 to kLanes) voices: lane i renders voices[i] with
+    // parameters[i] into out[i] and aux[i]. size is at most kMaxBlockSize.
+    void Render(const int* voices, const EngineParameters* parameters,
+                float* const* out, float* const* aux, int count, size_t size);
+
+private:
+    // VariableShapeOscillator, per voice
+    struct ShapeState {
+        float master_phase[kMaxVoices];
+        float slave_phase[kMaxVoices];
+        float next_sample[kMaxVoices];
+        float previous_pw[kMaxVoices];
+        float high[kMaxVoices];
+        float master_frequency[kMaxVoices];
+        float slave_frequency[kMaxVoices];
+        float pw[kMaxVoices];
+        float waveshape[kMaxVoices];
+    };
+
+    // VariableSawOscillator, per voice
+    struct SawState {
+        float phase[kMaxVoices];
+        float next_sample[kMaxVoices];
+        float previous_pw[kMaxVoices];
+        float high[kMaxVoices];
+        float frequency[kMaxVoices];
+        float pw[kMaxVoices];
+        float waveshape[kMaxVoices];
+    };
+
+    static void ResetShape(ShapeState& state, int voice, float master_phase);
+
+    ShapeState primary_ = {};
+    ShapeState auxiliary_ = {};
+    ShapeState sync_ = {};
+    SawState variable_saw_ = {};
+
+    // The engine's auxiliary_amount_ and xmod_amount_, which VA_VARIANT 2
+    // uses as the square and saw gains
+    float square_gain_[kMaxVoices] = {};
+    float saw_gain_[kMaxVoices] = {};
+};
+
+} // namespace plaits
@@ -1,8 +1,9 @@
-// Voice class - wraps Plaits voice with envelope and resampling
+// Voice class - wraps Plaits voice with envelope
 // PlaitsVST: MIT License
 
 #include "voice.h"
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include "stmlib/utils/buffer_allocator.h"
 
@@ -13,23 +14,23 @@ Voice::Voice()
 
 Voice::~Voice() = default;
 
-void Voice::Init(double hostSampleRate)
+void Voice::Init()
 {
-    hostSampleRate_ = hostSampleRate;
+    // Initialize Plaits voice with buffer allocator. Engines are built from
+    // it when first selected, and pick up the plaits::SampleRate() in scope
+    allocator_.Init(voiceBuffer_.get(), kVoiceBufferSize);
+    plaitsVoice_.Init(&allocator_);
 
-    // Initialize Plaits voice with buffer allocator
-    stmlib::BufferAllocator allocator;
-    allocator.Init(voiceBuffer_.get(), kVoiceBufferSize);
-    plaitsVoice_.Init(&allocator);
-
-    envelope_.Init(kInternalSampleRate);
-    resamplerOut_.Init(kInternalSampleRate, hostSampleRate);
-    resamplerAux_.Init(kInternalSampleRate, hostSampleRate);
+    envelope_.Init(plaits::SampleRate());
+    silenceHoldSamples_ = static_cast<size_t>(plaits::SampleRate() * kSilenceHoldSeconds);
 
     active_ = false;
     note_ = -1;
     velocity_ = 0.0f;
     triggerPending_ = false;
+    gateHigh_ = false;
+    silentSamples_ = 0;
+    setOutputDelay(0);
 }
 
 void Voice::NoteOn(int note, float velocity, float attackMs, float decayMs)
@@ -38,13 +39,10 @@ void Voice::NoteOn(int note, float velocity, float attackMs, float decayMs)
     velocity_ = velocity;
     active_ = true;
     triggerPending_ = true;
+    silentSamples_ = 0;
 
     // Trigger envelope
     envelope_.Trigger(attackMs, decayMs);
-
-    // Reset resamplers for clean start
-    resamplerOut_.Reset();
-    resamplerAux_.Reset();
 }
 
 void Voice::NoteOff()
@@ -55,90 +53,120 @@ void Voice::NoteOff()
 
 void Voice::Process(float* leftOutput, float* rightOutput, size_t size)
 {
-    if (!active_) {
-        return;
-    }
+    size_t written = 0;
 
-    size_t outputWritten = 0;
-
-    while (outputWritten < size) {
-        size_t outputRemaining = size - outputWritten;
-
-        // Generate internal samples at 48kHz
-        size_t internalSamples = std::min(kInternalBlockSize,
-            static_cast<size_t>(outputRemaining * resamplerOut_.ratio()) + 4);
-
-        // Set up Plaits patch and modulations
-        plaits::Patch patch;
-        patch.engine = engine_;
-        patch.note = 48.0f + static_cast<float>(note_ - 60);  // Center around MIDI 60
-        patch.harmonics = harmonics_;
-        patch.timbre = timbre_;
-        patch.morph = morph_;
-        patch.frequency_modulation_amount = 0.0f;
-        patch.timbre_modulation_amount = 0.0f;
-        patch.morph_modulation_amount = 0.0f;
-        patch.decay = lpgDecay_;
-        patch.lpg_colour = lpgColour_;
-
-        plaits::Modulations modulations;
-        modulations.engine = 0.0f;
-        modulations.note = 0.0f;
-        modulations.frequency = 0.0f;
-        modulations.harmonics = 0.0f;
-        modulations.timbre = 0.0f;
-        modulations.morph = 0.0f;
-        modulations.trigger = triggerPending_ ? 1.0f : 0.0f;
-        modulations.level = 1.0f;
-        modulations.frequency_patched = false;
-        modulations.timbre_patched = false;
-        modulations.morph_patched = false;
-        modulations.trigger_patched = true;  // Use trigger for note on
-        modulations.level_patched = false;
+    while (active_ && written < size) {
+        size_t internalSamples = std::min(kInternalBlockSize, size - written);
 
-        triggerPending_ = false;
-
-        // Render Plaits voice
-        plaitsVoice_.Render(patch, modulations, internalBuffer_, internalSamples);
+        plaits::EngineParameters parameters;
+        BeginBlock(&parameters);
+        RenderEngine(parameters, internalSamples);
+        EndBlock(leftOutput + written, rightOutput + written, internalSamples);
 
-        // Extract samples and apply envelope
-        for (size_t i = 0; i < internalSamples; ++i) {
-            float envValue = envelope_.Process();
+        written += internalSamples;
+    }
+}
 
-            // Apply envelope and velocity
-            float outSample = static_cast<float>(internalBuffer_[i].out) / 32768.0f;
-            float auxSample = static_cast<float>(internalBuffer_[i].aux) / 32768.0f;
+bool Voice::BeginBlock(plaits::EngineParameters* parameters)
+{
+    // Set up Plaits patch and modulations
+    plaits::Patch patch;
+    patch.engine = engine_;
+    patch.note = 48.0f + static_cast<float>(note_ - 60);  // Center around MIDI 60
+    patch.harmonics = harmonics_;
+    patch.timbre = timbre_;
+    patch.morph = morph_;
+    patch.frequency_modulation_amount = 0.0f;
+    patch.timbre_modulation_amount = 0.0f;
+    patch.morph_modulation_amount = 0.0f;
+    patch.decay = lpgDecay_;
+    patch.lpg_colour = lpgColour_;
+
+    plaits::Modulations modulations;
+    modulations.engine = 0.0f;
+    modulations.note = 0.0f;
+    modulations.frequency = 0.0f;
+    modulations.harmonics = 0.0f;
+    modulations.timbre = 0.0f;
+    modulations.morph = 0.0f;
+    modulations.trigger = nextTrigger();
+    modulations.level = 1.0f;
+    modulations.frequency_patched = false;
+    modulations.timbre_patched = false;
+    modulations.morph_patched = false;
+    modulations.trigger_patched = true;  // Use trigger for note on
+    modulations.level_patched = false;
+
+    return plaitsVoice_.BeginRender(patch, modulations, parameters);
+}
 
-            outSample *= envValue * velocity_;
-            auxSample *= envValue * velocity_;
+float Voice::nextTrigger()
+{
+    if (!holdsGate(engine_)) {
+        bool trigger = triggerPending_;
+        triggerPending_ = false;
+        gateHigh_ = trigger;
+        return trigger ? 1.0f : 0.0f;
+    }
 
-            outBuffer_[i] = static_cast<int16_t>(outSample * 32767.0f);
-            auxBuffer_[i] = static_cast<int16_t>(auxSample * 32767.0f);
+    // A note on while the gate is still high drops it for a block first, so
+    // the engine sees a new rising edge
+    if (triggerPending_) {
+        if (gateHigh_) {
+            gateHigh_ = false;
+        } else {
+            gateHigh_ = true;
+            triggerPending_ = false;
         }
+    }
+    return gateHigh_ ? 1.0f : 0.0f;
+}
 
-        // Check if envelope finished
-        if (envelope_.done()) {
-            active_ = false;
-        }
+void Voice::setOutputDelay(size_t samples)
+{
+    outputDelay_ = std::min(samples, kInternalBlockSize - 1);
+    delayIndex_ = 0;
+    std::fill_n(delayLeft_, kInternalBlockSize, 0.0f);
+    std::fill_n(delayRight_, kInternalBlockSize, 0.0f);
+}
 
-        // Resample to host rate
-        size_t maxOutput = std::min(outputRemaining, sizeof(resampledOut_) / sizeof(float));
-        size_t producedOut = resamplerOut_.Process(outBuffer_, internalSamples,
-                                                    resampledOut_, maxOutput);
-        resamplerAux_.Process(auxBuffer_, internalSamples, resampledAux_, maxOutput);
-
-        // Mix into output (main out to left, aux to right for stereo width)
-        for (size_t i = 0; i < producedOut; ++i) {
-            // Mix main and aux for stereo spread
-            leftOutput[outputWritten + i] += resampledOut_[i] * 0.7f + resampledAux_[i] * 0.3f;
-            rightOutput[outputWritten + i] += resampledOut_[i] * 0.3f + resampledAux_[i] * 0.7f;
+void Voice::EndBlock(float* leftOutput, float* rightOutput, size_t size)
+{
+    // Finish the Plaits voice (LPG and output stage)
+    bool ended = plaitsVoice_.EndRender(outBuffer_, auxBuffer_, size);
+
+    // Apply envelope and velocity, mix into output
+    float peak = 0.0f;
+    for (size_t i = 0; i < size; ++i) {
+        float gain = envelope_.Process() * velocity_;
+        float outSample = outBuffer_[i] * gain;
+        float auxSample = auxBuffer_[i] * gain;
+
+        // Mix main and aux for stereo spread
+        float left = outSample * 0.7f + auxSample * 0.3f;
+        float right = outSample * 0.3f + auxSample * 0.7f;
+        if (outputDelay_ > 0) {
+            std::swap(left, delayLeft_[delayIndex_]);
+            std::swap(right, delayRight_[delayIndex_]);
+            delayIndex_ = delayIndex_ + 1 == outputDelay_ ? 0 : delayIndex_ + 1;
         }
+        leftOutput[i] += left;
+        rightOutput[i] += right;
+        peak = std::max(peak, std::max(std::abs(outSample), std::abs(auxSample)));
+    }
 
-        outputWritten += producedOut;
+    // Percussive engines and closed LPGs fall silent long before a slow
+    // AD decay ends, so release the voice once its output stays quiet. Other
+    // engines can pause mid-note (speech, sparse particles), so their
+    // silence alone does not end the note
+    if (ended && envelope_.decaying() && peak < kSilenceThreshold) {
+        silentSamples_ += size;
+    } else {
+        silentSamples_ = 0;
+    }
 
-        // Safety check to prevent infinite loop
-        if (producedOut == 0 && internalSamples > 0) {
-            break;
-        }
+    // Check if envelope finished
+    if (envelope_.done() || silentSamples_ >= silenceHoldSamples_) {
+        active_ = false;
     }
 }
@@ -1,32 +1,64 @@
-// Voice class - wraps Plaits voice with envelope and resampling
+// Voice class - wraps Plaits voice with envelope
 // PlaitsVST: MIT License
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include "plaits/dsp/voice.h"
 #include "envelope.h"
-#include "resampler.h"
 
 class Voice {
 public:
+    // Default rendering rate (the Plaits hardware rate). Voices render at the
+    // plaits::SampleRate() in scope, which VoiceAllocator sets to the host
+    // rate when it can
     static constexpr double kInternalSampleRate = 48000.0;
     static constexpr size_t kInternalBlockSize = 24;
 
+    // A decaying voice whose output stays below the threshold (about -90 dB)
+    // for the hold time is released before its envelope ends, if its engine
+    // envelopes itself or its LPG has closed
+    static constexpr float kSilenceThreshold = 3.0e-5f;
+    static constexpr double kSilenceHoldSeconds = 0.05;
+
     Voice();
     ~Voice();
 
-    void Init(double hostSampleRate);
+    void Init();
 
     void NoteOn(int note, float velocity, float attackMs, float decayMs);
     void NoteOff();
 
+    // Seed the voice's random generator (noise, particle, drum engines...)
+    // Voices with the same seed and inputs render identically
+    void Seed(uint32_t seed) { plaitsVoice_.Seed(seed); }
+
     // Process and mix into output buffers (adds to existing content)
+    // Renders at plaits::SampleRate(); any resampling to the host rate is
+    // done once on the mixed bus by VoiceAllocator
     void Process(float* leftOutput, float* rightOutput, size_t size);
 
+    // Process() one internal block at a time, in steps, so VoiceAllocator can
+    // render the engines of several voices together. BeginBlock() fills in
+    // the engine parameters and returns true when the voice's engine has
+    // just been selected. The engine's output is then written to engineOut()
+    // and engineAux(), by RenderEngine() or by the caller, and EndBlock()
+    // applies the LPG and envelope and mixes size samples into the outputs.
+    bool BeginBlock(plaits::EngineParameters* parameters);
+    void RenderEngine(const plaits::EngineParameters& parameters, size_t size) { plaitsVoice_.RenderEngine(parameters, size); }
+    float* engineOut() { return plaitsVoice_.engine_out(); }
+    float* engineAux() { return plaitsVoice_.engine_aux(); }
+    void EndBlock(float* leftOutput, float* rightOutput, size_t size);
+
+    // UI engines: the 16 classic Plaits engines (0-15), then the 8 newer
+    // models (16-23), in registry order
+    static constexpr int kNumEngines = plaits::kMaxEngines;
+    static constexpr int kNumClassicEngines = 16;
+
     // Setters for parameters
-    // Maps UI engine index (0-15) to internal Plaits engine index
+    // Maps UI engine index (0-23) to internal Plaits engine index
     void set_engine(int engine) { engine_ = mapEngineIndex(engine); }
     void set_harmonics(float harmonics) { harmonics_ = harmonics; }
     void set_timbre(float timbre) { timbre_ = timbre; }
@@ -38,21 +70,51 @@ public:
     bool active() const { return active_; }
     int note() const { return note_; }
 
+    // Plaits engine index the voice renders (after mapEngineIndex)
+    int plaitsEngine() const { return engine_; }
+    static constexpr int kVirtualAnalogEngine = 8;
+
+    // Memory and measured CPU cost of a UI engine in this voice. The memory
+    // is zero until the voice has selected the engine, the CPU cost until it
+    // has rendered it for a while. Safe to read while another thread renders
+    plaits::EngineCost engineCost(int uiEngine) const {
+        return plaitsVoice_.engine_cost(mapEngineIndex(uiEngine));
+    }
+
+    // For callers that render the engine themselves: whether to time this
+    // block's render, and its time per sample if so
+    bool timeNextRender() { return plaitsVoice_.TimeNextRender(); }
+    void recordRenderTime(float nsPerSample) { plaitsVoice_.RecordRenderTime(nsPerSample); }
+
+    // Delay the voice's output by up to one internal block, so a note that
+    // starts part way into a block renders on the same block grid as the
+    // other voices yet sounds from its own sample. Clears the delay line
+    void setOutputDelay(size_t samples);
+
 private:
-    // Maps UI engine selection (0-15) to actual Plaits engine index
-    // Plaits has 24 engines, we expose the classic 16 (indices 8-23)
+    // Maps UI engine selection (0-23) to actual Plaits engine index
+    // The classic engines keep UI indices 0-15, which saved state and
+    // presets use, though in the registry they follow the newer models,
+    // starting with virtual analog
     static int mapEngineIndex(int uiEngine) {
-        // Classic Plaits engines start at index 8 in the engine registry
-        return uiEngine + 8;
+        uiEngine = std::clamp(uiEngine, 0, kNumEngines - 1);
+        return uiEngine < kNumClassicEngines
+            ? uiEngine + kVirtualAnalogEngine
+            : uiEngine - kNumClassicEngines;
     }
 
+    // The six-op engines play their DX7 envelopes from the trigger's gate, so
+    // it stays high for as long as the note sounds; other engines get a
+    // one-block pulse per note on
+    static bool holdsGate(int plaitsEngine) { return plaitsEngine >= 2 && plaitsEngine <= 4; }
+    float nextTrigger();
+
     plaits::Voice plaitsVoice_;
     Envelope envelope_;
-    Resampler resamplerOut_;
-    Resampler resamplerAux_;
 
-    // Memory buffer for Plaits voice
+    // Memory buffer for Plaits voice, shared by whichever engine is active
     std::unique_ptr<uint8_t[]> voiceBuffer_;
+    stmlib::BufferAllocator allocator_;
     static constexpr size_t kVoiceBufferSize = 32768;
 
     // Voice state
@@ -60,6 +122,9 @@ private:
     int note_ = -1;
     float velocity_ = 0.0f;
     bool triggerPending_ = false;
+    bool gateHigh_ = false;
+    size_t silentSamples_ = 0;
+    size_t silenceHoldSamples_ = static_cast<size_t>(kInternalSampleRate * kSilenceHoldSeconds);
 
     // Parameters
     int engine_ = 0;
@@ -70,11 +135,12 @@ private:
     float lpgColour_ = 0.5f;
 
     // Internal buffers
-    plaits::Voice::Frame internalBuffer_[kInternalBlockSize];
-    int16_t outBuffer_[kInternalBlockSize];
-    int16_t auxBuffer_[kInternalBlockSize];
-    float resampledOut_[256];
-    float resampledAux_[256];
-
-    double hostSampleRate_ = 48000.0;
+    float outBuffer_[kInternalBlockSize];
+    float auxBuffer_[kInternalBlockSize];
+
+    // Output delay line, see setOutputDelay()
+    float delayLeft_[kInternalBlockSize] = {};
+    float delayRight_[kInternalBlockSize] = {};
+    size_t outputDelay_ = 0;
+    size_t delayIndex_ = 0;
 };
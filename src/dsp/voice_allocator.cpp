@@ -2,19 +2,69 @@
 // PlaitsVST: MIT License
 
 #include "voice_allocator.h"
+#include "plaits/dsp/fm/fm_patch_bank.h"
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstring>
 
+namespace {
+    // Distinct, fixed seeds per voice slot: stacked noise voices stay
+    // uncorrelated, and a render after Init() is reproducible
+    uint32_t voiceSeed(size_t index)
+    {
+        return plaits::kDefaultRandomSeed + static_cast<uint32_t>(index) * 0x9e3779b9u;
+    }
+}
+
+VoiceAllocator::VoiceAllocator()
+{
+    harmonics_.fill(0.5f);
+    timbre_.fill(0.5f);
+    morph_.fill(0.5f);
+}
+
 void VoiceAllocator::Init(double hostSampleRate, int polyphony)
 {
     hostSampleRate_ = hostSampleRate;
     polyphony_ = std::clamp(polyphony, 1, static_cast<int>(kMaxVoices));
     noteCounter_ = 0;
 
+    // Render at the host rate when the engines support it. Engines must be
+    // initialised at the rendering rate
+    bool native = hostSampleRate >= kMinNativeSampleRate &&
+                  hostSampleRate <= kMaxNativeSampleRate;
+    renderSampleRate_ = native ? hostSampleRate : Voice::kInternalSampleRate;
+    renderRateSettings_.Init(static_cast<float>(renderSampleRate_));
+    plaits::ScopedSampleRate sampleRate(&renderRateSettings_);
+
     for (size_t i = 0; i < kMaxVoices; ++i) {
-        voices_[i].Init(hostSampleRate);
+        voices_[i].Init();
+        voices_[i].Seed(voiceSeed(i));
         voiceAge_[i] = 0;
     }
+
+    // Build the shared DX7 banks now rather than on the audio thread, the
+    // first time a six-op engine is selected
+    plaits::PreloadRomPatchBanks();
+
+    filterBank_.Init(static_cast<float>(renderSampleRate_));
+    filterTail_.fill(0);
+    vaBank_.Init();
+    for (size_t i = 0; i < kMaxVoices; ++i) {
+        voiceLeftPtrs_[i] = voiceLeft_[i];
+        voiceRightPtrs_[i] = voiceRight_[i];
+    }
+
+    resamplerLeft_.Init(renderSampleRate_, hostSampleRate);
+    resamplerRight_.Init(renderSampleRate_, hostSampleRate);
+    busRead_ = 0;
+    busFill_ = 0;
+    busSilent_ = true;
+
+    engine_ = pendingEngine_;
+    engineFadeGain_ = 1.0f;
+    engineFadeStep_ = static_cast<float>(1000.0 / (kEngineFadeMs * hostSampleRate));
 }
 
 void VoiceAllocator::setPolyphony(int polyphony)
@@ -22,7 +72,39 @@ void VoiceAllocator::setPolyphony(int polyphony)
     polyphony_ = std::clamp(polyphony, 1, static_cast<int>(kMaxVoices));
 }
 
-void VoiceAllocator::NoteOn(int note, float velocity, float attackMs, float decayMs)
+void VoiceAllocator::setVoiceFilter(bool enabled)
+{
+    voiceFilter_ = enabled;
+    filterTail_.fill(0);
+}
+
+void VoiceAllocator::setRenderThreads(int numThreads)
+{
+    renderPool_.Start(numThreads);
+}
+
+void VoiceAllocator::set_filter_cutoff(float cutoffHz)
+{
+    for (int i = 0; i < static_cast<int>(kMaxVoices); ++i) {
+        filterBank_.SetCutoff(i, cutoffHz);
+    }
+}
+
+void VoiceAllocator::set_filter_resonance(float resonance)
+{
+    for (int i = 0; i < static_cast<int>(kMaxVoices); ++i) {
+        filterBank_.SetResonance(i, resonance);
+    }
+}
+
+void VoiceAllocator::glideFilters(size_t hostSamples)
+{
+    // The bank runs at the render rate
+    double samples = static_cast<double>(hostSamples) * renderSampleRate_ / hostSampleRate_;
+    filterBank_.Glide(static_cast<size_t>(std::lround(samples)));
+}
+
+int VoiceAllocator::NoteOn(int note, float velocity, float attackMs, float decayMs)
 {
     // First check if this note is already playing - retrigger it
     Voice* voice = findVoiceForNote(note);
@@ -38,11 +120,24 @@ void VoiceAllocator::NoteOn(int note, float velocity, float attackMs, float deca
     }
 
     if (voice) {
+        bool wasActive = voice->active();
         voice->NoteOn(note, velocity, attackMs, decayMs);
         // Record when this voice was triggered
         size_t idx = voice - &voices_[0];
         voiceAge_[idx] = ++noteCounter_;
+
+        // A new (not retriggered) note starts from a clean filter, and from
+        // its own sample within the audio already on the bus. An active voice
+        // has already rendered the bus, so a retrigger or a stolen voice
+        // starts its new note with the next bus render
+        if (!wasActive) {
+            filterTail_[idx] = 0;
+            filterBank_.Reset(static_cast<int>(idx));
+            startVoiceInBus(idx);
+        }
+        return static_cast<int>(idx);
     }
+    return -1;
 }
 
 void VoiceAllocator::NoteOff(int note)
@@ -60,27 +155,342 @@ void VoiceAllocator::AllNotesOff()
     }
 }
 
+void VoiceAllocator::set_engine(int engine)
+{
+    pendingEngine_ = engine;
+    if (isSilent()) {
+        engine_ = engine;
+        engineFadeGain_ = 1.0f;
+    }
+}
+
 void VoiceAllocator::Process(float* leftOutput, float* rightOutput, size_t size)
 {
-    // Clear output buffers
-    std::memset(leftOutput, 0, size * sizeof(float));
-    std::memset(rightOutput, 0, size * sizeof(float));
+    if (isSilent()) {
+        std::memset(leftOutput, 0, size * sizeof(float));
+        std::memset(rightOutput, 0, size * sizeof(float));
 
-    // Update shared parameters and process each active voice
+        // Nothing to fade
+        engine_ = pendingEngine_;
+        engineFadeGain_ = 1.0f;
+
+        if (isNativeRate()) {
+            // Consume silent internal blocks, so renders stay on the block
+            // boundaries they would have had if the voices kept running
+            const size_t blockSize = Voice::kInternalBlockSize;
+            size_t available = busFill_ - busRead_;
+            if (size <= available) {
+                busRead_ += size;
+            } else {
+                size_t offset = (size - available) % blockSize;
+                std::memset(busLeft_, 0, blockSize * sizeof(float));
+                std::memset(busRight_, 0, blockSize * sizeof(float));
+                busRead_ = offset;
+                busFill_ = offset > 0 ? blockSize : 0;
+                busSilent_ = true;
+            }
+        } else {
+            // Drop the leftover silence so the next note starts without delay
+            busRead_ = 0;
+            busFill_ = 0;
+        }
+        return;
+    }
+
+    // Update shared parameters
     for (size_t i = 0; i < static_cast<size_t>(polyphony_); ++i) {
         voices_[i].set_engine(engine_);
-        voices_[i].set_harmonics(harmonics_);
-        voices_[i].set_timbre(timbre_);
-        voices_[i].set_morph(morph_);
+        voices_[i].set_harmonics(harmonics_[i]);
+        voices_[i].set_timbre(timbre_[i]);
+        voices_[i].set_morph(morph_[i]);
         voices_[i].set_decay(lpgDecay_);
         voices_[i].set_lpg_colour(lpgColour_);
+    }
+
+    // Pull from the bus, refilling it whenever it runs dry
+    size_t written = 0;
+    while (written < size) {
+        if (busRead_ == busFill_) {
+            renderBus(size - written);
+        }
 
+        size_t available = busFill_ - busRead_;
+
+        if (isNativeRate()) {
+            size_t count = std::min(available, size - written);
+            std::memcpy(leftOutput + written, busLeft_ + busRead_, count * sizeof(float));
+            std::memcpy(rightOutput + written, busRight_ + busRead_, count * sizeof(float));
+            busRead_ += count;
+            written += count;
+            continue;
+        }
+
+        size_t produced = resamplerLeft_.Process(busLeft_ + busRead_, available,
+                                                 leftOutput + written, size - written);
+        resamplerRight_.Process(busRight_ + busRead_, available,
+                                rightOutput + written, size - written);
+
+        busRead_ += resamplerLeft_.consumed();
+        written += produced;
+    }
+
+    applyEngineFade(leftOutput, rightOutput, size);
+}
+
+void VoiceAllocator::applyEngineFade(float* left, float* right, size_t size)
+{
+    if (engine_ == pendingEngine_ && engineFadeGain_ == 1.0f) {
+        return;
+    }
+
+    // Out to silence while the old engine still plays, back in afterwards;
+    // once the gain is down, the rest of this block stays silent
+    const bool fadingOut = engine_ != pendingEngine_;
+    float gain = engineFadeGain_;
+    for (size_t i = 0; i < size; ++i) {
+        gain = fadingOut ? std::max(0.0f, gain - engineFadeStep_)
+                         : std::min(1.0f, gain + engineFadeStep_);
+        left[i] *= gain;
+        right[i] *= gain;
+    }
+    engineFadeGain_ = gain;
+
+    // The voices pick up the new engine at the start of the next block
+    if (fadingOut && gain == 0.0f) {
+        engine_ = pendingEngine_;
+    }
+}
+
+void VoiceAllocator::renderBus(size_t hostSamples)
+{
+    // Render whole internal blocks so voice timing does not depend on the
+    // host block size. The resampler needs one sample of lookahead; a native
+    // bus is consumed exactly, so renders stay on internal block boundaries
+    // and pick up control-rate parameter changes at the same samples
+    const size_t blockSize = Voice::kInternalBlockSize;
+    size_t needed = hostSamples;
+    if (!isNativeRate()) {
+        needed = static_cast<size_t>(
+            std::ceil(static_cast<double>(hostSamples) * resamplerLeft_.ratio())) + 1;
+    }
+    needed = std::min((needed + blockSize - 1) / blockSize * blockSize, kBusSize);
+
+    std::memset(busLeft_, 0, needed * sizeof(float));
+    std::memset(busRight_, 0, needed * sizeof(float));
+
+    size_t numActive = 0;
+    for (size_t i = 0; i < static_cast<size_t>(polyphony_); ++i) {
         if (voices_[i].active()) {
-            voices_[i].Process(leftOutput, rightOutput, size);
+            renderVoices_[numActive++] = i;
+        }
+    }
+
+    // Virtual analog voices go to the pool in groups that fill the bank's
+    // lanes; other engines gain nothing from grouping, so go one by one
+    renderGroupSize_ = 1;
+    if (numActive > 0 && voices_[renderVoices_[0]].plaitsEngine() == Voice::kVirtualAnalogEngine) {
+        renderGroupSize_ = plaits::VirtualAnalogBank::kLanes;
+    }
+    const size_t numGroups = (numActive + renderGroupSize_ - 1) / renderGroupSize_;
+    size_t numTails = 0;
+
+    if (voiceFilter_ || (renderPool_.numThreads() > 0 && numGroups > 1)) {
+        // Each voice renders into a zeroed slice (on the pool when enabled),
+        // so adding the slices in voice order gives exactly the same sums as
+        // the serial path
+        renderCount_ = numActive;
+        renderLength_ = needed;
+        renderPool_.Run(&VoiceAllocator::renderGroupJob, this, static_cast<int>(numGroups));
+
+        // Ended voices whose filters still ring run them on silence
+        bool mixed[kMaxVoices] = {};
+        for (size_t j = 0; j < numActive; ++j) {
+            mixed[renderVoices_[j]] = true;
+        }
+        if (voiceFilter_) {
+            for (size_t i = 0; i < static_cast<size_t>(polyphony_); ++i) {
+                if (!mixed[i] && filterTail_[i] > 0) {
+                    std::memset(voiceLeft_[i], 0, needed * sizeof(float));
+                    std::memset(voiceRight_[i], 0, needed * sizeof(float));
+                    mixed[i] = true;
+                    ++numTails;
+                }
+            }
+            filterBank_.Process(voiceLeftPtrs_.data(), voiceRightPtrs_.data(), mixed, needed);
+        }
+
+        for (size_t v = 0; v < static_cast<size_t>(polyphony_); ++v) {
+            if (!mixed[v]) {
+                continue;
+            }
+            const float* left = voiceLeft_[v];
+            const float* right = voiceRight_[v];
+            for (size_t i = 0; i < needed; ++i) {
+                busLeft_[i] += left[i];
+                busRight_[i] += right[i];
+            }
+            if (!voiceFilter_ || voices_[v].active()) {
+                continue;
+            }
+
+            // A voice that has just ended starts its tail; a tail stops once
+            // it falls silent
+            float peak = 0.0f;
+            for (size_t i = 0; i < needed; ++i) {
+                peak = std::max(peak, std::max(std::abs(left[i]), std::abs(right[i])));
+            }
+            if (peak < Voice::kSilenceThreshold) {
+                filterTail_[v] = 0;
+            } else if (filterTail_[v] == 0) {
+                filterTail_[v] = static_cast<size_t>(renderSampleRate_ * kMaxFilterTailSeconds);
+            } else {
+                filterTail_[v] -= std::min(filterTail_[v], needed);
+            }
+        }
+    } else {
+        // Voices within a group mix into the bus in voice order, block by
+        // block, and groups follow in order: the same sums as the slices
+        float* left[] = { busLeft_, busLeft_, busLeft_, busLeft_ };
+        float* right[] = { busRight_, busRight_, busRight_, busRight_ };
+        static_assert(std::size(left) == plaits::VirtualAnalogBank::kLanes);
+        for (size_t j = 0; j < numActive; j += renderGroupSize_) {
+            renderGroup(&renderVoices_[j], std::min(renderGroupSize_, numActive - j), left, right, needed);
+        }
+    }
+
+    busRead_ = 0;
+    busFill_ = needed;
+    busSilent_ = numActive == 0 && numTails == 0;
+}
+
+void VoiceAllocator::renderGroup(const size_t* voices, size_t count,
+                                 float* const* left, float* const* right, size_t length)
+{
+    constexpr int kLanes = plaits::VirtualAnalogBank::kLanes;
+    const size_t blockSize = Voice::kInternalBlockSize;
+
+    // Render threads are shared, so each render installs this allocator's rate
+    plaits::ScopedSampleRate sampleRate(&renderRateSettings_);
+
+    for (size_t offset = 0; offset < length; offset += blockSize) {
+        const size_t blockLength = std::min(blockSize, length - offset);
+
+        bool rendering[kLanes] = {};
+        plaits::EngineParameters parameters[kLanes];
+        int laneVoices[kLanes];
+        plaits::EngineParameters laneParameters[kLanes];
+        float* laneOut[kLanes];
+        float* laneAux[kLanes];
+        int numLanes = 0;
+
+        for (size_t k = 0; k < count; ++k) {
+            Voice& voice = voices_[voices[k]];
+            rendering[k] = voice.active();
+            if (!rendering[k]) {
+                continue;
+            }
+
+            bool engineChanged = voice.BeginBlock(&parameters[k]);
+            if (voice.plaitsEngine() != Voice::kVirtualAnalogEngine) {
+                voice.RenderEngine(parameters[k], blockLength);
+                continue;
+            }
+
+            if (engineChanged) {
+                vaBank_.Reset(static_cast<int>(voices[k]));
+            }
+            laneVoices[numLanes] = static_cast<int>(voices[k]);
+            laneParameters[numLanes] = parameters[k];
+            laneOut[numLanes] = voice.engineOut();
+            laneAux[numLanes] = voice.engineAux();
+            ++numLanes;
+        }
+
+        if (numLanes > 0) {
+            // Time the bank when any of its voices is due a timed render, and
+            // give those voices their share
+            bool timed[kLanes] = {};
+            bool anyTimed = false;
+            for (int k = 0; k < numLanes; ++k) {
+                timed[k] = voices_[laneVoices[k]].timeNextRender();
+                anyTimed = anyTimed || timed[k];
+            }
+
+            if (!anyTimed) {
+                vaBank_.Render(laneVoices, laneParameters, laneOut, laneAux, numLanes, blockLength);
+            } else {
+                auto start = std::chrono::steady_clock::now();
+                vaBank_.Render(laneVoices, laneParameters, laneOut, laneAux, numLanes, blockLength);
+                std::chrono::duration<float, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+                float nsPerSample = elapsed.count() / static_cast<float>(numLanes * blockLength);
+                for (int k = 0; k < numLanes; ++k) {
+                    if (timed[k]) {
+                        voices_[laneVoices[k]].recordRenderTime(nsPerSample);
+                    }
+                }
+            }
+        }
+
+        for (size_t k = 0; k < count; ++k) {
+            if (rendering[k]) {
+                voices_[voices[k]].EndBlock(left[k] + offset, right[k] + offset, blockLength);
+            }
         }
     }
 }
 
+void VoiceAllocator::startVoiceInBus(size_t voice)
+{
+    // The voice renders whole blocks, from the start of the block the note
+    // on falls in, like the voices already on the bus. Its output is delayed
+    // by the note on's offset into that block, so it sounds from the note on
+    const size_t blockSize = Voice::kInternalBlockSize;
+    const size_t length = busFill_ - busRead_;
+    const size_t rendered = (length + blockSize - 1) / blockSize * blockSize;
+    voices_[voice].setOutputDelay(rendered - length);
+    if (length == 0 || voice >= static_cast<size_t>(polyphony_)) {
+        return;
+    }
+
+    float* left[] = { voiceLeft_[voice] };
+    float* right[] = { voiceRight_[voice] };
+    std::memset(left[0], 0, rendered * sizeof(float));
+    std::memset(right[0], 0, rendered * sizeof(float));
+    renderGroup(&voice, 1, left, right, rendered);
+
+    if (voiceFilter_) {
+        filterBank_.ProcessFilter(static_cast<int>(voice), left[0], right[0], rendered);
+    }
+
+    // The first rendered - length samples are the delay line's silence
+    const size_t delay = rendered - length;
+    for (size_t i = 0; i < length; ++i) {
+        busLeft_[busRead_ + i] += left[0][delay + i];
+        busRight_[busRead_ + i] += right[0][delay + i];
+    }
+    busSilent_ = false;
+}
+
+void VoiceAllocator::renderGroupJob(void* context, int index)
+{
+    auto* allocator = static_cast<VoiceAllocator*>(context);
+    const size_t first = static_cast<size_t>(index) * allocator->renderGroupSize_;
+    const size_t count = std::min(allocator->renderGroupSize_, allocator->renderCount_ - first);
+    size_t length = allocator->renderLength_;
+
+    float* left[plaits::VirtualAnalogBank::kLanes];
+    float* right[plaits::VirtualAnalogBank::kLanes];
+    for (size_t k = 0; k < count; ++k) {
+        size_t voice = allocator->renderVoices_[first + k];
+        left[k] = allocator->voiceLeft_[voice];
+        right[k] = allocator->voiceRight_[voice];
+        std::memset(left[k], 0, length * sizeof(float));
+        std::memset(right[k], 0, length * sizeof(float));
+    }
+
+    allocator->renderGroup(&allocator->renderVoices_[first], count, left, right, length);
+}
+
 int VoiceAllocator::activeVoiceCount() const
 {
     int count = 0;
@@ -92,6 +502,16 @@ int VoiceAllocator::activeVoiceCount() const
     return count;
 }
 
+bool VoiceAllocator::isSilent() const
+{
+    for (size_t i = 0; i < static_cast<size_t>(polyphony_); ++i) {
+        if (filterTail_[i] > 0) {
+            return false;
+        }
+    }
+    return activeVoiceCount() == 0 && (busSilent_ || busRead_ == busFill_);
+}
+
 Voice* VoiceAllocator::findFreeVoice()
 {
     for (size_t i = 0; i < static_cast<size_t>(polyphony_); ++i) {
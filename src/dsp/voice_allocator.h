@@ -6,55 +6,173 @@
 #include <array>
 #include <cstdint>
 #include "voice.h"
+#include "resampler.h"
+#include "render_thread_pool.h"
+#include "moog_filter_bank.h"
+#include "virtual_analog_bank.h"
 
 class VoiceAllocator {
 public:
     static constexpr size_t kMaxVoices = 16;
 
-    VoiceAllocator() = default;
+    // Size of the internal-rate mix bus (10ms at 48kHz)
+    static constexpr size_t kBusSize = Voice::kInternalBlockSize * 20;
+
+    // Host rates the engines can render at directly, without resampling
+    static constexpr double kMinNativeSampleRate = 44100.0;
+    static constexpr double kMaxNativeSampleRate = 48000.0;
+
+    // Length of each half of the fade around an engine change
+    static constexpr double kEngineFadeMs = 5.0;
+
+    // Longest a voice filter rings on after its voice ends, for resonance
+    // high enough that it never dies away
+    static constexpr double kMaxFilterTailSeconds = 1.0;
+
+    VoiceAllocator();
     ~VoiceAllocator() = default;
 
     void Init(double hostSampleRate, int polyphony);
 
-    void NoteOn(int note, float velocity, float attackMs, float decayMs);
+    // Returns the index of the voice that plays the note (-1 if none)
+    int NoteOn(int note, float velocity, float attackMs, float decayMs);
     void NoteOff(int note);
     void AllNotesOff();
 
     // Process all voices and output to stereo buffers
+    // Voices are mixed on a shared bus at renderSampleRate(), which is then
+    // resampled once to the host rate (or copied when they match)
     void Process(float* leftOutput, float* rightOutput, size_t size);
 
     // Shared parameters for all voices
-    void set_engine(int engine) { engine_ = engine; }
-    void set_harmonics(float harmonics) { harmonics_ = harmonics; }
-    void set_timbre(float timbre) { timbre_ = timbre; }
-    void set_morph(float morph) { morph_ = morph; }
+    // While voices sound, an engine change fades the output out, switches,
+    // and fades back in; otherwise it takes effect at once
+    void set_engine(int engine);
+    int engine() const { return engine_; }
+    void set_harmonics(float harmonics) { harmonics_.fill(harmonics); }
+    void set_timbre(float timbre) { timbre_.fill(timbre); }
+    void set_morph(float morph) { morph_.fill(morph); }
     void set_decay(float decay) { lpgDecay_ = decay; }
     void set_lpg_colour(float colour) { lpgColour_ = colour; }
 
+    // Per-voice values, for polyphonic modulation
+    void set_harmonics(int voice, float harmonics) { harmonics_[voice] = harmonics; }
+    void set_timbre(int voice, float timbre) { timbre_[voice] = timbre; }
+    void set_morph(int voice, float morph) { morph_[voice] = morph; }
+
+    // Per-voice filter: when enabled, each voice runs through its own ladder
+    // (batched four voices per vector) before the mix, instead of the
+    // processor's filter on the summed output. A voice's filter keeps ringing
+    // after the voice ends, until it dies away or the voice plays again
+    void setVoiceFilter(bool enabled);
+    bool voiceFilter() const { return voiceFilter_; }
+    void set_filter_cutoff(float cutoffHz);
+    void set_filter_resonance(float resonance);
+
+    // Per-voice filter settings that glide rather than jump: set each voice's
+    // target, then glideFilters() reaches them over the next hostSamples of
+    // output
+    void set_filter_target(int voice, float cutoffHz, float resonance) { filterBank_.SetTarget(voice, cutoffHz, resonance); }
+    void glideFilters(size_t hostSamples);
+
     // Polyphony control
     void setPolyphony(int polyphony);
     int polyphony() const { return polyphony_; }
 
+    // Parallel rendering: voices are spread over numThreads workers plus the
+    // calling thread (0 renders serially). Output is identical either way.
+    // Starts or stops threads, so call this off the audio thread.
+    void setRenderThreads(int numThreads);
+    int renderThreads() const { return renderPool_.numThreads(); }
+
     // State queries
     int activeVoiceCount() const;
 
+    // True when no voice is playing and no rendered audio is left on the bus;
+    // Process() then just writes silence
+    bool isSilent() const;
+    double renderSampleRate() const { return renderSampleRate_; }
+    bool isNativeRate() const { return renderSampleRate_ == hostSampleRate_; }
+
 private:
     Voice* findFreeVoice();
     Voice* findVoiceForNote(int note);
     Voice* stealVoice();
 
+    // Render enough internal samples into the (empty) bus to produce
+    // hostSamples of output
+    void renderBus(size_t hostSamples);
+
+    // Apply the engine change fade to a block of output, switching engines
+    // once the fade out reaches silence
+    void applyEngineFade(float* left, float* right, size_t size);
+
+    // Render count voices block by block, voice i mixing into left[i] and
+    // right[i]. Voices on the virtual analog engine render four at a time
+    // through vaBank_; the rest render on their own
+    void renderGroup(const size_t* voices, size_t count,
+                     float* const* left, float* const* right, size_t length);
+
+    // Render one group of renderVoices_ into the voices' slices (pool job)
+    static void renderGroupJob(void* context, int index);
+
+    // Render a voice that has just started into the samples left on the bus,
+    // so it sounds from the note on rather than from the next bus render
+    void startVoiceInBus(size_t voice);
+
     std::array<Voice, kMaxVoices> voices_;
     std::array<uint32_t, kMaxVoices> voiceAge_;
     uint32_t noteCounter_ = 0;
 
     int polyphony_ = 8;
     double hostSampleRate_ = 48000.0;
+    double renderSampleRate_ = Voice::kInternalSampleRate;
+
+    // Plaits rendering settings for renderSampleRate_, installed around every
+    // engine initialisation and render, so each allocator renders at its own
+    // rate whatever others in the process use
+    plaits::SampleRateSettings renderRateSettings_ = plaits::kDefaultSampleRateSettings;
+
+    // Shared voice bus at the internal sample rate
+    float busLeft_[kBusSize];
+    float busRight_[kBusSize];
+    size_t busRead_ = 0;
+    size_t busFill_ = 0;
+    bool busSilent_ = true;
+    Resampler resamplerLeft_;
+    Resampler resamplerRight_;
 
-    // Shared parameters
+    // Per-voice slices for parallel rendering, summed into the bus in voice
+    // order so the mix does not depend on which thread rendered what
+    float voiceLeft_[kMaxVoices][kBusSize];
+    float voiceRight_[kMaxVoices][kBusSize];
+    std::array<size_t, kMaxVoices> renderVoices_;
+    size_t renderCount_ = 0;
+    size_t renderLength_ = 0;
+    size_t renderGroupSize_ = 1;
+
+    // Lane-parallel virtual analog engines for all voices
+    plaits::VirtualAnalogBank vaBank_;
+
+    // Per-voice filters, run on the voice slices
+    plaits::MoogFilterBank filterBank_;
+    bool voiceFilter_ = false;
+
+    // Samples left of each ended voice's filter tail (0 when it has none)
+    std::array<size_t, kMaxVoices> filterTail_{};
+    std::array<float*, kMaxVoices> voiceLeftPtrs_;
+    std::array<float*, kMaxVoices> voiceRightPtrs_;
+
+    // Shared parameters (per voice where they can be modulated per voice)
     int engine_ = 0;
-    float harmonics_ = 0.5f;
-    float timbre_ = 0.5f;
-    float morph_ = 0.5f;
+    int pendingEngine_ = 0;
+    float engineFadeGain_ = 1.0f;
+    float engineFadeStep_ = 1.0f;
+    std::array<float, kMaxVoices> harmonics_;
+    std::array<float, kMaxVoices> timbre_;
+    std::array<float, kMaxVoices> morph_;
     float lpgDecay_ = 0.5f;
     float lpgColour_ = 0.5f;
+
+    RenderThreadPool renderPool_;
 };
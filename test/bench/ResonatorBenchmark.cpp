@@ -0,0 +1,79 @@
+// Modal resonator benchmark: ResonatorSvf batches against the mode kernels
+// Part of PlaitsVST - MIT License
+
+#include "plaits/dsp/physical_modelling/resonator_kernel.h"
+#include "plaits/dsp/physical_modelling/resonator.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace plaits;
+
+namespace {
+    constexpr int kModes = kMaxNumModes;
+    constexpr int kBatches = kModes / kModeBatchSize;
+    constexpr size_t kRenderSize = 24;
+    constexpr int kBlocks = 200000;
+
+    float f[kModes], q[kModes], gain[kModes];
+    float g[kModes], r_plus_g[kModes], h[kModes];
+    float in[kRenderSize], out[kRenderSize];
+
+    template <typename Fn>
+    double nanosecondsPerSample(Fn&& process)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int block = 0; block < kBlocks; ++block) {
+            process();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds * 1e9 / (static_cast<double>(kBlocks) * kRenderSize);
+    }
+}
+
+int main()
+{
+    for (int i = 0; i < kModes; ++i) {
+        f[i] = 0.004f * static_cast<float>(i + 1);
+        q[i] = 1.0f + f[i] * 1500.0f;
+        gain[i] = 0.25f * std::cos(0.3f * static_cast<float>(i));
+        g[i] = stmlib::OnePole::tan<stmlib::FREQUENCY_FAST>(f[i]);
+        float r = 1.0f / q[i];
+        h[i] = 1.0f / (1.0f + r * g[i] + g[i] * g[i]);
+        r_plus_g[i] = r + g[i];
+    }
+    for (size_t i = 0; i < kRenderSize; ++i) {
+        in[i] = 0.1f * std::sin(static_cast<float>(i) * 12.9898f);
+    }
+
+    static ResonatorSvf<kModeBatchSize> batches[kBatches];
+    for (auto& batch : batches) {
+        batch.Init();
+    }
+    double scalar = nanosecondsPerSample([&] {
+        for (int b = 0; b < kBatches; ++b) {
+            batches[b].Process<stmlib::FILTER_MODE_BAND_PASS, true>(
+                f + 4 * b, q + 4 * b, gain + 4 * b, in, out, kRenderSize);
+        }
+    });
+
+    std::printf("Modal resonator, %d modes, %zu-sample blocks\n", kModes, kRenderSize);
+    std::printf("  ResonatorSvf<4> batches: %7.2f ns/sample\n", scalar);
+
+    const ModeCoefficients coefficients = { g, r_plus_g, h, gain };
+    const ModeKernel kernels[] = { MODE_KERNEL_FLOAT4, MODE_KERNEL_AVX };
+    const char* names[] = { "Float4 kernel:          ", "AVX kernel:             " };
+    for (int k = 0; k < 2; ++k) {
+        if (!ModeKernelSupported(kernels[k])) {
+            std::printf("  %s (not supported)\n", names[k]);
+            continue;
+        }
+        float state1[kModes] = {}, state2[kModes] = {};
+        double vector = nanosecondsPerSample([&] {
+            ProcessModes(kernels[k], coefficients, state1, state2, kModes, in, out, kRenderSize);
+        });
+        std::printf("  %s %7.2f ns/sample (%.2fx)\n", names[k], vector, scalar / vector);
+    }
+    std::printf("  (checksum %.4f)\n", out[kRenderSize - 1]);
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Plugin state benchmark: save and restore time per instance, through the
+// processor's getStateInformation/setStateInformation, for the binary state
+// and for the ValueTree format it replaced
+// Part of PlaitsVST - MIT License
+
+#include "PluginProcessor.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+    // Processors are heavy, so a session's worth of them, each saved and
+    // restored many times
+    constexpr size_t kInstances = 32;
+    constexpr int kRounds = 2000;
+
+    PluginState makeState(size_t index)
+    {
+        const int instance = static_cast<int>(index);
+        PluginState state;
+        state.engine = instance % 24;
+        state.harmonics = 0.001f * static_cast<float>(instance % 1000);
+        state.timbre = 1.0f - state.harmonics;
+        state.polyphony = 1 + instance % 16;
+        state.lfo[0].amount = instance % 64;
+        state.env[1].decay = 0.25f;
+        state.modulationSeed = 0x9e3779b9u * static_cast<uint32_t>(instance);
+        return state;
+    }
+
+    // The ValueTree getStateInformation() wrote before the binary state, as
+    // older sessions hold it
+    juce::MemoryBlock writeLegacyState(const PluginState& state)
+    {
+        juce::ValueTree tree("PlaitsVSTState");
+        tree.setProperty("engine", state.engine, nullptr);
+        tree.setProperty("harmonics", state.harmonics, nullptr);
+        tree.setProperty("timbre", state.timbre, nullptr);
+        tree.setProperty("morph", state.morph, nullptr);
+        tree.setProperty("attack", state.attack, nullptr);
+        tree.setProperty("decay", state.decay, nullptr);
+        tree.setProperty("polyphony", state.polyphony, nullptr);
+        tree.setProperty("cutoff", state.cutoff, nullptr);
+        tree.setProperty("resonance", state.resonance, nullptr);
+        tree.setProperty("filtermode", state.filterMode, nullptr);
+
+        const char* const lfoKeys[2] = { "lfo1", "lfo2" };
+        for (int i = 0; i < 2; ++i) {
+            const juce::String key(lfoKeys[i]);
+            tree.setProperty(key + "rate", state.lfo[i].rate, nullptr);
+            tree.setProperty(key + "shape", state.lfo[i].shape, nullptr);
+            tree.setProperty(key + "dest", state.lfo[i].dest, nullptr);
+            tree.setProperty(key + "amount", state.lfo[i].amount, nullptr);
+        }
+
+        const char* const envKeys[2] = { "env1", "env2" };
+        for (int i = 0; i < 2; ++i) {
+            const juce::String key(envKeys[i]);
+            tree.setProperty(key + "attack", state.env[i].attack, nullptr);
+            tree.setProperty(key + "decay", state.env[i].decay, nullptr);
+            tree.setProperty(key + "dest", state.env[i].dest, nullptr);
+            tree.setProperty(key + "amount", state.env[i].amount, nullptr);
+        }
+
+        tree.setProperty("multithreaded", state.multiThreaded, nullptr);
+        tree.setProperty("modseed", static_cast<int>(state.modulationSeed), nullptr);
+
+        juce::MemoryBlock block;
+        {
+            juce::MemoryOutputStream stream(block, false);
+            tree.writeToStream(stream);
+        }
+        return block;
+    }
+
+    template <typename Fn>
+    double nanosecondsPerInstance(Fn&& fn)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < kRounds; ++round) {
+            fn();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds * 1e9 / (static_cast<double>(kRounds) * kInstances);
+    }
+}
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    std::vector<PluginState> states;
+    std::vector<std::unique_ptr<PlaitsVSTProcessor>> processors;
+    std::vector<juce::MemoryBlock> binary(kInstances);
+    std::vector<juce::MemoryBlock> legacy(kInstances);
+    for (size_t i = 0; i < kInstances; ++i) {
+        states.push_back(makeState(i));
+        legacy[i] = writeLegacyState(states[i]);
+
+        // Every instance starts from its own state
+        processors.push_back(std::make_unique<PlaitsVSTProcessor>());
+        processors[i]->setStateInformation(legacy[i].getData(), static_cast<int>(legacy[i].getSize()));
+    }
+
+    double binarySave = nanosecondsPerInstance([&] {
+        for (size_t i = 0; i < kInstances; ++i) {
+            processors[i]->getStateInformation(binary[i]);
+        }
+    });
+    double binaryRestore = nanosecondsPerInstance([&] {
+        for (size_t i = 0; i < kInstances; ++i) {
+            processors[i]->setStateInformation(binary[i].getData(), static_cast<int>(binary[i].getSize()));
+        }
+    });
+
+    // The old writer built the same tree from the parameters; restoring goes
+    // through the processor's fallback to the ValueTree reader
+    double legacySave = nanosecondsPerInstance([&] {
+        for (size_t i = 0; i < kInstances; ++i) {
+            legacy[i] = writeLegacyState(states[i]);
+        }
+    });
+    double legacyRestore = nanosecondsPerInstance([&] {
+        for (size_t i = 0; i < kInstances; ++i) {
+            processors[i]->setStateInformation(legacy[i].getData(), static_cast<int>(legacy[i].getSize()));
+        }
+    });
+
+    int mismatches = 0;
+    for (size_t i = 0; i < kInstances; ++i) {
+        mismatches += processors[i]->getEngineParam()->getIndex() != states[i].engine ||
+                      processors[i]->getPolyphonyParam()->get() != states[i].polyphony ? 1 : 0;
+    }
+
+    std::printf("Plugin state round trip through the processor, %zu instances\n", kInstances);
+    std::printf("  binary (%zu bytes):     save %8.1f ns/instance, restore %8.1f ns/instance\n",
+                binary[0].getSize(), binarySave, binaryRestore);
+    std::printf("  ValueTree (%zu bytes): save %8.1f ns/instance, restore %8.1f ns/instance\n",
+                legacy[0].getSize(), legacySave, legacyRestore);
+    std::printf("  (mismatches %d)\n", mismatches);
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Voice batch benchmark: VirtualAnalogBank against one VirtualAnalogEngine per voice
+// Part of PlaitsVST - MIT License
+
+#include "dsp/virtual_analog_bank.h"
+#include "plaits/dsp/engine/virtual_analog_engine.h"
+#include "stmlib/utils/buffer_allocator.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+using namespace plaits;
+
+namespace {
+    constexpr size_t kRenderSize = kMaxBlockSize;
+    constexpr int kBlocks = 20000;
+
+    struct ScalarEngine {
+        uint8_t memory[1024];
+        stmlib::BufferAllocator allocator;
+        VirtualAnalogEngine engine;
+    };
+
+    EngineParameters parametersFor(int voice, int block)
+    {
+        EngineParameters p = {};
+        p.trigger = TRIGGER_UNPATCHED;
+        p.note = 40.0f + 3.0f * static_cast<float>(voice);
+        p.harmonics = 0.3f + 0.02f * static_cast<float>(voice);
+        p.timbre = 0.5f + 0.2f * static_cast<float>((block / 50) % 2);
+        p.morph = 0.4f;
+        p.accent = 0.8f;
+        return p;
+    }
+
+    template <typename Fn>
+    double nanosecondsPerVoiceSample(int voices, Fn&& render)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int block = 0; block < kBlocks; ++block) {
+            render(block);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds * 1e9 / (static_cast<double>(kBlocks) * kRenderSize * voices);
+    }
+
+    void run(int voices)
+    {
+        auto scalar = std::make_unique<ScalarEngine[]>(VirtualAnalogBank::kMaxVoices);
+        for (int v = 0; v < voices; ++v) {
+            scalar[v].allocator.Init(scalar[v].memory, sizeof(scalar[v].memory));
+            scalar[v].engine.Init(&scalar[v].allocator);
+        }
+        auto bank = std::make_unique<VirtualAnalogBank>();
+        bank->Init();
+
+        static float out[VirtualAnalogBank::kMaxVoices][kRenderSize];
+        static float aux[VirtualAnalogBank::kMaxVoices][kRenderSize];
+        float checksumScalar = 0.0f;
+        float checksumBank = 0.0f;
+
+        double perVoice = nanosecondsPerVoiceSample(voices, [&](int block) {
+            for (int v = 0; v < voices; ++v) {
+                bool enveloped = false;
+                scalar[v].engine.Render(parametersFor(v, block), out[v], aux[v], kRenderSize, &enveloped);
+                checksumScalar += out[v][kRenderSize - 1];
+            }
+        });
+
+        double batched = nanosecondsPerVoiceSample(voices, [&](int block) {
+            for (int first = 0; first < voices; first += VirtualAnalogBank::kLanes) {
+                int ids[VirtualAnalogBank::kLanes];
+                EngineParameters parameters[VirtualAnalogBank::kLanes];
+                float* outPtrs[VirtualAnalogBank::kLanes];
+                float* auxPtrs[VirtualAnalogBank::kLanes];
+                for (int k = 0; k < VirtualAnalogBank::kLanes; ++k) {
+                    ids[k] = first + k;
+                    parameters[k] = parametersFor(first + k, block);
+                    outPtrs[k] = out[first + k];
+                    auxPtrs[k] = aux[first + k];
+                }
+                bank->Render(ids, parameters, outPtrs, auxPtrs, VirtualAnalogBank::kLanes, kRenderSize);
+            }
+            for (int v = 0; v < voices; ++v) {
+                checksumBank += out[v][kRenderSize - 1];
+            }
+        });
+
+        std::printf("  %2d voices: engine per voice %6.2f ns/voice-sample, bank %6.2f (%.2fx)  (checksums %.4f %.4f)\n",
+                    voices, perVoice, batched, perVoice / batched, checksumScalar, checksumBank);
+    }
+}
+
+int main()
+{
+    std::printf("Virtual analog engine, %zu-sample blocks\n", kRenderSize);
+    run(4);
+    run(8);
+    run(16);
+    return 0;
+}
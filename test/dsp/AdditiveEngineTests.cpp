@@ -0,0 +1,196 @@
+// Additive Engine Tests
+// Part of PlaitsVST - MIT License
+
+#include <gtest/gtest.h>
+#include "plaits/dsp/engine/additive_engine.h"
+#include "stmlib/utils/buffer_allocator.h"
+#include <cmath>
+
+namespace {
+    // HarmonicOscillator::Render() as it was before it was vectorised
+    template <int numHarmonics>
+    struct ReferenceHarmonicOscillator {
+        float phase = 0.0f;
+        float frequency = 0.0f;
+        float amplitude[numHarmonics] = {};
+
+        template <int firstHarmonicIndex>
+        void Render(float f0, const float* amplitudes, float* out, size_t size)
+        {
+            if (f0 >= 0.5f) {
+                f0 = 0.5f;
+            }
+
+            stmlib::ParameterInterpolator am[numHarmonics];
+            stmlib::ParameterInterpolator fm(&frequency, f0, size);
+            for (int i = 0; i < numHarmonics; ++i) {
+                float f = f0 * static_cast<float>(firstHarmonicIndex + i);
+                if (f >= 0.5f) {
+                    f = 0.5f;
+                }
+                am[i].Init(&amplitude[i], amplitudes[i] * (1.0f - f * 2.0f), size);
+            }
+
+            while (size--) {
+                phase += fm.Next();
+                if (phase >= 1.0f) {
+                    phase -= 1.0f;
+                }
+                const float twoX = 2.0f * plaits::SineNoWrap(phase);
+                float previous, current;
+                if (firstHarmonicIndex == 1) {
+                    previous = 1.0f;
+                    current = twoX * 0.5f;
+                } else {
+                    const float k = firstHarmonicIndex;
+                    previous = plaits::Sine(phase * (k - 1.0f) + 0.25f);
+                    current = plaits::Sine(phase * k);
+                }
+
+                float sum = 0.0f;
+                for (int i = 0; i < numHarmonics; ++i) {
+                    sum += am[i].Next() * current;
+                    float temp = current;
+                    current = twoX * current - previous;
+                    previous = temp;
+                }
+                if (firstHarmonicIndex == 1) {
+                    *out++ = sum;
+                } else {
+                    *out++ += sum;
+                }
+            }
+        }
+    };
+
+    // AdditiveEngine::Render() as it was, recomputing the spectrum each block
+    struct ReferenceAdditiveEngine {
+        float amplitudes[plaits::kNumHarmonics] = {};
+        ReferenceHarmonicOscillator<plaits::kHarmonicBatchSize> oscillators[plaits::kNumHarmonicOscillators];
+
+        static void UpdateAmplitudes(float centroid, float slope, float bumps, float* amplitudes,
+                                     const int* harmonicIndices, size_t numHarmonics)
+        {
+            const float n = (static_cast<float>(numHarmonics) - 1.0f);
+            const float margin = (1.0f / slope - 1.0f) / (1.0f + bumps);
+            const float center = centroid * (n + margin) - 0.5f * margin;
+
+            float sum = 0.001f;
+            for (size_t i = 0; i < numHarmonics; ++i) {
+                float order = fabsf(static_cast<float>(i) - center) * slope;
+                float gain = 1.0f - order;
+                gain += fabsf(gain);
+                gain *= gain;
+
+                float b = 0.25f + order * bumps;
+                float bumpFactor = 1.0f + plaits::Sine(b);
+
+                gain *= bumpFactor;
+                gain *= gain;
+                gain *= gain;
+
+                int j = harmonicIndices[i];
+                ONE_POLE(amplitudes[j], gain, 0.001f);
+                sum += amplitudes[j];
+            }
+
+            sum = 1.0f / sum;
+            for (size_t i = 0; i < numHarmonics; ++i) {
+                amplitudes[harmonicIndices[i]] *= sum;
+            }
+        }
+
+        void Render(const plaits::EngineParameters& parameters, float* out, float* aux, size_t size)
+        {
+            static const int integerHarmonics[24] = {
+                0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                16, 17, 18, 19, 20, 21, 22, 23
+            };
+            static const int organHarmonics[8] = { 0, 1, 2, 3, 5, 7, 9, 11 };
+
+            const float f0 = plaits::NoteToFrequency(parameters.note);
+            const float centroid = parameters.timbre;
+            const float rawBumps = parameters.harmonics;
+            const float rawSlope = (1.0f - 0.6f * rawBumps) * parameters.morph;
+            const float slope = 0.01f + 1.99f * rawSlope * rawSlope * rawSlope;
+            const float bumps = 16.0f * rawBumps * rawBumps;
+
+            UpdateAmplitudes(centroid, slope, bumps, &amplitudes[0], integerHarmonics, 24);
+            oscillators[0].Render<1>(f0, &amplitudes[0], out, size);
+            oscillators[1].Render<13>(f0, &amplitudes[12], out, size);
+            UpdateAmplitudes(centroid, slope, bumps, &amplitudes[24], organHarmonics, 8);
+            oscillators[2].Render<1>(f0, &amplitudes[24], aux, size);
+        }
+    };
+
+    plaits::EngineParameters parametersFor(int block)
+    {
+        plaits::EngineParameters p = {};
+        p.trigger = plaits::TRIGGER_UNPATCHED;
+        p.note = 48.0f + static_cast<float>((block / 40) % 24);
+        // Timbre holds still for stretches, then moves every block
+        p.timbre = block % 200 < 100 ? 0.3f : std::fmod(0.01f * static_cast<float>(block), 1.0f);
+        p.morph = 0.6f;
+        p.harmonics = block < 300 ? 0.2f : 0.7f;
+        p.accent = 0.8f;
+        return p;
+    }
+}
+
+TEST(HarmonicOscillatorTest, MatchesScalarRecurrence) {
+    plaits::HarmonicOscillator<12> low, high;
+    low.Init();
+    high.Init();
+    ReferenceHarmonicOscillator<12> referenceLow, referenceHigh;
+
+    float amplitudes[24];
+    for (int i = 0; i < 24; ++i) {
+        amplitudes[i] = 1.0f / static_cast<float>(i + 1);
+    }
+
+    // Whole blocks and a partial one, which leaves lanes unused
+    const size_t sizes[] = { 24, 24, 7, 24, 13, 24 };
+    for (int block = 0; block < 120; ++block) {
+        size_t size = sizes[block % 6];
+        float frequency = 0.002f + 0.0005f * static_cast<float>(block % 17);
+        amplitudes[block % 24] = 0.05f * static_cast<float>(block % 5);
+
+        float out[24], expected[24];
+        low.Render<1>(frequency, &amplitudes[0], out, size);
+        high.Render<13>(frequency, &amplitudes[12], out, size);
+        referenceLow.Render<1>(frequency, &amplitudes[0], expected, size);
+        referenceHigh.Render<13>(frequency, &amplitudes[12], expected, size);
+
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_EQ(out[i], expected[i]) << "Block " << block << " sample " << i;
+        }
+    }
+}
+
+TEST(AdditiveEngineTest, MatchesUnmemoisedRender) {
+    uint8_t memory[1024];
+    stmlib::BufferAllocator allocator(memory, sizeof(memory));
+    plaits::AdditiveEngine engine;
+    engine.Init(&allocator);
+    engine.Reset();
+
+    ReferenceAdditiveEngine reference;
+
+    float energy = 0.0f;
+    for (int block = 0; block < 600; ++block) {
+        plaits::EngineParameters parameters = parametersFor(block);
+        float out[plaits::kMaxBlockSize], aux[plaits::kMaxBlockSize];
+        float expectedOut[plaits::kMaxBlockSize], expectedAux[plaits::kMaxBlockSize];
+        bool enveloped = false;
+
+        engine.Render(parameters, out, aux, plaits::kMaxBlockSize, &enveloped);
+        reference.Render(parameters, expectedOut, expectedAux, plaits::kMaxBlockSize);
+
+        for (size_t i = 0; i < plaits::kMaxBlockSize; ++i) {
+            ASSERT_EQ(out[i], expectedOut[i]) << "Block " << block << " sample " << i;
+            ASSERT_EQ(aux[i], expectedAux[i]) << "Block " << block << " sample " << i;
+            energy += out[i] * out[i];
+        }
+    }
+    EXPECT_GT(energy, 1.0f);
+}
@@ -0,0 +1,106 @@
+// FM Patch Bank Tests
+// Part of PlaitsVST - MIT License
+
+#include <gtest/gtest.h>
+#include "plaits/dsp/fm/fm_patch_bank.h"
+#include "plaits/dsp/engine2/six_op_engine.h"
+#include "plaits/resources.h"
+#include "stmlib/utils/buffer_allocator.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+    constexpr size_t kBlockSize = 24;
+
+    plaits::fm::Voice<6>::Parameters parametersFor(int block)
+    {
+        plaits::fm::Voice<6>::Parameters p = {};
+        p.gate = block % 100 < 60;
+        p.note = 48.0f + static_cast<float>((block / 100) % 12);
+        p.velocity = 0.8f;
+        p.brightness = 0.5f;
+        p.envelope_control = 0.5f;
+        return p;
+    }
+}
+
+TEST(FMPatchBankTest, RomBanksAreSharedAndUnpacked) {
+    for (int b = 0; b < 3; ++b) {
+        EXPECT_EQ(plaits::FindRomPatchBank(plaits::fm_patches_table[b]), b);
+
+        const plaits::FMPatchBank& bank = plaits::RomPatchBank(b);
+        EXPECT_EQ(&bank, &plaits::RomPatchBank(b));
+
+        for (int i = 0; i < plaits::FMPatchBank::kNumPatches; ++i) {
+            plaits::fm::Patch patch;
+            patch.Unpack(plaits::fm_patches_table[b] + i * plaits::fm::Patch::SYX_SIZE);
+            EXPECT_EQ(std::memcmp(&patch, &bank.patch[i], sizeof(patch)), 0) << "Bank " << b << " patch " << i;
+        }
+    }
+
+    std::vector<uint8_t> copy(plaits::fm_patches_table[0], plaits::fm_patches_table[0] + SYX_BANK_0_SIZE);
+    EXPECT_EQ(plaits::FindRomPatchBank(copy.data()), -1);
+}
+
+TEST(FMPatchBankTest, PrecomputedSetupMatchesVoiceSetup) {
+    plaits::fm::Algorithms<6> algorithms;
+    algorithms.Init();
+    const plaits::FMPatchBank& bank = plaits::RomPatchBank(1);
+
+    // A sample rate other than the DX7's, so the envelope scale matters
+    for (int i = 0; i < plaits::FMPatchBank::kNumPatches; i += 5) {
+        plaits::fm::Voice<6> computed, precomputed;
+        computed.Init(&algorithms, 48000.0f);
+        precomputed.Init(&algorithms, 48000.0f);
+        computed.SetPatch(&bank.patch[i]);
+        precomputed.SetPatch(&bank.patch[i], &bank.setup[i]);
+
+        // Computing the setup takes up the first render; the precomputed
+        // setup plays straight away
+        float temp[kBlockSize * 3] = {};
+        computed.Render(parametersFor(0), temp, kBlockSize);
+        for (size_t n = 0; n < kBlockSize; ++n) {
+            ASSERT_EQ(temp[n], 0.0f);
+        }
+
+        for (int block = 0; block < 300; ++block) {
+            float out[kBlockSize * 3] = {};
+            float expected[kBlockSize * 3] = {};
+            precomputed.Render(parametersFor(block), out, kBlockSize);
+            computed.Render(parametersFor(block), expected, kBlockSize);
+            for (size_t n = 0; n < kBlockSize; ++n) {
+                ASSERT_EQ(out[n], expected[n]) << "Patch " << i << " block " << block << " sample " << n;
+            }
+        }
+    }
+}
+
+TEST(FMPatchBankTest, EngineUnpacksDataOutsideTheRomBanks) {
+    std::vector<uint8_t> copy(plaits::fm_patches_table[2], plaits::fm_patches_table[2] + SYX_BANK_2_SIZE);
+
+    static uint8_t memory[16384];
+    stmlib::BufferAllocator allocator(memory, sizeof(memory));
+    plaits::SixOpEngine engine;
+    engine.Init(&allocator);
+    engine.LoadUserData(copy.data());
+    engine.Reset();
+
+    plaits::EngineParameters p = {};
+    p.trigger = plaits::TRIGGER_UNPATCHED;
+    p.note = 48.0f;
+    p.harmonics = 0.3f;
+    p.timbre = 0.5f;
+    p.morph = 0.5f;
+    p.accent = 0.8f;
+
+    float energy = 0.0f;
+    for (int block = 0; block < 200; ++block) {
+        float out[kBlockSize], aux[kBlockSize];
+        bool enveloped = false;
+        engine.Render(p, out, aux, kBlockSize, &enveloped);
+        for (size_t n = 0; n < kBlockSize; ++n) {
+            energy += out[n] * out[n];
+        }
+    }
+    EXPECT_GT(energy, 0.0f);
+}
@@ -4,6 +4,7 @@
 #include <gtest/gtest.h>
 #include "dsp/lfo.h"
 #include <cmath>
+#include <vector>
 
 using namespace plaits;
 
@@ -121,6 +122,35 @@ TEST_F(LfoTest, SampleAndHoldWorks) {
     EXPECT_LT(changes, 1000);  // Not changing every sample
 }
 
+TEST_F(LfoTest, SampleAndHoldRepeatsForASeed) {
+    auto render = [](Lfo& lfo, std::vector<float>& out) {
+        out.clear();
+        for (int i = 0; i < 200; ++i) {
+            out.push_back(lfo.Process(kSampleRate, 600));
+        }
+    };
+
+    lfo_.SetShape(LfoShape::SampleAndHold);
+    lfo_.SetRate(LfoRateDivision::Div_1_16);
+    lfo_.SetSeed(1234);
+
+    std::vector<float> first, second, reseeded;
+    render(lfo_, first);
+    lfo_.Reset();
+    render(lfo_, second);
+    EXPECT_EQ(first, second);
+
+    // Values stay in range and differ between seeds
+    for (float v : first) {
+        EXPECT_GE(v, -1.0f);
+        EXPECT_LE(v, 1.0f);
+    }
+    lfo_.SetSeed(4321);
+    lfo_.Reset();
+    render(lfo_, reseeded);
+    EXPECT_NE(first, reseeded);
+}
+
 TEST_F(LfoTest, TempoAffectsRate) {
     lfo_.SetRate(LfoRateDivision::Div_1_16);  // Faster division for more cycles
     lfo_.SetShape(LfoShape::Saw);
@@ -159,6 +189,39 @@ TEST_F(LfoTest, TempoAffectsRate) {
     EXPECT_GT(cycles_60, 0);
 }
 
+TEST_F(LfoTest, SongPositionSetsPhase) {
+    lfo_.SetShape(LfoShape::Saw);
+    lfo_.SetRate(LfoRateDivision::Div_1_1);  // One cycle per 4 beats
+
+    // 9 beats in: a quarter of the way through the third cycle
+    lfo_.SetSongPosition(9.0);
+    EXPECT_NEAR(lfo_.Process(kSampleRate, 0), 1.0f - 0.25f * 2.0f, 1e-6f);
+
+    // The step's length is added at the host tempo: 24000 samples is a beat
+    lfo_.SetSongPosition(9.0);
+    EXPECT_NEAR(lfo_.Process(kSampleRate, 24000), 1.0f - 0.5f * 2.0f, 1e-6f);
+}
+
+TEST_F(LfoTest, SongPositionIsRepeatable) {
+    lfo_.SetShape(LfoShape::Triangle);
+    lfo_.SetTempo(133.0);
+
+    Lfo other;
+    other.Init();
+    other.SetShape(LfoShape::Triangle);
+    other.SetTempo(133.0);
+
+    // However long one has been running, the same position gives the same
+    // output: a looping host hears the same modulation every pass
+    for (int i = 0; i < 100000; ++i) {
+        lfo_.Process(kSampleRate, 24);
+    }
+    double position = 1234.5678;
+    lfo_.SetSongPosition(position);
+    other.SetSongPosition(position);
+    EXPECT_EQ(lfo_.Process(kSampleRate, 24), other.Process(kSampleRate, 24));
+}
+
 TEST_F(LfoTest, RateNamesExist) {
     for (int i = 0; i < static_cast<int>(LfoRateDivision::NumDivisions); ++i) {
         const char* name = Lfo::GetRateName(static_cast<LfoRateDivision>(i));
@@ -0,0 +1,66 @@
+// ModEnvelopeBank Tests
+// Part of PlaitsVST - MIT License
+
+#include <gtest/gtest.h>
+#include "dsp/mod_envelope_bank.h"
+#include "dsp/mod_envelope.h"
+#include <cmath>
+
+using namespace plaits;
+
+class ModEnvelopeBankTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        bank_.Init();
+    }
+
+    ModEnvelopeBank bank_;
+    static constexpr float kSampleRate = 48000.0f;
+};
+
+TEST_F(ModEnvelopeBankTest, StartsIdle) {
+    for (int v = 0; v < ModEnvelopeBank::kMaxVoices; ++v) {
+        EXPECT_FALSE(bank_.IsActive(v));
+        EXPECT_FLOAT_EQ(bank_.GetOutput(v), 0.0f);
+    }
+}
+
+TEST_F(ModEnvelopeBankTest, MatchesModEnvelope) {
+    ModEnvelope env;
+    env.Init();
+    env.SetAttack(20);
+    env.SetDecay(150);
+    bank_.SetAttack(20.0f);
+    bank_.SetDecay(150.0f);
+
+    env.Trigger();
+    bank_.Trigger(5);
+
+    // Through the attack, the decay and into idle
+    for (int block = 0; block < 400; ++block) {
+        float expected = env.Process(kSampleRate, 24);
+        bank_.Process(kSampleRate, 24);
+        EXPECT_NEAR(bank_.GetOutput(5), expected, 1e-5f) << "Block " << block;
+        EXPECT_EQ(bank_.IsActive(5), env.IsActive()) << "Block " << block;
+    }
+}
+
+TEST_F(ModEnvelopeBankTest, VoicesRunIndependently) {
+    bank_.SetAttack(10.0f);
+    bank_.SetDecay(100.0f);
+
+    bank_.Trigger(0);
+    for (int i = 0; i < 20; ++i) {
+        bank_.Process(kSampleRate, 24);
+    }
+    bank_.Trigger(1);
+    bank_.Process(kSampleRate, 24);
+
+    // Voice 0 is decaying, voice 1 has just started, the rest never ran
+    EXPECT_GT(bank_.GetOutput(0), 0.0f);
+    EXPECT_LT(bank_.GetOutput(0), 1.0f);
+    EXPECT_LT(bank_.GetOutput(1), bank_.GetOutput(0));
+    EXPECT_TRUE(bank_.IsActive(1));
+    EXPECT_FALSE(bank_.IsActive(2));
+    EXPECT_FLOAT_EQ(bank_.GetOutput(2), 0.0f);
+}
@@ -180,3 +180,73 @@ TEST_F(ModulationMatrixTest, MultipleSourcesSameDestination) {
     EXPECT_GE(mod, -1.0f);
     EXPECT_LE(mod, 1.0f);
 }
+
+TEST_F(ModulationMatrixTest, VoiceEnvelopesModulateEachVoice) {
+    matrix_.SetDestination(ModSource::Env1, ModDestination::Timbre);
+    matrix_.SetAmount(ModSource::Env1, 63);
+    matrix_.GetEnv1().SetAttack(1);
+    matrix_.GetEnv1().SetDecay(1000);
+
+    matrix_.TriggerVoice(3);
+    matrix_.Process(kSampleRate, 64);
+
+    // Only the triggered voice moves; the global envelope was not triggered
+    EXPECT_GT(matrix_.GetVoiceModulation(3, ModDestination::Timbre), 0.5f);
+    EXPECT_FLOAT_EQ(matrix_.GetVoiceModulation(2, ModDestination::Timbre), 0.0f);
+    EXPECT_FLOAT_EQ(matrix_.GetModulation(ModDestination::Timbre), 0.0f);
+    EXPECT_GT(matrix_.GetModulatedVoiceValue(3, ModDestination::Timbre, 0.25f), 0.75f);
+}
+
+TEST_F(ModulationMatrixTest, VoicesShareTheLfos) {
+    matrix_.SetDestination(ModSource::Lfo1, ModDestination::Morph);
+    matrix_.SetAmount(ModSource::Lfo1, 63);
+    matrix_.GetLfo1().SetRate(LfoRateDivision::Div_1_16);
+
+    for (int i = 0; i < 10; ++i) {
+        matrix_.Process(kSampleRate, 64);
+    }
+
+    float global = matrix_.GetModulation(ModDestination::Morph);
+    EXPECT_NE(global, 0.0f);
+    for (int v = 0; v < ModulationMatrix::kMaxVoices; ++v) {
+        EXPECT_FLOAT_EQ(matrix_.GetVoiceModulation(v, ModDestination::Morph), global);
+    }
+}
+
+TEST_F(ModulationMatrixTest, EnvelopeScalesLfoAmount) {
+    matrix_.GetLfo1().SetShape(LfoShape::Square);
+    matrix_.SetDestination(ModSource::Lfo1, ModDestination::Timbre);
+    matrix_.SetAmount(ModSource::Lfo1, 32);
+    matrix_.SetDestination(ModSource::Env1, ModDestination::Lfo1Amount);
+    matrix_.SetAmount(ModSource::Env1, 63);
+    matrix_.GetEnv1().SetAttack(1);
+    matrix_.GetEnv1().SetDecay(2000);
+
+    matrix_.TriggerEnvelopes();
+    matrix_.Process(kSampleRate, 64);
+
+    // Square LFO at +1, its amount raised by half the envelope's
+    float expected = 0.5f + 1.0f * (63.0f / 64.0f) * 0.5f;
+    EXPECT_NEAR(matrix_.GetModulation(ModDestination::Timbre), expected, 1e-5f);
+}
+
+TEST_F(ModulationMatrixTest, EnvelopeModulatesLfoRate) {
+    ModulationMatrix plain;
+    plain.Init();
+    plain.GetLfo1().SetShape(LfoShape::Saw);
+    matrix_.GetLfo1().SetShape(LfoShape::Saw);
+
+    matrix_.SetDestination(ModSource::Env1, ModDestination::Lfo1Rate);
+    matrix_.SetAmount(ModSource::Env1, 63);
+    matrix_.GetEnv1().SetAttack(1);
+    matrix_.GetEnv1().SetDecay(2000);
+    matrix_.TriggerEnvelopes();
+
+    for (int i = 0; i < 10; ++i) {
+        plain.Process(kSampleRate, 64);
+        matrix_.Process(kSampleRate, 64);
+    }
+
+    // The saw falls as its phase advances: the sped-up LFO is further along
+    EXPECT_LT(matrix_.GetLfo1().GetOutput(), plain.GetLfo1().GetOutput());
+}
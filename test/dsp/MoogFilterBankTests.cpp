@@ -0,0 +1,142 @@
+// MoogFilterBank Tests
+// Part of PlaitsVST - MIT License
+
+#include <gtest/gtest.h>
+#include "dsp/moog_filter.h"
+#include "dsp/moog_filter_bank.h"
+#include <cmath>
+#include <vector>
+
+using namespace plaits;
+
+class MoogFilterBankTest : public ::testing::Test {
+protected:
+    static constexpr int kNumFilters = MoogFilterBank::kMaxFilters;
+    static constexpr size_t kSize = 301;  // Not a multiple of 4, to cover the tail
+    static constexpr float kSampleRate = 48000.0f;
+
+    void SetUp() override {
+        bank_.Init(kSampleRate);
+        for (int i = 0; i < kNumFilters; ++i) {
+            left_[i].assign(kSize, 0.0f);
+            right_[i].assign(kSize, 0.0f);
+            leftPtrs_[i] = left_[i].data();
+            rightPtrs_[i] = right_[i].data();
+        }
+    }
+
+    void fillSaw(int filter, float frequency) {
+        for (size_t n = 0; n < kSize; ++n) {
+            float phase = std::fmod(frequency * n / kSampleRate, 1.0f);
+            left_[filter][n] = 2.0f * phase - 1.0f;
+            right_[filter][n] = 1.0f - 2.0f * phase;
+        }
+    }
+
+    MoogFilterBank bank_;
+    std::vector<float> left_[kNumFilters];
+    std::vector<float> right_[kNumFilters];
+    float* leftPtrs_[kNumFilters];
+    float* rightPtrs_[kNumFilters];
+};
+
+TEST_F(MoogFilterBankTest, MatchesMoogFilterPerVoice) {
+    bool active[kNumFilters];
+    MoogFilter reference[kNumFilters];
+    std::vector<float> expectedLeft[kNumFilters], expectedRight[kNumFilters];
+
+    for (int i = 0; i < kNumFilters; ++i) {
+        float cutoff = 200.0f * static_cast<float>(i + 1);
+        float resonance = 0.05f * static_cast<float>(i);
+        bank_.SetCutoff(i, cutoff);
+        bank_.SetResonance(i, resonance);
+        reference[i].Init(kSampleRate);
+        reference[i].SetCutoff(cutoff);
+        reference[i].SetResonance(resonance);
+
+        fillSaw(i, 55.0f * static_cast<float>(i + 1));
+        expectedLeft[i] = left_[i];
+        expectedRight[i] = right_[i];
+        reference[i].Process(expectedLeft[i].data(), expectedRight[i].data(), kSize);
+        active[i] = true;
+    }
+
+    bank_.Process(leftPtrs_, rightPtrs_, active, kSize);
+
+    for (int i = 0; i < kNumFilters; ++i) {
+        for (size_t n = 0; n < kSize; ++n) {
+            ASSERT_NEAR(left_[i][n], expectedLeft[i][n], 1e-6f) << "Filter " << i << " sample " << n;
+            ASSERT_NEAR(right_[i][n], expectedRight[i][n], 1e-6f) << "Filter " << i << " sample " << n;
+        }
+    }
+}
+
+TEST_F(MoogFilterBankTest, InactiveFiltersAreSilentOrSkipped) {
+    bool active[kNumFilters] = {};
+    active[1] = true;
+    for (int i = 0; i < kNumFilters; ++i) {
+        fillSaw(i, 110.0f);
+    }
+
+    bank_.Process(leftPtrs_, rightPtrs_, active, kSize);
+
+    // Same group as the active filter: cleared and run on silence
+    for (size_t n = 0; n < kSize; ++n) {
+        EXPECT_EQ(left_[0][n], 0.0f);
+        EXPECT_EQ(right_[3][n], 0.0f);
+    }
+
+    // Other groups are left untouched
+    EXPECT_FLOAT_EQ(left_[4][1], 2.0f * std::fmod(110.0f / kSampleRate, 1.0f) - 1.0f);
+}
+
+TEST_F(MoogFilterBankTest, ResetClearsOneFilter) {
+    bool active[kNumFilters];
+    for (int i = 0; i < kNumFilters; ++i) {
+        fillSaw(i, 220.0f);
+        active[i] = true;
+    }
+    bank_.Process(leftPtrs_, rightPtrs_, active, kSize);
+
+    bank_.Reset(2);
+    for (int i = 0; i < kNumFilters; ++i) {
+        left_[i].assign(kSize, 0.0f);
+        right_[i].assign(kSize, 0.0f);
+    }
+    bank_.Process(leftPtrs_, rightPtrs_, active, kSize);
+
+    // The reset filter has no tail; its neighbours still ring out
+    EXPECT_EQ(left_[2][0], 0.0f);
+    EXPECT_NE(left_[3][0], 0.0f);
+}
+
+TEST_F(MoogFilterBankTest, GlideMatchesMoogFilterRamp) {
+    constexpr size_t kGlide = 101;  // Ends part-way through a group of four
+    bool active[kNumFilters];
+    MoogFilter reference[kNumFilters];
+    std::vector<float> expectedLeft[kNumFilters], expectedRight[kNumFilters];
+
+    for (int i = 0; i < kNumFilters; ++i) {
+        float cutoff = 150.0f * static_cast<float>(i + 1);
+        float resonance = 0.04f * static_cast<float>(i);
+        bank_.SetTarget(i, cutoff, resonance);
+        reference[i].Init(kSampleRate);
+        reference[i].RampTo(cutoff, resonance, kGlide);
+
+        fillSaw(i, 70.0f * static_cast<float>(i + 1));
+        expectedLeft[i] = left_[i];
+        expectedRight[i] = right_[i];
+        reference[i].Process(expectedLeft[i].data(), expectedRight[i].data(), kSize);
+        active[i] = true;
+    }
+
+    bank_.Glide(kGlide);
+    bank_.Process(leftPtrs_, rightPtrs_, active, kSize);
+
+    for (int i = 0; i < kNumFilters; ++i) {
+        for (size_t n = 0; n < kSize; ++n) {
+            ASSERT_NEAR(left_[i][n], expectedLeft[i][n], 1e-5f) << "Filter " << i << " sample " << n;
+            ASSERT_NEAR(right_[i][n], expectedRight[i][n], 1e-5f) << "Filter " << i << " sample " << n;
+        }
+    }
+}
@@ -190,3 +190,113 @@ TEST_F(MoogFilterTest, DifferentSampleRatesWork) {
     EXPECT_GT(std::abs(output44), 0.0f);
     EXPECT_GT(std::abs(output96), 0.0f);
 }
+
+TEST_F(MoogFilterTest, SilentOnceRingingDecays) {
+    EXPECT_TRUE(filter_.IsSilent());
+
+    filter_.SetCutoff(1000.0f);
+    filter_.SetResonance(0.9f);
+    filter_.Process(1.0f);
+    EXPECT_FALSE(filter_.IsSilent());
+
+    // The resonant tail keeps the filter busy for a while, then dies out
+    int samples = 0;
+    while (!filter_.IsSilent() && samples < 48000) {
+        filter_.Process(0.0f);
+        ++samples;
+    }
+    EXPECT_GT(samples, 100);
+    EXPECT_LT(samples, 48000);
+}
+
+TEST_F(MoogFilterTest, StereoChannelsHaveIndependentState) {
+    MoogFilter mono;
+    mono.Init(kSampleRate);
+    mono.SetCutoff(2000.0f);
+    mono.SetResonance(0.7f);
+    filter_.SetCutoff(2000.0f);
+    filter_.SetResonance(0.7f);
+
+    // Signal on the left only: the right channel must stay silent, and the
+    // left must match a mono filter fed the same input
+    float left[256], right[256];
+    for (int i = 0; i < 256; ++i) {
+        left[i] = std::sin(2.0f * 3.14159265f * 440.0f * i / kSampleRate);
+        right[i] = 0.0f;
+    }
+
+    float expected[256];
+    for (int i = 0; i < 256; ++i) {
+        expected[i] = mono.Process(left[i]);
+    }
+
+    filter_.Process(left, right, 256);
+
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_NEAR(left[i], expected[i], 1e-6f) << "Sample " << i;
+        EXPECT_EQ(right[i], 0.0f) << "Sample " << i;
+    }
+}
+
+TEST_F(MoogFilterTest, RampReachesTargetAfterNumSamples) {
+    MoogFilter direct;
+    direct.Init(kSampleRate);
+    direct.SetCutoff(500.0f);
+    direct.SetResonance(0.3f);
+
+    filter_.RampTo(500.0f, 0.3f, 24);
+    EXPECT_FLOAT_EQ(filter_.GetCutoff(), 500.0f);
+    EXPECT_FLOAT_EQ(filter_.GetResonance(), 0.3f);
+
+    // Silence leaves the state untouched while the ramp runs out
+    for (int i = 0; i < 24; ++i) {
+        EXPECT_EQ(filter_.Process(0.0f), 0.0f);
+    }
+
+    // From here on the coefficients must match exactly
+    for (int i = 0; i < 256; ++i) {
+        float input = std::sin(2.0f * 3.14159265f * 220.0f * i / kSampleRate);
+        EXPECT_EQ(filter_.Process(input), direct.Process(input)) << "Sample " << i;
+    }
+}
+
+TEST_F(MoogFilterTest, RampGlidesInsteadOfStepping) {
+    // Settle on a bright steady tone
+    for (int i = 0; i < 4800; ++i) {
+        filter_.Process(std::sin(2.0f * 3.14159265f * 2000.0f * i / kSampleRate));
+    }
+
+    MoogFilter unchanged = filter_;
+    MoogFilter stepped = filter_;
+    stepped.SetCutoff(100.0f);
+    filter_.RampTo(100.0f, 0.0f, 240);
+
+    // Right after the change the ramped filter still sounds like the old
+    // setting, where the stepped one has already jumped
+    float input = std::sin(2.0f * 3.14159265f * 2000.0f * 4800 / kSampleRate);
+    float before = unchanged.Process(input);
+    float ramped = filter_.Process(input);
+    float jumped = stepped.Process(input);
+    EXPECT_LT(std::abs(ramped - before), std::abs(jumped - before));
+
+    for (int i = 4801; i < 4800 + 240; ++i) {
+        EXPECT_TRUE(std::isfinite(filter_.Process(std::sin(2.0f * 3.14159265f * 2000.0f * i / kSampleRate))));
+    }
+}
+
+TEST_F(MoogFilterTest, SampleRateChangeUpdatesCoefficients) {
+    // Setting an unchanged cutoff is skipped, so a new sample rate must
+    // recompute the coefficients itself
+    MoogFilter reference;
+    reference.Init(96000.0f);
+    reference.SetCutoff(1000.0f);
+
+    filter_.SetCutoff(1000.0f);
+    filter_.SetSampleRate(96000.0f);
+    filter_.SetCutoff(1000.0f);
+
+    for (int i = 0; i < 256; ++i) {
+        float input = std::sin(2.0f * 3.14159265f * 440.0f * i / 96000.0f);
+        EXPECT_EQ(filter_.Process(input), reference.Process(input)) << "Sample " << i;
+    }
+}
@@ -0,0 +1,49 @@
+// ParameterSmoother Tests
+// Part of PlaitsVST - MIT License
+
+#include <gtest/gtest.h>
+#include "dsp/parameter_smoother.h"
+#include <cmath>
+
+using namespace plaits;
+
+TEST(ParameterSmootherTest, ReachesTimeConstant) {
+    ParameterSmoother smoother;
+    smoother.Init(48000.0f, 10.0f, 24);
+    smoother.Reset(0.0f);
+
+    // 10ms at 48kHz is 20 ticks of 24 samples
+    for (int i = 0; i < 20; ++i) {
+        smoother.Process(1.0f);
+    }
+    EXPECT_NEAR(smoother.GetValue(), 1.0f - std::exp(-1.0f), 1e-3f);
+
+    for (int i = 0; i < 400; ++i) {
+        smoother.Process(1.0f);
+    }
+    EXPECT_NEAR(smoother.GetValue(), 1.0f, 1e-5f);
+}
+
+TEST(ParameterSmootherTest, GlideTimeDoesNotDependOnStep) {
+    ParameterSmoother fine, coarse;
+    fine.Init(48000.0f, 20.0f, 24);
+    coarse.Init(48000.0f, 20.0f, 96);
+    fine.Reset(0.0f);
+    coarse.Reset(0.0f);
+
+    // Same span of time: 960 samples
+    for (int i = 0; i < 40; ++i) {
+        fine.Process(1.0f);
+    }
+    for (int i = 0; i < 10; ++i) {
+        coarse.Process(1.0f);
+    }
+    EXPECT_NEAR(fine.GetValue(), coarse.GetValue(), 1e-4f);
+}
+
+TEST(ParameterSmootherTest, ShortTimeJumps) {
+    ParameterSmoother smoother;
+    smoother.Init(48000.0f, 0.0f, 24);
+    smoother.Reset(0.25f);
+    EXPECT_FLOAT_EQ(smoother.Process(0.75f), 0.75f);
+}
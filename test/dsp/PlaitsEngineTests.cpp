@@ -2,13 +2,15 @@
 #include "dsp/voice.h"
 #include <cmath>
 #include <algorithm>
+#include <memory>
 #include <string>
+#include <vector>
 
-// Test that all 16 Plaits engines produce valid output
+// Test that all 24 Plaits engines produce valid output
 class PlaitsEngineTest : public ::testing::TestWithParam<int> {
 protected:
     void SetUp() override {
-        voice_.Init(44100.0);
+        voice_.Init();
     }
 
     Voice voice_;
@@ -167,23 +169,24 @@ std::string GetEngineName(const ::testing::TestParamInfo<int>& info) {
     const char* names[] = {
         "VA", "Waveshaper", "FM", "Grain", "Additive", "Wavetable",
         "Chord", "Speech", "Swarm", "Noise", "Particle", "String",
-        "Modal", "BassDrum", "Snare", "HiHat"
+        "Modal", "BassDrum", "Snare", "HiHat", "VAVCF", "PhaseDistortion",
+        "SixOp1", "SixOp2", "SixOp3", "WaveTerrain", "StringMachine", "Chiptune"
     };
     return std::string(names[info.param]);
 }
 
-// Instantiate tests for all 16 engines
+// Instantiate tests for all 24 engines
 INSTANTIATE_TEST_SUITE_P(
     AllEngines,
     PlaitsEngineTest,
-    ::testing::Range(0, 16),
+    ::testing::Range(0, Voice::kNumEngines),
     GetEngineName);
 
 // Additional engine-specific tests
 class EngineSpecificTest : public ::testing::Test {
 protected:
     void SetUp() override {
-        voice_.Init(44100.0);
+        voice_.Init();
     }
 
     Voice voice_;
@@ -306,3 +309,82 @@ TEST_F(EngineSpecificTest, ModalEngineResonates) {
 
     EXPECT_GT(sum, 0.0f) << "Modal engine should produce output";
 }
+
+TEST(PlaitsVoiceRenderTest, FloatRenderMatchesInt16Render) {
+    constexpr size_t kBufferSize = 32768;
+    constexpr size_t kBlockSize = 24;
+    std::vector<uint8_t> intRam(kBufferSize), floatRam(kBufferSize);
+
+    stmlib::BufferAllocator intAllocator(intRam.data(), kBufferSize);
+    stmlib::BufferAllocator floatAllocator(floatRam.data(), kBufferSize);
+    auto intVoice = std::make_unique<plaits::Voice>();
+    auto floatVoice = std::make_unique<plaits::Voice>();
+    intVoice->Init(&intAllocator);
+    floatVoice->Init(&floatAllocator);
+
+    plaits::Patch patch = {};
+    patch.engine = 8;  // Virtual analog
+    patch.note = 48.0f;
+    patch.harmonics = 0.3f;
+    patch.timbre = 0.6f;
+    patch.morph = 0.4f;
+    patch.decay = 0.5f;
+    patch.lpg_colour = 0.5f;
+
+    plaits::Modulations modulations = {};
+    modulations.trigger_patched = true;
+
+    plaits::Voice::Frame frames[kBlockSize];
+    float out[kBlockSize], aux[kBlockSize];
+
+    for (int block = 0; block < 64; ++block) {
+        modulations.trigger = block < 4 ? 1.0f : 0.0f;
+        intVoice->Render(patch, modulations, frames, kBlockSize);
+        floatVoice->Render(patch, modulations, out, aux, kBlockSize);
+
+        for (size_t i = 0; i < kBlockSize; ++i) {
+            // Only the 16-bit quantization (truncation plus rounding offset) differs
+            EXPECT_NEAR(out[i], frames[i].out / 32767.0f, 3.0f / 32767.0f);
+            EXPECT_NEAR(aux[i], frames[i].aux / 32767.0f, 3.0f / 32767.0f);
+        }
+    }
+}
+
+TEST(PlaitsVoiceRenderTest, EnginesAreBuiltWhenSelected) {
+    constexpr size_t kBufferSize = 32768;
+    constexpr size_t kBlockSize = 24;
+    std::vector<uint8_t> ram(kBufferSize);
+
+    stmlib::BufferAllocator allocator(ram.data(), kBufferSize);
+    auto voice = std::make_unique<plaits::Voice>();
+    voice->Init(&allocator);
+    EXPECT_EQ(voice->active_engine(), -1);
+
+    plaits::Patch patch = {};
+    patch.note = 48.0f;
+    patch.harmonics = 0.5f;
+    patch.timbre = 0.5f;
+    patch.morph = 0.5f;
+    patch.decay = 0.5f;
+    patch.lpg_colour = 0.5f;
+
+    plaits::Modulations modulations = {};
+    modulations.trigger_patched = true;
+
+    float out[kBlockSize], aux[kBlockSize];
+
+    // Visit every engine, then come back to the first one
+    for (int engine = 0; engine <= plaits::kMaxEngines; ++engine) {
+        patch.engine = engine % plaits::kMaxEngines;
+        for (int block = 0; block < 32; ++block) {
+            modulations.trigger = block < 4 ? 1.0f : 0.0f;
+            voice->Render(patch, modulations, out, aux, kBlockSize);
+
+            for (size_t i = 0; i < kBlockSize; ++i) {
+                ASSERT_TRUE(std::isfinite(out[i])) << "Engine " << patch.engine;
+                ASSERT_TRUE(std::isfinite(aux[i])) << "Engine " << patch.engine;
+            }
+        }
+        EXPECT_EQ(voice->active_engine(), patch.engine);
+    }
+}
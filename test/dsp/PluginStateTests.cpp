@@ -0,0 +1,102 @@
+// PluginState Tests
+// Part of PlaitsVST - MIT License
+
+#include <gtest/gtest.h>
+#include "dsp/plugin_state.h"
+#include <vector>
+
+namespace {
+    PluginState makeState()
+    {
+        PluginState state;
+        state.engine = 17;
+        state.harmonics = 0.125f;
+        state.timbre = 0.875f;
+        state.morph = 0.3f;
+        state.attack = 0.01f;
+        state.decay = 0.9f;
+        state.polyphony = 12;
+        state.cutoff = 0.42f;
+        state.resonance = 0.66f;
+        state.filterMode = 1;
+        state.lfo[0] = {2, 3, 4, -20};
+        state.lfo[1] = {9, 1, 8, 63};
+        state.env[0] = {0.2f, 0.7f, 3, -64};
+        state.env[1] = {0.4f, 0.1f, 6, 5};
+        state.multiThreaded = true;
+        state.modulationSeed = 0xdeadbeefu;
+        return state;
+    }
+
+    void expectEqual(const PluginState& a, const PluginState& b)
+    {
+        std::vector<uint8_t> blobA(PluginState::kSerializedSize);
+        std::vector<uint8_t> blobB(PluginState::kSerializedSize);
+        a.write(blobA.data());
+        b.write(blobB.data());
+        EXPECT_EQ(blobA, blobB);
+    }
+}
+
+TEST(PluginStateTest, RoundTrips) {
+    PluginState saved = makeState();
+    std::vector<uint8_t> blob(PluginState::kSerializedSize);
+    saved.write(blob.data());
+
+    PluginState restored;
+    ASSERT_TRUE(restored.read(blob.data(), blob.size()));
+    expectEqual(restored, saved);
+    EXPECT_EQ(restored.engine, 17);
+    EXPECT_FLOAT_EQ(restored.harmonics, 0.125f);
+    EXPECT_EQ(restored.lfo[0].amount, -20);
+    EXPECT_FLOAT_EQ(restored.env[1].attack, 0.4f);
+    EXPECT_TRUE(restored.multiThreaded);
+    EXPECT_EQ(restored.modulationSeed, 0xdeadbeefu);
+}
+
+TEST(PluginStateTest, FieldCountMatchesLayout) {
+    PluginState state;
+    size_t fields = 0;
+    PluginState::visitFields(state, [&fields](auto&) { ++fields; });
+    EXPECT_EQ(fields, PluginState::kNumFields);
+}
+
+TEST(PluginStateTest, RejectsOtherData) {
+    PluginState state = makeState();
+    const char xml[] = "<?xml version=\"1.0\"?><PlaitsVSTState engine=\"3\"/>";
+    EXPECT_FALSE(state.read(xml, sizeof(xml)));
+    EXPECT_FALSE(state.read(nullptr, 0));
+    EXPECT_EQ(state.engine, 17);
+}
+
+TEST(PluginStateTest, ShorterBlobKeepsMissingFields) {
+    PluginState saved = makeState();
+    std::vector<uint8_t> blob(PluginState::kSerializedSize);
+    saved.write(blob.data());
+
+    // An older version with only the first three fields
+    const size_t fields = 3;
+    blob[8] = static_cast<uint8_t>(fields * 4);
+    blob.resize(PluginState::kHeaderSize + fields * 4);
+
+    PluginState restored;
+    ASSERT_TRUE(restored.read(blob.data(), blob.size()));
+    EXPECT_EQ(restored.engine, 17);
+    EXPECT_FLOAT_EQ(restored.timbre, 0.875f);
+    EXPECT_FLOAT_EQ(restored.morph, PluginState().morph);
+    EXPECT_EQ(restored.modulationSeed, PluginState().modulationSeed);
+}
+
+TEST(PluginStateTest, LongerBlobReadsKnownFields) {
+    PluginState saved = makeState();
+    std::vector<uint8_t> blob(PluginState::kSerializedSize);
+    saved.write(blob.data());
+
+    // A newer version with two more fields on the end
+    blob.resize(blob.size() + 8, 0xab);
+    blob[8] = static_cast<uint8_t>(PluginState::kPayloadSize + 8);
+
+    PluginState restored;
+    ASSERT_TRUE(restored.read(blob.data(), blob.size()));
+    expectEqual(restored, saved);
+}
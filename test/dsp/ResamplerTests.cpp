@@ -112,7 +112,7 @@ TEST_F(ResamplerTest, HandlesEmptyInput) {
     resampler_.Init(48000.0, 44100.0);
 
     float output[100];
-    size_t outputSize = resampler_.Process(nullptr, 0, output, 100);
+    size_t outputSize = resampler_.Process(static_cast<const float*>(nullptr), 0, output, 100);
 
     EXPECT_EQ(outputSize, 0);
 }
@@ -148,3 +148,34 @@ TEST_F(ResamplerTest, ConsecutiveCallsWork) {
         EXPECT_GT(outputSize, 0) << "Call " << call << " should produce output";
     }
 }
+
+TEST_F(ResamplerTest, LeavesUnneededInputUnconsumed) {
+    resampler_.Init(48000.0, 44100.0);
+
+    float input[200];
+    for (int i = 0; i < 200; ++i) {
+        input[i] = std::sin(i * 0.05f);
+    }
+
+    // Reference: everything in one call
+    Resampler reference;
+    reference.Init(48000.0, 44100.0);
+    float expected[200];
+    size_t expectedSize = reference.Process(input, 200, expected, 200);
+
+    // Same stream pulled in small output chunks
+    float output[200];
+    size_t written = 0;
+    size_t read = 0;
+    while (read < 200) {
+        size_t produced = resampler_.Process(input + read, 200 - read, output + written, 7);
+        EXPECT_LE(resampler_.consumed(), 200 - read);
+        read += resampler_.consumed();
+        written += produced;
+    }
+
+    ASSERT_EQ(written, expectedSize);
+    for (size_t i = 0; i < written; ++i) {
+        EXPECT_NEAR(output[i], expected[i], 1e-5f) << "Sample " << i;
+    }
+}
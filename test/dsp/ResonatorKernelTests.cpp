@@ -0,0 +1,110 @@
+// Resonator Kernel Tests
+// Part of PlaitsVST - MIT License
+
+#include <gtest/gtest.h>
+#include "plaits/dsp/physical_modelling/resonator_kernel.h"
+#include "plaits/dsp/physical_modelling/resonator.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+    constexpr size_t kBlockSize = 24;
+
+    // Mode settings like the ones Resonator::Process() produces: rising
+    // frequencies, falling Q and a spread of gains
+    struct Modes {
+        std::vector<float> f, q, gain;
+        std::vector<float> g, r_plus_g, h;
+
+        explicit Modes(int count)
+        {
+            for (int i = 0; i < count; ++i) {
+                float frequency = std::min(0.002f * static_cast<float>(i + 1) * (1.0f + 0.01f * i), 0.499f);
+                f.push_back(frequency);
+                q.push_back(1.0f + frequency * 2000.0f * std::pow(0.9f, static_cast<float>(i)));
+                gain.push_back(0.25f * std::cos(0.3f * static_cast<float>(i)) * (1.0f - 2.0f * frequency));
+
+                // As ResonatorSvf computes them
+                float gi = stmlib::OnePole::tan<stmlib::FREQUENCY_FAST>(f[i]);
+                float r = 1.0f / q[i];
+                g.push_back(gi);
+                h.push_back(1.0f / (1.0f + r * gi + gi * gi));
+                r_plus_g.push_back(r + gi);
+            }
+        }
+
+        plaits::ModeCoefficients coefficients() const
+        {
+            return { g.data(), r_plus_g.data(), h.data(), gain.data() };
+        }
+    };
+
+    // An impulse, then noise-like input
+    void fillInput(float* in, int block)
+    {
+        for (size_t i = 0; i < kBlockSize; ++i) {
+            int n = block * static_cast<int>(kBlockSize) + static_cast<int>(i);
+            in[i] = n == 0 ? 1.0f : 0.1f * std::sin(static_cast<float>(n) * 12.9898f);
+        }
+    }
+
+    // Runs the kernel against one ResonatorSvf<4> per batch, as Resonator
+    // used to, and expects identical output
+    void expectMatchesScalar(plaits::ModeKernel kernel, int numModes)
+    {
+        Modes modes(numModes);
+        const int numBatches = numModes / plaits::kModeBatchSize;
+        std::vector<plaits::ResonatorSvf<plaits::kModeBatchSize>> batches(static_cast<size_t>(numBatches));
+        for (auto& batch : batches) {
+            batch.Init();
+        }
+        std::vector<float> state1(static_cast<size_t>(numModes), 0.0f);
+        std::vector<float> state2(static_cast<size_t>(numModes), 0.0f);
+
+        for (int block = 0; block < 200; ++block) {
+            float in[kBlockSize];
+            fillInput(in, block);
+
+            float expected[kBlockSize], out[kBlockSize];
+            for (size_t i = 0; i < kBlockSize; ++i) {
+                expected[i] = out[i] = 0.01f * static_cast<float>(i);
+            }
+
+            for (int b = 0; b < numBatches; ++b) {
+                const int first = b * plaits::kModeBatchSize;
+                batches[static_cast<size_t>(b)].Process<stmlib::FILTER_MODE_BAND_PASS, true>(
+                    &modes.f[first], &modes.q[first], &modes.gain[first], in, expected, kBlockSize);
+            }
+            plaits::ProcessModes(kernel, modes.coefficients(), state1.data(), state2.data(),
+                                 numModes, in, out, kBlockSize);
+
+            for (size_t i = 0; i < kBlockSize; ++i) {
+                ASSERT_EQ(out[i], expected[i]) << "Block " << block << " sample " << i;
+            }
+        }
+    }
+}
+
+TEST(ResonatorKernelTest, Float4KernelMatchesResonatorSvf) {
+    expectMatchesScalar(plaits::MODE_KERNEL_FLOAT4, plaits::kMaxNumModes);
+}
+
+TEST(ResonatorKernelTest, AvxKernelMatchesResonatorSvf) {
+    if (!plaits::ModeKernelSupported(plaits::MODE_KERNEL_AVX)) {
+        GTEST_SKIP() << "No AVX on this CPU";
+    }
+    expectMatchesScalar(plaits::MODE_KERNEL_AVX, plaits::kMaxNumModes);
+}
+
+TEST(ResonatorKernelTest, OddBatchCountsMatchResonatorSvf) {
+    // Five batches: the AVX kernel finishes with a four-wide batch
+    expectMatchesScalar(plaits::MODE_KERNEL_FLOAT4, 20);
+    expectMatchesScalar(plaits::DefaultModeKernel(), 20);
+    expectMatchesScalar(plaits::DefaultModeKernel(), 4);
+}
+
+TEST(ResonatorKernelTest, DefaultKernelIsSupported) {
+    EXPECT_TRUE(plaits::ModeKernelSupported(plaits::MODE_KERNEL_FLOAT4));
+    EXPECT_TRUE(plaits::ModeKernelSupported(plaits::DefaultModeKernel()));
+}
@@ -0,0 +1,82 @@
+// TripleBuffer Tests
+// Part of PlaitsVST - MIT License
+
+#include <gtest/gtest.h>
+#include "dsp/triple_buffer.h"
+#include <array>
+#include <atomic>
+#include <thread>
+
+namespace {
+    struct Payload {
+        std::array<int, 32> values{};
+    };
+}
+
+TEST(TripleBufferTest, NothingToReadUntilPublished) {
+    TripleBuffer<int> buffer;
+    EXPECT_EQ(buffer.read(), nullptr);
+
+    buffer.writeBuffer() = 7;
+    EXPECT_EQ(buffer.read(), nullptr);
+
+    buffer.publish();
+    const int* value = buffer.read();
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, 7);
+
+    // Each publish is read once
+    EXPECT_EQ(buffer.read(), nullptr);
+}
+
+TEST(TripleBufferTest, ReadsTheNewestValue) {
+    TripleBuffer<int> buffer;
+    for (int i = 1; i <= 5; ++i) {
+        buffer.writeBuffer() = i;
+        buffer.publish();
+    }
+
+    const int* value = buffer.read();
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, 5);
+}
+
+TEST(TripleBufferTest, ConcurrentReadsAreNeverTorn) {
+    TripleBuffer<Payload> buffer;
+    constexpr int kWrites = 200000;
+    std::atomic<bool> done{false};
+
+    std::thread writer([&] {
+        for (int i = 1; i <= kWrites; ++i) {
+            buffer.writeBuffer().values.fill(i);
+            buffer.publish();
+        }
+        done.store(true);
+    });
+
+    int last = 0;
+    bool torn = false;
+    bool backwards = false;
+    auto check = [&](const Payload* payload) {
+        int first = payload->values[0];
+        for (int v : payload->values) {
+            torn = torn || v != first;
+        }
+        backwards = backwards || first <= last;
+        last = first;
+    };
+
+    while (!done.load()) {
+        if (const Payload* payload = buffer.read()) {
+            check(payload);
+        }
+    }
+    writer.join();
+    if (const Payload* payload = buffer.read()) {
+        check(payload);
+    }
+
+    EXPECT_FALSE(torn);
+    EXPECT_FALSE(backwards);
+    EXPECT_EQ(last, kWrites);
+}
@@ -0,0 +1,135 @@
+// VirtualAnalogBank Tests
+// Part of PlaitsVST - MIT License
+
+#include <gtest/gtest.h>
+#include "dsp/virtual_analog_bank.h"
+#include "plaits/dsp/engine/virtual_analog_engine.h"
+#include "stmlib/utils/buffer_allocator.h"
+#include <cmath>
+#include <memory>
+
+namespace {
+    constexpr size_t kBlockSize = plaits::kMaxBlockSize;
+
+    // One scalar engine with its own scratch memory
+    struct ScalarEngine {
+        uint8_t memory[1024];
+        stmlib::BufferAllocator allocator;
+        plaits::VirtualAnalogEngine engine;
+
+        void Init()
+        {
+            allocator.Init(memory, sizeof(memory));
+            engine.Init(&allocator);
+        }
+    };
+
+    // Parameters that sweep through sync, pulse width and shape changes
+    plaits::EngineParameters parametersFor(int voice, int block)
+    {
+        plaits::EngineParameters p = {};
+        p.trigger = plaits::TRIGGER_UNPATCHED;
+        p.note = 36.0f + 7.0f * static_cast<float>(voice) + static_cast<float>(block % 24);
+        p.timbre = std::fmod(0.13f * static_cast<float>(block) + 0.3f * static_cast<float>(voice), 1.0f);
+        p.morph = std::fmod(0.07f * static_cast<float>(block) + 0.25f * static_cast<float>(voice), 1.0f);
+        p.harmonics = std::fmod(0.05f * static_cast<float>(block) + 0.2f * static_cast<float>(voice), 1.0f);
+        p.accent = 0.8f;
+        return p;
+    }
+}
+
+TEST(VirtualAnalogBankTest, LanesMatchTheScalarEngine) {
+    constexpr int kVoices = plaits::VirtualAnalogBank::kLanes;
+
+    auto scalar = std::make_unique<ScalarEngine[]>(kVoices);
+    for (int v = 0; v < kVoices; ++v) {
+        scalar[v].Init();
+    }
+    plaits::VirtualAnalogBank bank;
+    bank.Init();
+
+    const int voices[kVoices] = { 3, 9, 0, 14 };
+    float out[kVoices][kBlockSize], aux[kVoices][kBlockSize];
+    float* outPtrs[kVoices] = { out[0], out[1], out[2], out[3] };
+    float* auxPtrs[kVoices] = { aux[0], aux[1], aux[2], aux[3] };
+
+    float maxError = 0.0f;
+    float energy = 0.0f;
+    for (int block = 0; block < 400; ++block) {
+        plaits::EngineParameters parameters[kVoices];
+        for (int v = 0; v < kVoices; ++v) {
+            parameters[v] = parametersFor(v, block);
+        }
+        bank.Render(voices, parameters, outPtrs, auxPtrs, kVoices, kBlockSize);
+
+        for (int v = 0; v < kVoices; ++v) {
+            float expectedOut[kBlockSize], expectedAux[kBlockSize];
+            bool enveloped = false;
+            scalar[v].engine.Render(parameters[v], expectedOut, expectedAux, kBlockSize, &enveloped);
+            for (size_t i = 0; i < kBlockSize; ++i) {
+                maxError = std::max(maxError, std::abs(out[v][i] - expectedOut[i]));
+                energy += expectedOut[i] * expectedOut[i];
+                maxError = std::max(maxError, std::abs(aux[v][i] - expectedAux[i]));
+            }
+        }
+    }
+
+    EXPECT_GT(energy, 1.0f);
+    EXPECT_LT(maxError, 1.0e-5f);
+}
+
+TEST(VirtualAnalogBankTest, VoicesDoNotDependOnTheirLaneMates) {
+    plaits::VirtualAnalogBank alone, shared;
+    alone.Init();
+    shared.Init();
+
+    float out[4][kBlockSize], aux[4][kBlockSize];
+    float* outPtrs[4] = { out[0], out[1], out[2], out[3] };
+    float* auxPtrs[4] = { aux[0], aux[1], aux[2], aux[3] };
+    float soloOut[kBlockSize], soloAux[kBlockSize];
+    float* soloOutPtr = soloOut;
+    float* soloAuxPtr = soloAux;
+
+    const int sharedVoices[4] = { 5, 1, 2, 7 };
+    const int soloVoice = 5;
+    for (int block = 0; block < 100; ++block) {
+        plaits::EngineParameters parameters[4];
+        for (int v = 0; v < 4; ++v) {
+            parameters[v] = parametersFor(v, block);
+        }
+
+        // Voice 5 alone, or in lane 0 beside three others
+        shared.Render(sharedVoices, parameters, outPtrs, auxPtrs, 4, kBlockSize);
+        alone.Render(&soloVoice, parameters, &soloOutPtr, &soloAuxPtr, 1, kBlockSize);
+
+        for (size_t i = 0; i < kBlockSize; ++i) {
+            ASSERT_EQ(out[0][i], soloOut[i]);
+            ASSERT_EQ(aux[0][i], soloAux[i]);
+        }
+    }
+}
+
+TEST(VirtualAnalogBankTest, ResetRestartsOneVoice) {
+    const int voice = 2;
+    plaits::EngineParameters parameters = parametersFor(0, 0);
+    float expected[kBlockSize], out[kBlockSize], aux[kBlockSize];
+    float* outPtr = expected;
+    float* auxPtr = aux;
+
+    plaits::VirtualAnalogBank fresh;
+    fresh.Init();
+    fresh.Render(&voice, &parameters, &outPtr, &auxPtr, 1, kBlockSize);
+
+    plaits::VirtualAnalogBank bank;
+    bank.Init();
+    outPtr = out;
+    for (int block = 0; block < 10; ++block) {
+        bank.Render(&voice, &parameters, &outPtr, &auxPtr, 1, kBlockSize);
+    }
+    bank.Reset(voice);
+    bank.Render(&voice, &parameters, &outPtr, &auxPtr, 1, kBlockSize);
+
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        EXPECT_EQ(out[i], expected[i]);
+    }
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "dsp/voice_allocator.h"
 #include <cmath>
+#include <iterator>
+#include <memory>
 #include <set>
 
 class VoiceAllocatorTest : public ::testing::Test {
@@ -21,6 +23,17 @@ TEST_F(VoiceAllocatorTest, NoteOnAllocatesVoice) {
     EXPECT_EQ(allocator_.activeVoiceCount(), 1);
 }
 
+TEST_F(VoiceAllocatorTest, NoteOnReportsItsVoice) {
+    int first = allocator_.NoteOn(60, 1.0f, 10.0f, 100.0f);
+    int second = allocator_.NoteOn(64, 1.0f, 10.0f, 100.0f);
+    EXPECT_GE(first, 0);
+    EXPECT_GE(second, 0);
+    EXPECT_NE(first, second);
+
+    // Retriggering a playing note reuses its voice
+    EXPECT_EQ(allocator_.NoteOn(60, 1.0f, 10.0f, 100.0f), first);
+}
+
 TEST_F(VoiceAllocatorTest, MultipleNotesAllocateMultipleVoices) {
     allocator_.NoteOn(60, 1.0f, 10.0f, 100.0f);
     allocator_.NoteOn(64, 1.0f, 10.0f, 100.0f);
@@ -241,3 +254,354 @@ TEST_F(VoiceAllocatorTest, HarmonicsTimbreMorphWork) {
 
     EXPECT_GT(sum, 0.0f);
 }
+
+TEST_F(VoiceAllocatorTest, OutputIndependentOfHostBlockSize) {
+    VoiceAllocator chunked;
+    chunked.Init(44100.0, 8);
+
+    allocator_.NoteOn(60, 1.0f, 0.0f, 500.0f);
+    allocator_.NoteOn(67, 1.0f, 0.0f, 500.0f);
+    chunked.NoteOn(60, 1.0f, 0.0f, 500.0f);
+    chunked.NoteOn(67, 1.0f, 0.0f, 500.0f);
+
+    float left[1024], right[1024];
+    allocator_.Process(left, right, 1024);
+
+    float chunkLeft[1024], chunkRight[1024];
+    for (size_t offset = 0; offset < 1024; offset += 64) {
+        chunked.Process(chunkLeft + offset, chunkRight + offset, 64);
+    }
+
+    for (int i = 0; i < 1024; ++i) {
+        EXPECT_NEAR(left[i], chunkLeft[i], 1e-5f) << "Left sample " << i;
+        EXPECT_NEAR(right[i], chunkRight[i], 1e-5f) << "Right sample " << i;
+    }
+}
+
+TEST_F(VoiceAllocatorTest, SupportedHostRateRendersNatively) {
+    EXPECT_TRUE(allocator_.isNativeRate());
+    EXPECT_DOUBLE_EQ(allocator_.renderSampleRate(), 44100.0);
+
+    // The rate is only in force while the allocator renders
+    EXPECT_FLOAT_EQ(plaits::SampleRate(), plaits::kDefaultSampleRate);
+}
+
+TEST(VoiceAllocatorRateTest, AllocatorsRenderAtTheirOwnRates) {
+    float expected[512], left[512], right[512];
+    {
+        VoiceAllocator alone;
+        alone.Init(48000.0, 8);
+        alone.NoteOn(60, 1.0f, 0.0f, 500.0f);
+        alone.Process(expected, right, 512);
+    }
+
+    // Another instance, initialised first at another supported rate, does not
+    // change the rate the second renders at
+    VoiceAllocator low, high;
+    low.Init(44100.0, 8);
+    high.Init(48000.0, 8);
+    EXPECT_TRUE(low.isNativeRate());
+    EXPECT_TRUE(high.isNativeRate());
+    EXPECT_DOUBLE_EQ(low.renderSampleRate(), 44100.0);
+    EXPECT_DOUBLE_EQ(high.renderSampleRate(), 48000.0);
+
+    low.NoteOn(60, 1.0f, 0.0f, 500.0f);
+    high.NoteOn(60, 1.0f, 0.0f, 500.0f);
+    for (size_t offset = 0; offset < 512; offset += 128) {
+        float lowLeft[128], lowRight[128];
+        low.Process(lowLeft, lowRight, 128);
+        high.Process(left + offset, right + offset, 128);
+    }
+    for (int i = 0; i < 512; ++i) {
+        ASSERT_EQ(left[i], expected[i]) << "Sample " << i;
+    }
+
+    // Re-preparing one at an unsupported rate falls back to the internal
+    // rate, whatever the other uses
+    low.Init(96000.0, 8);
+    EXPECT_DOUBLE_EQ(low.renderSampleRate(), Voice::kInternalSampleRate);
+    EXPECT_DOUBLE_EQ(high.renderSampleRate(), 48000.0);
+}
+
+TEST(VoiceAllocatorRateTest, UnsupportedRateFallsBackToInternalRate) {
+    VoiceAllocator allocator;
+    allocator.Init(96000.0, 8);
+
+    EXPECT_FALSE(allocator.isNativeRate());
+    EXPECT_DOUBLE_EQ(allocator.renderSampleRate(), Voice::kInternalSampleRate);
+}
+
+TEST_F(VoiceAllocatorTest, NoteOnBetweenSubBlocksStartsAtOffset) {
+    // Rendering a host block in pieces around an event, as the processor
+    // does for MIDI timestamps
+    float left[512], right[512];
+    allocator_.Process(left, right, 256);
+    allocator_.NoteOn(60, 1.0f, 0.0f, 500.0f);
+    allocator_.Process(left + 256, right + 256, 256);
+
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_FLOAT_EQ(left[i], 0.0f) << "Sample " << i << " precedes the event";
+    }
+
+    float sum = 0.0f;
+    for (int i = 256; i < 512; ++i) {
+        sum += std::abs(left[i]);
+    }
+    EXPECT_GT(sum, 0.0f) << "Note should sound after the event position";
+}
+
+TEST_F(VoiceAllocatorTest, NoteOnWhileVoicesSoundStartsAtOffset) {
+    // Voices already render whole 24-sample ticks, so the bus holds samples
+    // past the event; the new note must still start at the event. Plaits
+    // delays every trigger by the same few blocks, so the onset is measured
+    // relative to a note on at the start of a tick
+    constexpr size_t kTick = Voice::kInternalBlockSize;
+    constexpr size_t kSize = kTick * 12;
+    for (bool voiceFilter : { false, true }) {
+        size_t latency = kSize;
+        for (size_t offset : { kTick * 4, kTick * 4 + 1, kTick * 4 + 10, kTick * 5 - 1 }) {
+            VoiceAllocator reference;
+            VoiceAllocator allocator;
+            reference.Init(48000.0, 8);
+            allocator.Init(48000.0, 8);
+            reference.setVoiceFilter(voiceFilter);
+            allocator.setVoiceFilter(voiceFilter);
+            reference.NoteOn(48, 0.8f, 0.0f, 500.0f);
+            allocator.NoteOn(48, 0.8f, 0.0f, 500.0f);
+
+            float left[kSize], right[kSize];
+            float expectedLeft[kSize], expectedRight[kSize];
+            reference.Process(expectedLeft, expectedRight, offset);
+            reference.Process(expectedLeft + offset, expectedRight + offset, kSize - offset);
+            allocator.Process(left, right, offset);
+            allocator.NoteOn(72, 1.0f, 0.0f, 500.0f);
+            allocator.Process(left + offset, right + offset, kSize - offset);
+
+            size_t onset = kSize;
+            for (size_t i = 0; i < kSize; ++i) {
+                if (left[i] != expectedLeft[i] || right[i] != expectedRight[i]) {
+                    onset = i;
+                    break;
+                }
+            }
+            ASSERT_LT(onset, kSize) << "Note should sound";
+            ASSERT_GE(onset, offset);
+            if (latency == kSize) {
+                latency = onset - offset;
+            }
+            EXPECT_EQ(onset - offset, latency)
+                << (voiceFilter ? "Voice filter" : "Global filter") << ", offset " << offset;
+        }
+    }
+}
+
+TEST_F(VoiceAllocatorTest, ParallelRenderMatchesSerial) {
+    VoiceAllocator parallel;
+    parallel.Init(44100.0, 8);
+    parallel.setRenderThreads(3);
+    EXPECT_EQ(parallel.renderThreads(), 3);
+
+    const int notes[] = { 48, 55, 60, 64, 67, 71 };
+    for (int note : notes) {
+        allocator_.NoteOn(note, 0.8f, 0.0f, 500.0f);
+        parallel.NoteOn(note, 0.8f, 0.0f, 500.0f);
+    }
+
+    float left[512], right[512];
+    float parallelLeft[512], parallelRight[512];
+    for (int block = 0; block < 8; ++block) {
+        allocator_.Process(left, right, 512);
+        parallel.Process(parallelLeft, parallelRight, 512);
+
+        for (int i = 0; i < 512; ++i) {
+            ASSERT_EQ(left[i], parallelLeft[i]) << "Block " << block << " sample " << i;
+            ASSERT_EQ(right[i], parallelRight[i]) << "Block " << block << " sample " << i;
+        }
+    }
+
+    parallel.setRenderThreads(0);
+    EXPECT_EQ(parallel.renderThreads(), 0);
+}
+
+TEST_F(VoiceAllocatorTest, BatchedVirtualAnalogVoicesMatchSingleVoices) {
+    // Six voices on the virtual analog engine render four and two to a
+    // batch; each should sound as it would rendered on its own, at the
+    // allocator's rate
+    plaits::SampleRateSettings settings;
+    settings.Init(44100.0f);
+    plaits::ScopedSampleRate sampleRate(&settings);
+
+    const int notes[] = { 48, 55, 60, 64, 67, 71 };
+    constexpr size_t kNotes = std::size(notes);
+    auto single = std::make_unique<Voice[]>(kNotes);
+    for (size_t v = 0; v < kNotes; ++v) {
+        single[v].Init();
+        single[v].set_engine(0);
+        single[v].NoteOn(notes[v], 0.8f, 0.0f, 500.0f);
+        allocator_.NoteOn(notes[v], 0.8f, 0.0f, 500.0f);
+    }
+
+    constexpr size_t kSize = Voice::kInternalBlockSize * 20;
+    float left[kSize], right[kSize];
+    float expectedLeft[kSize], expectedRight[kSize];
+    for (int block = 0; block < 8; ++block) {
+        allocator_.Process(left, right, kSize);
+
+        std::fill(std::begin(expectedLeft), std::end(expectedLeft), 0.0f);
+        std::fill(std::begin(expectedRight), std::end(expectedRight), 0.0f);
+        for (size_t v = 0; v < kNotes; ++v) {
+            single[v].Process(expectedLeft, expectedRight, kSize);
+        }
+
+        for (size_t i = 0; i < kSize; ++i) {
+            ASSERT_NEAR(left[i], expectedLeft[i], 1.0e-5f) << "Block " << block << " sample " << i;
+            ASSERT_NEAR(right[i], expectedRight[i], 1.0e-5f) << "Block " << block << " sample " << i;
+        }
+    }
+}
+
+TEST_F(VoiceAllocatorTest, ParallelNoiseEnginesAreReproducible) {
+    // Particle engine: every voice draws from its own random generator
+    VoiceAllocator parallel;
+    parallel.Init(44100.0, 8);
+    parallel.setRenderThreads(3);
+
+    allocator_.set_engine(10);
+    parallel.set_engine(10);
+    for (int note = 60; note < 66; ++note) {
+        allocator_.NoteOn(note, 0.8f, 0.0f, 500.0f);
+        parallel.NoteOn(note, 0.8f, 0.0f, 500.0f);
+    }
+
+    float left[512], right[512];
+    float parallelLeft[512], parallelRight[512];
+    for (int block = 0; block < 4; ++block) {
+        allocator_.Process(left, right, 512);
+        parallel.Process(parallelLeft, parallelRight, 512);
+
+        for (int i = 0; i < 512; ++i) {
+            ASSERT_EQ(left[i], parallelLeft[i]) << "Block " << block << " sample " << i;
+            ASSERT_EQ(right[i], parallelRight[i]) << "Block " << block << " sample " << i;
+        }
+    }
+}
+
+TEST_F(VoiceAllocatorTest, SilentWhenNothingPlays) {
+    EXPECT_TRUE(allocator_.isSilent());
+
+    float left[256], right[256];
+    std::fill(left, left + 256, 1.0f);
+    std::fill(right, right + 256, 1.0f);
+    allocator_.Process(left, right, 256);
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_EQ(left[i], 0.0f);
+        EXPECT_EQ(right[i], 0.0f);
+    }
+
+    allocator_.NoteOn(60, 1.0f, 0.0f, 100.0f);
+    EXPECT_FALSE(allocator_.isSilent());
+}
+
+TEST_F(VoiceAllocatorTest, VoiceFilterLowCutoffAttenuates) {
+    VoiceAllocator filtered;
+    filtered.Init(44100.0, 8);
+    filtered.setVoiceFilter(true);
+    filtered.set_filter_cutoff(100.0f);
+    filtered.set_filter_resonance(0.0f);
+    EXPECT_TRUE(filtered.voiceFilter());
+
+    for (int note : { 72, 76, 79 }) {
+        allocator_.NoteOn(note, 1.0f, 0.0f, 500.0f);
+        filtered.NoteOn(note, 1.0f, 0.0f, 500.0f);
+    }
+
+    float left[2048], right[2048];
+    float filteredLeft[2048], filteredRight[2048];
+    allocator_.Process(left, right, 2048);
+    filtered.Process(filteredLeft, filteredRight, 2048);
+
+    float dry = 0.0f, wet = 0.0f;
+    for (int i = 0; i < 2048; ++i) {
+        ASSERT_TRUE(std::isfinite(filteredLeft[i]));
+        dry += left[i] * left[i] + right[i] * right[i];
+        wet += filteredLeft[i] * filteredLeft[i] + filteredRight[i] * filteredRight[i];
+    }
+    EXPECT_GT(dry, 0.0f);
+    EXPECT_LT(wet, dry * 0.25f);
+}
+
+TEST_F(VoiceAllocatorTest, VoiceFilterRingsOnAfterVoiceEnds) {
+    allocator_.setVoiceFilter(true);
+    allocator_.set_filter_cutoff(400.0f);
+    allocator_.set_filter_resonance(0.95f);
+    allocator_.NoteOn(48, 1.0f, 0.0f, 20.0f);
+
+    // Run until the voice ends
+    float left[64], right[64];
+    int blocks = 0;
+    while (allocator_.activeVoiceCount() > 0 && blocks < 1000) {
+        allocator_.Process(left, right, 64);
+        ++blocks;
+    }
+    ASSERT_EQ(allocator_.activeVoiceCount(), 0);
+
+    // The filter's ringing is still heard well after the audio the voice
+    // itself rendered, then dies away
+    size_t lastHeard = 0;
+    for (size_t n = 0; n < 100; ++n) {
+        allocator_.Process(left, right, 64);
+        for (size_t i = 0; i < 64; ++i) {
+            if (std::abs(left[i]) > Voice::kSilenceThreshold) {
+                lastHeard = n * 64 + i;
+            }
+        }
+    }
+    EXPECT_GT(lastHeard, VoiceAllocator::kBusSize);
+    EXPECT_TRUE(allocator_.isSilent());
+}
+
+TEST_F(VoiceAllocatorTest, EngineChangeFadesThroughSilence) {
+    allocator_.set_engine(0);
+    allocator_.NoteOn(60, 1.0f, 0.0f, 2000.0f);
+
+    float left[256], right[256];
+    for (int i = 0; i < 8; ++i) {
+        allocator_.Process(left, right, 256);
+    }
+    float before = 0.0f;
+    for (int i = 0; i < 256; ++i) {
+        before = std::max(before, std::abs(left[i]));
+    }
+    ASSERT_GT(before, 0.01f);
+
+    // The old engine plays on, fading out, until the block that reaches silence
+    allocator_.set_engine(5);
+    EXPECT_EQ(allocator_.engine(), 0);
+
+    const size_t fadeSamples = static_cast<size_t>(
+        VoiceAllocator::kEngineFadeMs * 0.001 * 44100.0);
+    float fade[512], fadeRight[512];
+    allocator_.Process(fade, fadeRight, 512);
+    EXPECT_EQ(allocator_.engine(), 5);
+
+    // No jump at the change, and silence from the end of the fade out
+    EXPECT_LE(std::abs(fade[0]), before);
+    for (size_t i = fadeSamples; i < 512; ++i) {
+        EXPECT_EQ(fade[i], 0.0f) << "at sample " << i;
+    }
+
+    // Then the new engine fades back in
+    float after = 0.0f;
+    for (int i = 0; i < 8; ++i) {
+        allocator_.Process(left, right, 256);
+    }
+    for (int i = 0; i < 256; ++i) {
+        after = std::max(after, std::abs(left[i]));
+    }
+    EXPECT_GT(after, 0.01f);
+}
+
+TEST_F(VoiceAllocatorTest, EngineChangeWhileSilentIsImmediate) {
+    allocator_.set_engine(3);
+    EXPECT_EQ(allocator_.engine(), 3);
+}
@@ -6,7 +6,7 @@
 class VoiceTest : public ::testing::Test {
 protected:
     void SetUp() override {
-        voice_.Init(44100.0);
+        voice_.Init();
     }
 
     Voice voice_;
@@ -69,7 +69,7 @@ TEST_F(VoiceTest, InactiveVoiceDoesNotModifyBuffer) {
 
 TEST_F(VoiceTest, DifferentNotesProduceDifferentPitches) {
     // Test with a low note
-    voice_.Init(44100.0);
+    voice_.Init();
     voice_.set_engine(0);  // VA engine
     voice_.NoteOn(36, 1.0f, 0.0f, 500.0f);  // C2
 
@@ -80,7 +80,7 @@ TEST_F(VoiceTest, DifferentNotesProduceDifferentPitches) {
 
     // Test with a high note
     Voice voice2;
-    voice2.Init(44100.0);
+    voice2.Init();
     voice2.set_engine(0);
     voice2.NoteOn(72, 1.0f, 0.0f, 500.0f);  // C5
 
@@ -103,7 +103,7 @@ TEST_F(VoiceTest, DifferentNotesProduceDifferentPitches) {
 
 TEST_F(VoiceTest, VelocityAffectsAmplitude) {
     // Loud note
-    voice_.Init(44100.0);
+    voice_.Init();
     voice_.NoteOn(60, 1.0f, 0.0f, 500.0f);
 
     float loudLeft[256], loudRight[256];
@@ -118,7 +118,7 @@ TEST_F(VoiceTest, VelocityAffectsAmplitude) {
 
     // Quiet note
     Voice quietVoice;
-    quietVoice.Init(44100.0);
+    quietVoice.Init();
     quietVoice.NoteOn(60, 0.25f, 0.0f, 500.0f);
 
     float quietLeft[256], quietRight[256];
@@ -145,7 +145,7 @@ TEST_F(VoiceTest, EngineParameterChanges) {
 
     // Change to different engine
     Voice voice2;
-    voice2.Init(44100.0);
+    voice2.Init();
     voice2.set_engine(5);  // Wavetable
     voice2.NoteOn(60, 1.0f, 0.0f, 500.0f);
 
@@ -164,9 +164,9 @@ TEST_F(VoiceTest, EngineParameterChanges) {
 }
 
 TEST_F(VoiceTest, AllEnginesWork) {
-    for (int engine = 0; engine < 16; ++engine) {
+    for (int engine = 0; engine < Voice::kNumEngines; ++engine) {
         Voice v;
-        v.Init(44100.0);
+        v.Init();
         v.set_engine(engine);
         v.NoteOn(60, 1.0f, 0.0f, 500.0f);
 
@@ -191,6 +191,71 @@ TEST_F(VoiceTest, AllEnginesWork) {
     }
 }
 
+TEST_F(VoiceTest, EveryRegistryEngineIsSelectable) {
+    bool selected[Voice::kNumEngines] = {};
+    for (int engine = 0; engine < Voice::kNumEngines; ++engine) {
+        voice_.set_engine(engine);
+        ASSERT_GE(voice_.plaitsEngine(), 0);
+        ASSERT_LT(voice_.plaitsEngine(), Voice::kNumEngines);
+        EXPECT_FALSE(selected[voice_.plaitsEngine()]) << "Engine " << engine;
+        selected[voice_.plaitsEngine()] = true;
+    }
+
+    // The classic engines keep the indices saved state and presets use
+    voice_.set_engine(0);
+    EXPECT_EQ(voice_.plaitsEngine(), Voice::kVirtualAnalogEngine);
+    voice_.set_engine(Voice::kNumClassicEngines);
+    EXPECT_EQ(voice_.plaitsEngine(), 0);
+}
+
+TEST_F(VoiceTest, SixOpEnginesHoldTheirGate) {
+    // With only a trigger pulse, the DX7 envelopes would release at once
+    for (int engine = 18; engine <= 20; ++engine) {
+        Voice v;
+        v.Init();
+        v.set_engine(engine);
+
+        for (int note = 0; note < 2; ++note) {
+            // The second note retriggers the still sounding voice
+            v.NoteOn(60, 1.0f, 0.0f, 500.0f);
+            float left[2048] = {}, right[2048] = {};
+            v.Process(left, right, 2048);
+
+            float peak = 0.0f;
+            for (int i = 1024; i < 2048; ++i) {
+                peak = std::max(peak, std::abs(left[i]));
+            }
+            EXPECT_GT(peak, 0.01f) << "Engine " << engine << " note " << note;
+        }
+    }
+}
+
+TEST_F(VoiceTest, EngineCostsAreMeasured) {
+    // Engines are only initialized when selected, so their memory is known
+    // from then on
+    for (int engine = 0; engine < Voice::kNumEngines; ++engine) {
+        plaits::EngineCost cost = voice_.engineCost(engine);
+        EXPECT_GT(cost.storage_bytes, 0u) << "Engine " << engine;
+        EXPECT_EQ(cost.arena_bytes, 0u) << "Engine " << engine;
+        EXPECT_EQ(cost.ns_per_sample, 0.0f) << "Engine " << engine;
+    }
+
+    voice_.set_engine(18);
+    voice_.NoteOn(60, 1.0f, 0.0f, 500.0f);
+    float left[2048] = {}, right[2048] = {};
+    voice_.Process(left, right, 2048);
+
+    EXPECT_GT(voice_.engineCost(18).arena_bytes, 0u);
+    EXPECT_LE(voice_.engineCost(18).arena_bytes, 32768u);
+    EXPECT_GT(voice_.engineCost(18).ns_per_sample, 0.0f);
+
+    // Six-op, bank 1: shares its instance with the other banks, so its memory
+    // too, but has not been rendered
+    EXPECT_EQ(voice_.engineCost(19).arena_bytes, voice_.engineCost(18).arena_bytes);
+    EXPECT_EQ(voice_.engineCost(19).ns_per_sample, 0.0f);
+    EXPECT_EQ(voice_.engineCost(0).arena_bytes, 0u);
+}
+
 TEST_F(VoiceTest, HarmonicsParameterWorks) {
     voice_.set_harmonics(0.0f);
     voice_.NoteOn(60, 1.0f, 0.0f, 500.0f);
@@ -260,3 +325,85 @@ TEST_F(VoiceTest, MorphParameterWorks) {
 
     EXPECT_GT(diff, 0.01f) << "Different morph should produce different output";
 }
+
+TEST_F(VoiceTest, SameSeedRendersIdentically) {
+    Voice other, interloper;
+    other.Init();
+    interloper.Init();
+
+    voice_.Seed(1234);
+    other.Seed(1234);
+    interloper.Seed(99);
+
+    // Noise engine: output is driven entirely by the random generator
+    for (Voice* v : { &voice_, &other, &interloper }) {
+        v->set_engine(9);
+        v->NoteOn(60, 1.0f, 0.0f, 500.0f);
+    }
+
+    float left[256] = {}, right[256] = {};
+    float otherLeft[256] = {}, otherRight[256] = {};
+    float scratchLeft[256] = {}, scratchRight[256] = {};
+
+    // Rendering another voice in between must not disturb either sequence
+    voice_.Process(left, right, 256);
+    interloper.Process(scratchLeft, scratchRight, 256);
+    other.Process(otherLeft, otherRight, 256);
+
+    for (int i = 0; i < 256; ++i) {
+        ASSERT_EQ(left[i], otherLeft[i]) << "Sample " << i;
+        ASSERT_EQ(right[i], otherRight[i]) << "Sample " << i;
+    }
+
+    bool differs = false;
+    for (int i = 0; i < 256; ++i) {
+        differs = differs || scratchLeft[i] != left[i];
+    }
+    EXPECT_TRUE(differs);
+}
+
+TEST_F(VoiceTest, PercussiveVoiceReleasedOnceSilent) {
+    // Bass drum with a long AD decay: the kick dies out well before it ends
+    voice_.set_engine(13);
+    voice_.set_morph(0.0f);
+    voice_.set_decay(0.0f);
+    voice_.NoteOn(36, 1.0f, 0.0f, 2000.0f);
+
+    float left[512], right[512];
+    int blocks = 0;
+    while (voice_.active() && blocks < 200) {
+        std::fill(left, left + 512, 0.0f);
+        std::fill(right, right + 512, 0.0f);
+        voice_.Process(left, right, 512);
+        ++blocks;
+    }
+
+    EXPECT_FALSE(voice_.active());
+    EXPECT_LT(blocks * 512, 44100);  // Well under the 2s envelope
+}
+
+TEST_F(VoiceTest, PausingVoiceKeepsPlaying) {
+    // Sparse particles with the LPG held open: the engine falls silent
+    // between impulses, but the note has not ended
+    voice_.set_engine(10);
+    voice_.set_timbre(0.0f);
+    voice_.set_morph(0.5f);
+    voice_.set_decay(1.0f);
+    voice_.NoteOn(60, 1.0f, 0.0f, 3000.0f);
+
+    const size_t holdSamples = static_cast<size_t>(44100.0 * Voice::kSilenceHoldSeconds);
+    float left[512], right[512];
+    size_t silent = 0;
+    size_t longestGap = 0;
+    for (int block = 0; block < 100; ++block) {
+        std::fill(left, left + 512, 0.0f);
+        std::fill(right, right + 512, 0.0f);
+        voice_.Process(left, right, 512);
+        ASSERT_TRUE(voice_.active()) << "Block " << block;
+        for (int i = 0; i < 512; ++i) {
+            silent = std::max(std::abs(left[i]), std::abs(right[i])) < Voice::kSilenceThreshold ? silent + 1 : 0;
+            longestGap = std::max(longestGap, silent);
+        }
+    }
+    EXPECT_GT(longestGap, 2 * holdSamples);
+}